@@ -0,0 +1,97 @@
+#ifndef _RKNN_YOLOV8_DEMO_ASYNC_INFER_H_
+#define _RKNN_YOLOV8_DEMO_ASYNC_INFER_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "yolov8.h"
+
+/**
+ * @brief 一帧异步推理的结果，只在回调期间有效
+ */
+struct AsyncInferResult {
+    uint64_t seq;                           // submit返回的序号
+    uint64_t frame_id;                      // runtime分配的frame_id
+    int ret;                                // 0表示成功
+    image_buffer_t* img;                    // submit时传入的图像
+    object_detect_result_list* od_results;  // 检测结果，回调返回后被下一帧复用
+    int64_t latency_us;                     // 从submit到回调的耗时
+};
+
+typedef std::function<void(const AsyncInferResult&)> AsyncInferCallback;
+
+/**
+ * @brief 异步推理：提交帧后立即返回，结果通过回调按提交顺序送达
+ *
+ * 后台线程独占一个推理上下文，以non_block方式调用rknn_run，在NPU执行第N帧期间
+ * 完成第N+1帧的letterbox和第N-1帧的后处理及回调，再通过rknn_wait取回第N帧的输出。
+ * 已提交但尚未回调的帧数不超过depth，达到上限时submit阻塞。
+ */
+class AsyncInferencer
+{
+public:
+    AsyncInferencer();
+    ~AsyncInferencer();
+
+    /**
+     * @brief 启动后台线程
+     * @param app_ctx 已初始化的上下文，运行期间只能由本对象使用
+     * @param depth 在途帧数上限（至少为1，为1时等同于同步推理）
+     * @return 成功返回0，失败返回-1
+     */
+    int init(rknn_app_context_t* app_ctx, int depth);
+
+    /**
+     * @brief 提交一帧，img在回调返回前必须保持有效
+     * @return 帧序号，已停止时返回-1
+     */
+    int64_t submit(image_buffer_t* img, const AsyncInferCallback& callback);
+
+    /**
+     * @brief 等待所有已提交的帧回调完成
+     */
+    void flush();
+
+    /**
+     * @brief 处理完已提交的帧后停止后台线程
+     */
+    void deinit();
+
+private:
+    struct AsyncJob {
+        uint64_t seq;
+        uint64_t frame_id;
+        image_buffer_t* img;
+        letterbox_t letter_box;
+        AsyncInferCallback callback;
+        int64_t submit_us;
+    };
+
+    void driver_loop();
+    AsyncJob* take_job(bool block);
+    void finish_job(AsyncJob* job, int ret);
+
+    rknn_app_context_t* app_ctx_;
+    int depth_;
+    image_buffer_t input_image_;            // letterbox结果，提交时由runtime拷贝（零拷贝模式拷贝进tensor内存）
+    std::vector<rknn_output> outputs_;      // 取回的输出，下一帧wait前完成后处理
+    object_detect_result_list od_results_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable job_cond_;      // 有新帧或停止
+    std::condition_variable done_cond_;     // 有帧回调完成
+    std::deque<AsyncJob*> jobs_;
+    int pending_;                           // 已提交但尚未回调的帧数
+    uint64_t next_seq_;
+    bool stop_;
+    bool running_;
+};
+
+#endif //_RKNN_YOLOV8_DEMO_ASYNC_INFER_H_
@@ -0,0 +1,146 @@
+#ifndef _RKNN_YOLOV8_DEMO_BATCH_INFER_H_
+#define _RKNN_YOLOV8_DEMO_BATCH_INFER_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "yolov8.h"
+
+/**
+ * @brief 多batch推理配置
+ */
+typedef struct {
+    int max_batch;          // 每次推理最多合并的帧数，0表示模型的batch维度（不能超过它）
+    int64_t timeout_us;     // 第一帧到达后最多等待多久凑满batch，超时后不足的帧也提交
+    int batch_core_num;     // >0时调用rknn_set_batch_core_num，把batch分到多个NPU核心上
+    int queue_depth;        // 等待中的帧数上限，达到上限时submit阻塞；0表示2倍max_batch
+} batch_infer_config_t;
+
+/**
+ * @brief 填充默认配置：batch取模型的batch维度，等待2ms，不设置batch核心数
+ */
+void init_batch_infer_config(batch_infer_config_t* config);
+
+/**
+ * @brief 一帧推理结果，只在回调期间有效
+ */
+struct BatchInferResult {
+    uint64_t seq;                           // submit返回的序号
+    int ret;                                // 0表示成功
+    image_buffer_t* img;                    // submit时传入的图像
+    object_detect_result_list* od_results;  // 检测结果，回调返回后被下一帧复用
+    int batch_size;                         // 所在batch实际合并的帧数
+    int64_t queue_us;                       // 从submit到所在batch开始处理的排队时间
+    int64_t latency_us;                     // 从submit到回调的耗时
+};
+
+typedef std::function<void(const BatchInferResult&)> BatchInferCallback;
+
+/**
+ * @brief 批处理统计
+ */
+typedef struct {
+    uint64_t batches;               // rknn_run次数
+    uint64_t frames;                // 处理的帧数
+    std::vector<uint64_t> fill;     // fill[n]：合并了n帧的batch数，n为1..max_batch
+    int64_t queue_us_max;           // 最大排队时间（分位数见perf_stats的batch_wait阶段）
+    int64_t queue_us_sum;
+} batch_infer_stats_t;
+
+/**
+ * @brief 多路输入的批处理推理：收集最多B帧或等待最多T微秒，合并成一次NPU推理
+ *
+ * 模型以batch=B导出（输入[B, H, W, C]、输出[B, C, H, W]）。submit在调用线程中完成letterbox，
+ * 多路数据源的预处理并行进行；后台线程从队列取帧，拷贝到batch输入的对应位置，
+ * rknn_inputs_set/rknn_run/rknn_outputs_get各调用一次，再按batch下标切分输出，每帧分别post_process并回调。
+ * 不足B帧时剩余位置沿用上一次的数据，其输出被忽略。每次rknn_run的固定开销（提交、同步、调度）由B帧分摊，
+ * 适合多路摄像头共用一个上下文。
+ *
+ * submit线程安全，多个数据源线程可以同时提交；回调在后台线程中按入队顺序执行，不能阻塞太久。
+ * 上下文需为拷贝模式，运行期间只能由本对象使用。
+ */
+class BatchInferencer
+{
+public:
+    BatchInferencer();
+    ~BatchInferencer();
+
+    /**
+     * @brief 分配batch输入输出缓冲区并启动后台线程
+     * @param app_ctx 已初始化的拷贝模式上下文
+     * @param config 为NULL时使用默认配置
+     * @return 成功返回0，失败返回-1
+     */
+    int init(rknn_app_context_t* app_ctx, const batch_infer_config_t* config);
+
+    /**
+     * @brief letterbox一帧并加入队列，img在回调返回前必须保持有效
+     * @return 帧序号（入队顺序），已停止或预处理失败时返回-1
+     */
+    int64_t submit(image_buffer_t* img, const BatchInferCallback& callback);
+
+    /**
+     * @brief 等待所有已提交的帧回调完成
+     */
+    void flush();
+
+    /**
+     * @brief 处理完已提交的帧后停止后台线程
+     */
+    void deinit();
+
+    int max_batch() const { return max_batch_; }
+
+    void get_stats(batch_infer_stats_t* stats);
+
+    /**
+     * @brief 打印batch填充分布和排队时间
+     */
+    void print_stats();
+
+private:
+    struct BatchJob {
+        uint64_t seq;
+        image_buffer_t* img;
+        unsigned char* input;               // letterbox结果，取自free_inputs_
+        letterbox_t letter_box;
+        BatchInferCallback callback;
+        int64_t submit_us;
+    };
+
+    void driver_loop();
+    bool take_batch(std::vector<BatchJob*>* batch);
+    int run_batch(std::vector<BatchJob*>& batch);
+
+    rknn_app_context_t* app_ctx_;
+    int model_batch_;                       // 模型的batch维度，输入输出缓冲区按它分配
+    int max_batch_;
+    int64_t timeout_us_;
+    int queue_depth_;
+    size_t frame_input_size_;               // 一帧letterbox结果的字节数
+    std::vector<unsigned char> input_;      // [model_batch, H, W, C]
+    std::vector<unsigned char> staging_;    // queue_depth帧的letterbox缓冲区
+    std::vector<unsigned char*> free_inputs_;   // staging_中空闲的帧缓冲区
+    std::vector<rknn_output> outputs_;      // 整个batch的输出
+    std::vector<rknn_output> frame_outputs_;    // 指向outputs_中某一帧的切片，交给post_process
+    object_detect_result_list od_results_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable job_cond_;      // 有新帧或停止
+    std::condition_variable done_cond_;     // 有帧回调完成
+    std::deque<BatchJob*> jobs_;
+    int pending_;                           // 已提交但尚未回调的帧数，不超过queue_depth_，每帧占用一块staging缓冲区
+    uint64_t next_seq_;
+    bool stop_;
+    bool running_;
+    batch_infer_stats_t stats_;
+};
+
+#endif //_RKNN_YOLOV8_DEMO_BATCH_INFER_H_
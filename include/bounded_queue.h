@@ -0,0 +1,98 @@
+#ifndef _RKNN_YOLOV8_DEMO_BOUNDED_QUEUE_H_
+#define _RKNN_YOLOV8_DEMO_BOUNDED_QUEUE_H_
+
+#include <stddef.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/**
+ * @brief 有界阻塞队列，用于流水线各阶段之间传递任务
+ *
+ * 队列满时push阻塞（对上游形成背压），队列空时pop阻塞。
+ * close()之后push直接失败，pop取完剩余元素后返回false，
+ * 下游线程据此退出。
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1), closed_(false) {}
+
+    bool push(const T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_)
+        {
+            return false;
+        }
+        items_.push_back(item);
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief 非阻塞入队，队列满时丢弃最旧的元素，用于实时数据源（延迟优先于完整性）
+     * @param evicted 被丢弃的元素，由调用者负责释放
+     * @param did_evict 是否有元素被丢弃
+     * @return 队列已关闭时返回false
+     */
+    bool push_drop_oldest(const T &item, T &evicted, bool &did_evict)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        did_evict = false;
+        if (closed_)
+        {
+            return false;
+        }
+        if (items_.size() >= capacity_)
+        {
+            evicted = items_.front();
+            items_.pop_front();
+            did_evict = true;
+        }
+        items_.push_back(item);
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty())
+        {
+            return false;
+        }
+        item = items_.front();
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+#endif //_RKNN_YOLOV8_DEMO_BOUNDED_QUEUE_H_
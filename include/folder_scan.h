@@ -0,0 +1,84 @@
+#ifndef _RKNN_YOLOV8_DEMO_FOLDER_SCAN_H_
+#define _RKNN_YOLOV8_DEMO_FOLDER_SCAN_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief 文件夹扫描选项
+ */
+typedef struct {
+    bool recursive;     // 是否进入子目录（不跟随指向目录的符号链接）
+    int threads;        // 递归扫描时并行读取目录的线程数
+} folder_scan_options_t;
+
+/**
+ * @brief 填充默认选项：不递归，4个线程
+ */
+void init_folder_scan_options(folder_scan_options_t* opts);
+
+/**
+ * @brief 文件名是否为支持的图像格式（.jpg/.jpeg/.png，扩展名不区分大小写）
+ */
+bool is_image_file_name(const char* name);
+
+/**
+ * @brief 扫描文件夹中的图像文件，一次性生成工作列表
+ *
+ * 结果为相对root的路径（子目录用'/'分隔），按字典序排序，
+ * 同一批文件每次扫描的顺序相同，与readdir返回的顺序无关。
+ *
+ * @return 文件数，root无法打开时返回-1
+ */
+int scan_image_folder(const std::string& root, const folder_scan_options_t* opts, std::vector<std::string>* files);
+
+/**
+ * @brief 创建目录及其所有上级目录（已存在时不报错）
+ * @return 成功返回0，失败返回-1
+ */
+int create_dirs(const std::string& path);
+
+/**
+ * @brief 已完成文件的检查点，用于中断后续跑
+ *
+ * 文件格式："YOLOCKPT" | version(uint32) | reserved(uint32) | 每个完成的文件一条uint64记录，
+ * 记录为相对路径的64位FNV-1a哈希。每完成一个文件追加8字节并立即fflush，进程崩溃时最多丢失
+ * 正在写的一条记录（读取时忽略不完整的结尾）。打开时把所有记录读入哈希表，is_done为O(1)。
+ */
+class FolderCheckpoint
+{
+public:
+    FolderCheckpoint();
+    ~FolderCheckpoint();
+
+    /**
+     * @brief 打开检查点文件，不存在时创建
+     * @return 成功返回0，文件不是检查点格式或无法写入时返回-1
+     */
+    int open(const char* path);
+
+    void close();
+
+    bool is_done(const std::string& rel_path);
+
+    /**
+     * @brief 记录一个完成的文件，线程安全
+     */
+    void mark_done(const std::string& rel_path);
+
+    size_t size();
+
+private:
+    static uint64_t hash_path(const std::string& rel_path);
+
+    FILE* fp_;
+    std::unordered_set<uint64_t> done_;
+    std::mutex mutex_;
+};
+
+#endif //_RKNN_YOLOV8_DEMO_FOLDER_SCAN_H_
@@ -0,0 +1,45 @@
+#ifndef _RKNN_YOLOV8_DEMO_FRAME_SOURCE_H_
+#define _RKNN_YOLOV8_DEMO_FRAME_SOURCE_H_
+
+#include "common.h"
+
+/**
+ * @brief 视频帧数据源
+ *
+ * 生产环境的输入是RTSP/V4L2等实时流，这里用文件作为替身：
+ * - 视频文件、/dev/videoN、rtsp://等地址通过OpenCV VideoCapture读取，输出RGB888
+ *   （需要OpenCV包含videoio模块）
+ * - .nv12/.nv21/.yuv原始帧序列按固定尺寸逐帧读取，输出YUV420SP原始格式
+ */
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    /**
+     * @brief 读取下一帧，图像缓冲区由函数内部分配，调用者通过free_image_buffer释放
+     * @return 0成功，1数据源结束，-1读取失败
+     */
+    virtual int read(image_buffer_t* image) = 0;
+
+    /**
+     * @brief 数据源自身的帧率，未知时返回0
+     */
+    virtual double fps() const = 0;
+
+    /**
+     * @brief 是否为实时数据源（摄像头、网络流），实时源的读取本身按采集节拍阻塞
+     */
+    virtual bool is_live() const = 0;
+};
+
+/**
+ * @brief 根据地址创建数据源
+ * @param uri 视频文件路径、设备节点、网络流地址或原始YUV文件路径
+ * @param raw_width 原始YUV帧宽度（其他数据源忽略）
+ * @param raw_height 原始YUV帧高度（其他数据源忽略）
+ * @return 成功返回数据源对象（调用者delete），失败返回NULL
+ */
+FrameSource* create_frame_source(const char* uri, int raw_width, int raw_height);
+
+#endif //_RKNN_YOLOV8_DEMO_FRAME_SOURCE_H_
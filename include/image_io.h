@@ -0,0 +1,41 @@
+#ifndef _RKNN_YOLOV8_DEMO_IMAGE_IO_H_
+#define _RKNN_YOLOV8_DEMO_IMAGE_IO_H_
+
+#include "common.h"
+#include "yolov8.h"
+
+/**
+ * @brief 使用OpenCV读取图像文件并转换为image_buffer_t格式（RGB/RGBA/GRAY）
+ * @return 成功返回0，失败返回-1
+ */
+int read_image_opencv(const char* path, image_buffer_t* image);
+
+/**
+ * @brief 读取模型输入用的图像
+ * @param model_width 模型输入宽度
+ * @param model_height 模型输入高度
+ * @param fast_decode 为true且文件为JPEG时，使用libjpeg-turbo按letterbox比例缩小解码，
+ *                    不生成全分辨率RGB图像；否则与read_image_opencv相同
+ * @param decode_scale 输出解码图像相对原图的缩放比例（原尺寸解码时为1）
+ * @return 成功返回0，失败返回-1
+ */
+int read_image_for_model(const char* path, int model_width, int model_height, bool fast_decode,
+                         image_buffer_t* image, float* decode_scale);
+
+/**
+ * @brief 将检测框坐标从解码图像映射回原图坐标
+ */
+void restore_detect_results_scale(object_detect_result_list* od_results, float decode_scale);
+
+/**
+ * @brief 将YUV420SP（NV12/NV21）图像转换为RGB888，dst->virt_addr由函数内部分配
+ * @return 成功返回0，失败返回-1
+ */
+int convert_yuv420sp_to_rgb(const image_buffer_t* src, image_buffer_t* dst);
+
+/**
+ * @brief 在图像上绘制检测框和类别/置信度文字
+ */
+void draw_detect_results(image_buffer_t* image, object_detect_result_list* od_results);
+
+#endif //_RKNN_YOLOV8_DEMO_IMAGE_IO_H_
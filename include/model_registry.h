@@ -0,0 +1,103 @@
+#ifndef _RKNN_YOLOV8_DEMO_MODEL_REGISTRY_H_
+#define _RKNN_YOLOV8_DEMO_MODEL_REGISTRY_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "yolov8.h"
+
+/**
+ * @brief 单个上下文的内存占用（字节）
+ */
+typedef struct {
+    uint64_t weight_bytes;          // 本上下文分配的权重，共享权重的上下文为0
+    uint64_t shared_weight_bytes;   // 引用基础上下文、不重复占用的权重
+    uint64_t internal_bytes;        // runtime的中间结果内存
+    uint64_t io_bytes;              // 预分配的输入输出缓冲区
+} model_memory_t;
+
+/**
+ * @brief 共享权重的多分辨率模型注册表
+ *
+ * 同一套权重按不同输入分辨率导出的多个.rknn（例如640和1280）：基础上下文正常加载，
+ * 其余模型以RKNN_FLAG_SHARE_WEIGHT_MEM初始化并通过rknn_init_extend.ctx指向基础上下文，
+ * runtime只保留一份权重，每个分辨率只额外占用中间结果和输入输出缓冲区。
+ * 调用者按帧选择分辨率（find/select），同一上下文同一时间只能由一个线程使用。
+ */
+class ModelRegistry
+{
+public:
+    ModelRegistry();
+    ~ModelRegistry();
+
+    /**
+     * @brief 设置基础上下文
+     * @param base_ctx 已通过init_yolov8_model初始化的上下文，作为注册表中第一个模型，所有权仍归调用者，
+     *                 必须在deinit之后释放
+     * @param model_path base_ctx的模型路径，只用于打印
+     * @return 成功返回0，失败返回-1
+     */
+    int init(rknn_app_context_t* base_ctx, const char* model_path);
+
+    /**
+     * @brief 加载一个与基础上下文共享权重的模型
+     * @param opts 加载方式及输入输出方式，share_weight_ctx由本函数填写，为NULL时使用默认选项
+     * @return 模型序号，权重与基础模型不一致等原因初始化失败时返回-1
+     */
+    int add(const char* model_path, const yolov8_init_options_t* opts);
+
+    /**
+     * @brief 销毁add创建的上下文（基础上下文由调用者通过release_yolov8_model释放）
+     */
+    void deinit();
+
+    int size() const { return (int)entries_.size(); }
+
+    rknn_app_context_t* get(int index);
+
+    /**
+     * @brief 按输入分辨率查找模型，没有时返回NULL
+     */
+    rknn_app_context_t* find(int model_width, int model_height);
+
+    /**
+     * @brief 按图像尺寸选择模型：输入长边不小于图像长边的最小模型，都小于图像时选最大的模型
+     *        （动态形状模型按最大档位比较，具体档位由inference_yolov8_model按帧选择）
+     */
+    rknn_app_context_t* select(int img_width, int img_height);
+
+    /**
+     * @brief 按缩小解码后的图像选择模型：decode_scale为read_image_for_model输出的缩放比例（解码尺寸/原图尺寸），
+     *        先换算回原图尺寸再按select选择，缩小解码不影响选择结果
+     */
+    rknn_app_context_t* select_decoded(int decoded_width, int decoded_height, float decode_scale);
+
+    /**
+     * @brief 最大的模型，用于按模型尺寸缩小解码（read_image_for_model）时确定解码尺寸
+     */
+    rknn_app_context_t* largest();
+
+    /**
+     * @brief 查询一个上下文的内存占用
+     * @return 成功返回0，序号无效返回-1
+     */
+    int get_memory(int index, model_memory_t* mem);
+
+    /**
+     * @brief 打印每个上下文的内存占用，以及共享权重节省的内存
+     */
+    void print_memory();
+
+private:
+    struct ModelEntry {
+        rknn_app_context_t* app_ctx;
+        std::string path;
+        bool owns_ctx;              // 是否由本注册表通过add创建
+    };
+
+    std::vector<ModelEntry> entries_;
+};
+
+#endif //_RKNN_YOLOV8_DEMO_MODEL_REGISTRY_H_
@@ -0,0 +1,55 @@
+#ifndef _RKNN_YOLOV8_DEMO_NMS_H_
+#define _RKNN_YOLOV8_DEMO_NMS_H_
+
+#include <vector>
+
+/**
+ * @brief NMS模式
+ */
+typedef enum {
+    NMS_PER_CLASS = 0,      // 只在同类别的框之间抑制
+    NMS_CLASS_AGNOSTIC,     // 不区分类别，所有框之间互相抑制
+} nms_mode_t;
+
+/**
+ * @brief NMS候选框（SoA），必须已按置信度降序排列
+ *
+ * 坐标为左上/右下角，面积按(x2-x1+1)*(y2-y1+1)计算，与原有CalculateOverlap一致。
+ * keep由nms_sorted写入：1保留，0被抑制。
+ */
+struct NmsBoxes {
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> x2;
+    std::vector<float> y2;
+    std::vector<float> score;
+    std::vector<int> cls;
+    std::vector<int> keep;
+
+    void resize(int n)
+    {
+        x1.resize(n);
+        y1.resize(n);
+        x2.resize(n);
+        y2.resize(n);
+        score.resize(n);
+        cls.resize(n);
+        keep.assign(n, 1);
+    }
+};
+
+/**
+ * @brief 贪心NMS，结果与逐对比较的实现相同
+ *
+ * 候选框按左边界排序后，每个保留框只与左边界落在[x1 - 最大框宽, x2]范围内的框比较（sorted-x sweep），
+ * 范围内的IoU在ARM上用NEON、在x86上用SSE每次计算4个。
+ *
+ * @param boxes 候选框，按置信度降序
+ * @param count 参与NMS的候选数（boxes中前count个）
+ * @param iou_threshold IoU大于该值的低分框被抑制
+ * @param mode 按类别或不区分类别
+ * @return 保留的框数量
+ */
+int nms_sorted(NmsBoxes& boxes, int count, float iou_threshold, nms_mode_t mode);
+
+#endif //_RKNN_YOLOV8_DEMO_NMS_H_
@@ -0,0 +1,78 @@
+#ifndef _RKNN_YOLOV8_DEMO_PERF_STATS_H_
+#define _RKNN_YOLOV8_DEMO_PERF_STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief 计时的处理阶段
+ */
+typedef enum {
+    PERF_READ = 0,      // 读取并解码图像/视频帧
+    PERF_LETTERBOX,     // 缩放、填充、颜色转换
+    PERF_INPUTS_SET,    // rknn_inputs_set（零拷贝模式为写入tensor内存并同步）
+    PERF_RUN,           // rknn_run
+    PERF_OUTPUTS_GET,   // rknn_outputs_get（零拷贝模式为同步并读取tensor内存）
+    PERF_POSTPROCESS,   // 解码、NMS、坐标还原
+    PERF_DRAW,          // 绘制检测框
+    PERF_ENCODE,        // 编码并写出结果图像
+    PERF_BATCH_WAIT,    // 多batch推理：从提交到所在batch开始处理的排队时间
+    PERF_STAGE_NUM
+} perf_stage_t;
+
+/**
+ * @brief 单调时钟（steady_clock），单位纳秒
+ */
+int64_t perf_now_ns();
+
+/**
+ * @brief 记录一次阶段耗时，无锁，可在任意线程调用
+ *
+ * 每个阶段一个对数-线性分桶的直方图（每个2的幂区间再等分16份，相对误差约6%），
+ * 计数、累加和最大值都是原子变量，不需要加锁。
+ */
+void perf_record(perf_stage_t stage, int64_t elapsed_ns);
+
+/**
+ * @brief 清空所有统计
+ */
+void perf_reset();
+
+/**
+ * @brief 以JSON格式输出各阶段的次数、平均值、p50/p90/p99和最大值（微秒）
+ */
+void perf_dump_json(FILE* fp);
+
+/**
+ * @brief 开始统计输出：收到SIGUSR1时写一次JSON，perf_stats_stop时再写最终结果
+ * @param json_path 输出文件路径，"-"表示标准输出；文件先写临时文件再rename，读取方不会看到写了一半的内容
+ * @return 成功返回0
+ */
+int perf_stats_start(const char* json_path);
+
+/**
+ * @brief 停止SIGUSR1监听并写出最终统计，未调用perf_stats_start时不做任何事
+ */
+void perf_stats_stop();
+
+/**
+ * @brief 作用域计时：构造时开始，析构时记录到对应阶段
+ */
+class PerfSpan
+{
+public:
+    explicit PerfSpan(perf_stage_t stage) : stage_(stage), start_ns_(perf_now_ns()) {}
+    ~PerfSpan() { perf_record(stage_, perf_now_ns() - start_ns_); }
+
+    // 到目前为止的耗时（纳秒）
+    int64_t elapsed_ns() const { return perf_now_ns() - start_ns_; }
+
+private:
+    PerfSpan(const PerfSpan&);
+    PerfSpan& operator=(const PerfSpan&);
+
+    perf_stage_t stage_;
+    int64_t start_ns_;
+};
+
+#endif //_RKNN_YOLOV8_DEMO_PERF_STATS_H_
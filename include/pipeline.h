@@ -0,0 +1,57 @@
+#ifndef _RKNN_YOLOV8_DEMO_PIPELINE_H_
+#define _RKNN_YOLOV8_DEMO_PIPELINE_H_
+
+#include <string>
+#include <vector>
+
+#include "yolov8.h"
+#include "rknn_pool.h"
+#include "folder_scan.h"
+
+/**
+ * @brief 流水线配置：每个阶段的工作线程数及队列深度
+ *
+ * 阶段顺序：decode -> preprocess -> inference -> postprocess -> encode，
+ * 相邻阶段之间通过有界队列连接。
+ */
+typedef struct {
+    int decode_workers;
+    int preprocess_workers;
+    int inference_workers;
+    int postprocess_workers;
+    int encode_workers;
+    int queue_depth;    // 相邻阶段之间队列的容量
+    int max_inflight;   // 同时在流水线中的最大帧数，即预分配的帧缓冲数量
+    int npu_contexts;   // 推理上下文数量，大于1时通过RknnContextPool分配到多个NPU核心
+    pool_schedule_policy_t schedule_policy;
+    bool fast_decode;   // JPEG按letterbox比例缩小解码，输出图像为缩小后的尺寸
+    FolderCheckpoint* checkpoint;   // 编码成功后记录item.key，为NULL时不记录
+} pipeline_config_t;
+
+/**
+ * @brief 单个待处理文件
+ */
+typedef struct {
+    std::string input_path;
+    std::string output_path;
+    std::string key;    // 相对输入文件夹的路径，用于断点续跑检查点
+} pipeline_item_t;
+
+/**
+ * @brief 填充默认配置
+ */
+void init_pipeline_config(pipeline_config_t* config);
+
+/**
+ * @brief 解析各阶段线程数，格式为"decode:preprocess:inference:postprocess:encode"，例如"2:2:1:1:2"
+ * @return 成功返回0，格式错误返回-1
+ */
+int parse_pipeline_workers(const char* spec, pipeline_config_t* config);
+
+/**
+ * @brief 以流水线方式处理一批图像，返回成功处理的文件数
+ */
+int run_folder_pipeline(rknn_app_context_t* app_ctx, const std::vector<pipeline_item_t>& items,
+                        const pipeline_config_t* config);
+
+#endif //_RKNN_YOLOV8_DEMO_PIPELINE_H_
@@ -6,12 +6,14 @@
 #include "rknn_api.h"
 #include "common.h"
 #include "image_utils.h"
+#include "nms.h"
 
 #define OBJ_NAME_MAX_SIZE 64
-#define OBJ_NUMB_MAX_SIZE 128
-#define OBJ_CLASS_NUM 1
+#define OBJ_CLASS_MAX_NUM 1024  // 标签文件最多读取的类别数，实际类别数取自模型输出
 #define NMS_THRESH 0.45
 #define BOX_THRESH 0.25
+#define NMS_PRE_TOPK 1024      // NMS前按置信度保留的最少候选数，结果上限更大时取结果上限
+#define OBJ_NUMB_DEFAULT_MAX NMS_PRE_TOPK  // 默认结果上限
 
 // class rknn_app_context_t;
 
@@ -21,14 +23,50 @@ typedef struct {
     int cls_id;
 } object_detect_result;
 
+/**
+ * @brief 检测结果列表
+ *
+ * results指向可复用的堆缓冲区，按需扩容、只增不减，同一个列表在多帧之间复用时稳定运行后不再分配内存。
+ * 清空只重置count，开销与检测数无关。使用前必须init_detect_result_list，不再使用时free_detect_result_list；
+ * 结构体按值拷贝会共享同一块缓冲区。
+ */
 typedef struct {
     int id;
     int count;
-    object_detect_result results[OBJ_NUMB_MAX_SIZE];
+    int capacity;       // results已分配的个数
+    int max_count;      // 结果上限，0表示使用set_post_process_max_results设置的全局上限
+    int truncated;      // NMS后因超过结果上限被丢弃的检测数
+    int pre_nms_dropped;    // NMS前因候选数超过max(NMS_PRE_TOPK, 结果上限)被丢弃的低分候选数，
+                            // 其中可能有NMS后会保留的目标；两者都为0表示结果完整
+    object_detect_result* results;
 } object_detect_result_list;
 
-int init_post_process();
+/**
+ * @brief 初始化结果列表，不分配内存
+ * @param max_count 结果上限，0表示使用全局上限
+ */
+void init_detect_result_list(object_detect_result_list* list, int max_count);
+// 清空结果（保留缓冲区）
+void reset_detect_result_list(object_detect_result_list* list);
+/**
+ * @brief 保证缓冲区至少能容纳count个结果（不超过上限）
+ * @return 实际可容纳的个数
+ */
+int reserve_detect_result_list(object_detect_result_list* list, int count);
+void free_detect_result_list(object_detect_result_list* list);
+
+/**
+ * @brief 初始化后处理模块：按模型分类输出的通道数确定类别数并选择解码函数
+ * @param app_ctx 已初始化的模型，之后传给post_process的模型类别数必须与它相同（例如共享权重的多分辨率模型）
+ * @param label_path 标签文件（每行一个类别名），NULL时使用内置标签
+ * @return 成功返回0，标签文件读取失败或行数与类别数不一致返回-1
+ */
+int init_post_process(rknn_app_context_t* app_ctx, const char* label_path);
 void deinit_post_process();
+// 设置NMS模式（默认按类别），需在推理开始前调用
+void set_post_process_nms_mode(nms_mode_t mode);
+// 设置max_count为0的结果列表使用的全局上限（默认OBJ_NUMB_DEFAULT_MAX）
+void set_post_process_max_results(int max_results);
 // 将原来的声明
 // char *coco_cls_to_name(int cls_id);
 // 改为：
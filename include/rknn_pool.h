@@ -0,0 +1,81 @@
+#ifndef _RKNN_YOLOV8_DEMO_RKNN_POOL_H_
+#define _RKNN_YOLOV8_DEMO_RKNN_POOL_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "yolov8.h"
+
+/**
+ * @brief 推理上下文调度策略
+ */
+typedef enum {
+    POOL_SCHEDULE_ROUND_ROBIN = 0,  // 按顺序轮流分配，目标上下文忙时等待
+    POOL_SCHEDULE_LEAST_LOADED,     // 分配当前空闲且累计处理帧数最少的上下文
+} pool_schedule_policy_t;
+
+/**
+ * @brief NPU多核推理上下文池
+ *
+ * 通过rknn_dup_context复制基础上下文（共享权重），每个副本持有自己的输入输出属性和缓冲区，
+ * 并通过rknn_set_core_mask绑定到RK3588的一个NPU核心（RKNN_NPU_CORE_0/1/2）。基础上下文不参与池中的推理，
+ * 也不会被改动。inference()可被多个线程同时调用，每一帧由调度器分配到一个空闲的上下文上执行。
+ */
+class RknnContextPool
+{
+public:
+    RknnContextPool();
+    ~RknnContextPool();
+
+    /**
+     * @brief 初始化上下文池
+     * @param base_ctx 已通过init_yolov8_model初始化的上下文，池中的上下文都从它复制，所有权仍归调用者，
+     *                 必须在池销毁之后才能释放
+     * @param num_contexts 上下文数量（一般等于NPU核心数）
+     * @param policy 调度策略
+     * @return 成功返回0，失败返回-1
+     */
+    int init(rknn_app_context_t* base_ctx, int num_contexts, pool_schedule_policy_t policy);
+
+    /**
+     * @brief 销毁池中复制出来的上下文及其属性和缓冲区（基础上下文由调用者通过release_yolov8_model释放）
+     */
+    void deinit();
+
+    /**
+     * @brief 线程安全的推理入口，行为与inference_yolov8_model一致
+     */
+    int inference(image_buffer_t* img, object_detect_result_list* od_results);
+
+    /**
+     * @brief 获取/归还一个上下文，用于流水线中只执行部分阶段的场景
+     */
+    rknn_app_context_t* acquire();
+    void release(rknn_app_context_t* app_ctx);
+
+    int size() const { return (int)slots_.size(); }
+
+    void print_stats();
+
+private:
+    struct PoolSlot {
+        rknn_app_context_t app_ctx;
+        bool busy;
+        int64_t frames;
+        int64_t busy_us;
+        int64_t acquire_us;
+    };
+
+    int pick_slot_locked();
+
+    std::vector<PoolSlot> slots_;
+    pool_schedule_policy_t policy_;
+    uint64_t next_slot_;
+    std::mutex mutex_;
+    std::condition_variable slot_freed_;
+};
+
+#endif //_RKNN_YOLOV8_DEMO_RKNN_POOL_H_
@@ -0,0 +1,52 @@
+#ifndef _RKNN_YOLOV8_DEMO_RKNN_RECORD_H_
+#define _RKNN_YOLOV8_DEMO_RKNN_RECORD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "rknn_api.h"
+
+/**
+ * @brief 录制的模型输出：板端推理的tensor属性和每帧输出，用于在没有NPU的主机上回放
+ *
+ * 文件格式（小端）：
+ *   "RKNNREC\0" | version | sizeof(rknn_tensor_attr) | n_input | n_output | want_float | frame_count
+ *   | input_attrs[n_input] | output_attrs[n_output]
+ *   | 每帧: 每个输出 { uint32 size | size字节数据 }
+ * tensor属性按结构体原样保存，录制端与回放端都是LP64时布局一致（aarch64/x86_64）。
+ */
+struct RknnRecording {
+    rknn_input_output_num io_num;
+    std::vector<rknn_tensor_attr> input_attrs;
+    std::vector<rknn_tensor_attr> output_attrs;
+    bool want_float;                                    // 输出是否由runtime转换为float
+    std::vector<std::vector<std::vector<uint8_t> > > frames;  // [帧][输出] -> 数据
+
+    RknnRecording() : want_float(false) { io_num.n_input = 0; io_num.n_output = 0; }
+};
+
+/**
+ * @brief 保存录制结果
+ * @return 成功返回0，失败返回-1
+ */
+int save_rknn_recording(const char* path, const RknnRecording& rec);
+
+/**
+ * @brief 读取录制结果
+ * @return 成功返回0，文件不存在或格式不符返回-1
+ */
+int load_rknn_recording(const char* path, RknnRecording* rec);
+
+/**
+ * @brief 从内存读取录制结果（例如rknn_init收到的模型数据就是录制文件）
+ * @return 成功返回0，格式不符返回-1
+ */
+int load_rknn_recording_from_memory(const void* data, size_t size, RknnRecording* rec);
+
+/**
+ * @brief 数据是否以录制文件的magic开头
+ */
+bool is_rknn_recording(const void* data, size_t size);
+
+#endif //_RKNN_YOLOV8_DEMO_RKNN_RECORD_H_
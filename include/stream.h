@@ -0,0 +1,47 @@
+#ifndef _RKNN_YOLOV8_DEMO_STREAM_H_
+#define _RKNN_YOLOV8_DEMO_STREAM_H_
+
+#include "yolov8.h"
+
+/**
+ * @brief 推理跟不上数据源帧率时的帧处理策略
+ */
+typedef enum {
+    STREAM_POLICY_LATEST = 0,   // 只保留最新一帧，推理完成后总是处理最新画面，延迟最低
+    STREAM_POLICY_QUEUE,        // 有界队列，满时丢弃最旧的帧，延迟不超过queue_depth帧
+    STREAM_POLICY_BLOCK,        // 有界队列，满时读取线程等待（不丢帧），适合离线文件
+} stream_policy_t;
+
+/**
+ * @brief 流式输入配置
+ */
+typedef struct {
+    stream_policy_t policy;
+    int queue_depth;    // QUEUE/BLOCK策略下的队列容量
+    int raw_width;      // 原始YUV帧尺寸，其他数据源忽略
+    int raw_height;
+    double fps;         // 文件数据源的回放帧率：<0使用源自身帧率（未知时30），0表示不限速
+    int max_frames;     // 最多读取的帧数，0表示读到数据源结束
+    bool save_output;   // 是否将绘制结果保存到输出目录
+} stream_config_t;
+
+/**
+ * @brief 填充默认配置：latest策略，按源帧率回放，不保存结果
+ */
+void init_stream_config(stream_config_t* config);
+
+/**
+ * @brief 解析帧处理策略，格式为"latest"、"queue[:N]"或"block[:N]"
+ * @return 成功返回0，格式错误返回-1
+ */
+int parse_stream_policy(const char* spec, stream_config_t* config);
+
+/**
+ * @brief 读取数据源并逐帧推理，读取线程与推理线程通过策略指定的队列连接
+ * @param uri 数据源地址，见create_frame_source
+ * @param output_dir 结果图像保存目录（save_output为true时使用）
+ * @return 成功处理的帧数，数据源打开失败返回-1
+ */
+int run_stream(rknn_app_context_t* app_ctx, const char* uri, const char* output_dir, const stream_config_t* config);
+
+#endif //_RKNN_YOLOV8_DEMO_STREAM_H_
@@ -6,7 +6,42 @@
 #include "rknn_api.h"
 #include "common.h"
 
+/**
+ * @brief 模型输入输出方式
+ */
+typedef enum {
+    YOLOV8_IO_COPY = 0,         // rknn_inputs_set/rknn_outputs_get，数据在用户缓冲区和runtime之间拷贝
+    YOLOV8_IO_ZERO_COPY,        // rknn_create_mem2 + rknn_set_io_mem，预处理和后处理直接读写NPU tensor内存
+} yolov8_io_mode_t;
 
+/**
+ * @brief 模型文件加载方式
+ */
+typedef enum {
+    YOLOV8_MODEL_LOAD_MMAP = 0,     // mmap模型文件交给rknn_init，返回后解除映射，不在堆上复制整个文件
+    YOLOV8_MODEL_LOAD_READ,         // malloc + fread读入整个文件（旧方式）
+    YOLOV8_MODEL_LOAD_ZERO_COPY,    // 文件直接读入NPU分配的内存，以RKNN_FLAG_MODEL_BUFFER_ZERO_COPY初始化，
+                                    // runtime不再复制权重；runtime不支持时退回MMAP
+} yolov8_model_load_t;
+
+/**
+ * @brief 模型初始化选项
+ */
+typedef struct {
+    yolov8_io_mode_t io_mode;
+    yolov8_model_load_t model_load;
+    int model_map_flags;            // MMAP方式的FILE_MAP_POPULATE/FILE_MAP_WILLNEED（file_utils.h），0为按需缺页
+    rknn_context share_weight_ctx;  // 非0时以RKNN_FLAG_SHARE_WEIGHT_MEM初始化，与该上下文共享权重（同一套权重导出的模型）；
+                                    // 该上下文必须在本上下文释放之后才能释放
+} yolov8_init_options_t;
+
+/**
+ * @brief 动态形状模型的一个输入档位
+ */
+typedef struct {
+    int width;
+    int height;
+} yolov8_shape_t;
 
 typedef struct {
     rknn_context rknn_ctx;
@@ -18,7 +53,17 @@ typedef struct {
     int model_channel;
     int model_width;
     int model_height;
-    bool is_quant;
+    int batch;                      // 输入的第0维；大于1的多batch模型只能通过BatchInferencer（batch_infer.h）推理
+    bool is_quant;                  // 输出为INT8或UINT8量化数据（want_float=0），否则为float32
+    image_buffer_t input_image;     // 预分配的模型输入（letterbox结果）
+    rknn_output* outputs;           // 预分配的模型输出，is_prealloc方式获取
+    yolov8_io_mode_t io_mode;
+    rknn_tensor_mem* input_mem;     // 零拷贝模式下的输入tensor内存，input_image直接指向它
+    rknn_tensor_mem** output_mems;  // 零拷贝模式下的输出tensor内存，outputs[i].buf直接指向它
+    rknn_tensor_mem* model_mem;     // ZERO_COPY加载时的模型内存，runtime直接引用，rknn_destroy之后释放
+    yolov8_shape_t* shapes;         // 动态形状模型的输入档位，按面积从小到大排列；静态模型为NULL
+    int shape_num;
+    int shape_index;                // 当前档位，input_attrs/output_attrs/model_width/model_height与之对应
 } rknn_app_context_t;
 
 #include "postprocess.h"
@@ -26,8 +71,48 @@ typedef struct {
 
 int init_yolov8_model(const char* model_path, rknn_app_context_t* app_ctx);
 
+// opts为NULL时等同于init_yolov8_model（拷贝模式，mmap加载模型）；失败时已释放全部资源，再调用release_yolov8_model也是安全的
+int init_yolov8_model_ex(const char* model_path, rknn_app_context_t* app_ctx, const yolov8_init_options_t* opts);
+
+// 解析模型加载方式：read | mmap | populate（mmap并预读所有页面） | zero-copy，成功返回0
+int parse_yolov8_model_load(const char* spec, yolov8_init_options_t* opts);
+
 int release_yolov8_model(rknn_app_context_t* app_ctx);
 
+// od_results需先通过init_detect_result_list初始化，多帧复用同一个列表可避免重复分配
 int inference_yolov8_model(rknn_app_context_t* app_ctx, image_buffer_t* img, object_detect_result_list* od_results);
 
+// 动态形状模型：选择能以最大缩放比例容纳图像的最小档位（例如16:9的帧在640x640和640x384中选640x384），
+// 静态模型返回-1
+int select_yolov8_shape(rknn_app_context_t* app_ctx, int img_width, int img_height);
+
+// 模型能接受的最大输入宽高：静态模型为model_width/model_height，动态形状模型取所有档位的最大值，
+// 用于确定缩小解码的尺寸
+void get_yolov8_max_input_size(const rknn_app_context_t* app_ctx, int* width, int* height);
+
+// 切换到第index个档位：rknn_set_input_shapes后刷新输入输出属性和模型尺寸，后处理据此计算网格和步长。
+// 缓冲区按最大档位分配，切换时不重新分配。inference_yolov8_model按每帧尺寸自动切换，
+// 分阶段接口（流水线/异步）始终使用当前档位
+int set_yolov8_shape(rknn_app_context_t* app_ctx, int index);
+
+// 分配/释放上下文持有的输入输出缓冲区，init_yolov8_model/release_yolov8_model中自动调用；
+// 复制上下文（如RknnContextPool）时需要为每个副本单独分配
+int init_yolov8_io_buffers(rknn_app_context_t* app_ctx);
+
+void release_yolov8_io_buffers(rknn_app_context_t* app_ctx);
+
+// 分阶段接口：供流水线模式使用，每个阶段可以在不同线程中执行
+int get_yolov8_output_size(rknn_app_context_t* app_ctx, int index);
+
+int preprocess_yolov8_model(rknn_app_context_t* app_ctx, image_buffer_t* img, image_buffer_t* dst_img, letterbox_t* letter_box);
+
+int run_yolov8_model(rknn_app_context_t* app_ctx, image_buffer_t* dst_img, rknn_output* outputs);
+
+// 异步接口：submit设置输入后以non_block方式启动推理并立即返回runtime分配的frame_id，
+// wait通过rknn_wait等待该帧完成并取出输出。两次调用之间NPU在运行，CPU可以处理其它帧；
+// 同一上下文同一时间只能有一帧在运行，下一次submit前必须先wait
+int submit_yolov8_model(rknn_app_context_t* app_ctx, image_buffer_t* dst_img, uint64_t* frame_id);
+
+int wait_yolov8_model(rknn_app_context_t* app_ctx, uint64_t frame_id, rknn_output* outputs);
+
 #endif //_RKNN_DEMO_YOLOV8_H_
\ No newline at end of file
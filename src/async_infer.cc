@@ -0,0 +1,216 @@
+/**
+ * @file async_infer.cc
+ * @brief 异步推理：NPU执行当前帧期间，CPU完成下一帧的预处理和上一帧的后处理
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "async_infer.h"
+#include "image_utils.h"
+#include "perf_stats.h"
+#include "log_utils.h"
+
+static int64_t async_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AsyncInferencer::AsyncInferencer()
+    : app_ctx_(NULL), depth_(1), pending_(0), next_seq_(0), stop_(false), running_(false)
+{
+    memset(&input_image_, 0, sizeof(input_image_));
+    memset(&od_results_, 0, sizeof(od_results_));
+}
+
+AsyncInferencer::~AsyncInferencer()
+{
+    deinit();
+}
+
+int AsyncInferencer::init(rknn_app_context_t* app_ctx, int depth)
+{
+    if (app_ctx == NULL || app_ctx->rknn_ctx == 0 || running_)
+    {
+        return -1;
+    }
+    app_ctx_ = app_ctx;
+    depth_ = depth > 0 ? depth : 1;
+
+    // 输入输出缓冲区归本对象所有：零拷贝模式下上下文的tensor内存在NPU运行期间不能改写
+    input_image_.width = app_ctx->model_width;
+    input_image_.height = app_ctx->model_height;
+    input_image_.format = IMAGE_FORMAT_RGB888;
+    input_image_.size = get_image_size(&input_image_);
+    input_image_.virt_addr = (unsigned char*)malloc(input_image_.size);
+    outputs_.resize(app_ctx->io_num.n_output);
+    memset(outputs_.data(), 0, outputs_.size() * sizeof(rknn_output));
+    bool ok = input_image_.virt_addr != NULL;
+    for (size_t i = 0; ok && i < outputs_.size(); i++)
+    {
+        outputs_[i].size = get_yolov8_output_size(app_ctx, i);
+        outputs_[i].buf = malloc(outputs_[i].size);
+        ok = outputs_[i].buf != NULL;
+    }
+    init_detect_result_list(&od_results_, 0);
+    if (!ok)
+    {
+        LOGE("AsyncInferencer: alloc io buffers fail");
+        deinit();
+        return -1;
+    }
+
+    stop_ = false;
+    pending_ = 0;
+    running_ = true;
+    thread_ = std::thread(&AsyncInferencer::driver_loop, this);
+    return 0;
+}
+
+int64_t AsyncInferencer::submit(image_buffer_t* img, const AsyncInferCallback& callback)
+{
+    if (img == NULL)
+    {
+        return -1;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cond_.wait(lock, [this] { return stop_ || pending_ < depth_; });
+    if (stop_ || !running_)
+    {
+        return -1;
+    }
+    AsyncJob* job = new AsyncJob();
+    job->seq = next_seq_++;
+    job->frame_id = 0;
+    job->img = img;
+    job->callback = callback;
+    job->submit_us = async_now_us();
+    jobs_.push_back(job);
+    pending_++;
+    job_cond_.notify_one();
+    return job->seq;
+}
+
+void AsyncInferencer::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cond_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void AsyncInferencer::deinit()
+{
+    if (running_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        job_cond_.notify_all();
+        done_cond_.notify_all();
+        thread_.join();
+        running_ = false;
+    }
+    free_image_buffer(&input_image_);
+    for (size_t i = 0; i < outputs_.size(); i++)
+    {
+        free(outputs_[i].buf);
+    }
+    outputs_.clear();
+    free_detect_result_list(&od_results_);
+}
+
+AsyncInferencer::AsyncJob* AsyncInferencer::take_job(bool block)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (block)
+    {
+        job_cond_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+    }
+    if (jobs_.empty())
+    {
+        return NULL;
+    }
+    AsyncJob* job = jobs_.front();
+    jobs_.pop_front();
+    return job;
+}
+
+void AsyncInferencer::finish_job(AsyncJob* job, int ret)
+{
+    reset_detect_result_list(&od_results_);
+    if (ret == 0)
+    {
+        post_process(app_ctx_, outputs_.data(), &job->letter_box, BOX_THRESH, NMS_THRESH, &od_results_);
+    }
+
+    AsyncInferResult result;
+    result.seq = job->seq;
+    result.frame_id = job->frame_id;
+    result.ret = ret;
+    result.img = job->img;
+    result.od_results = &od_results_;
+    result.latency_us = async_now_us() - job->submit_us;
+    if (job->callback)
+    {
+        job->callback(result);
+    }
+    delete job;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_--;
+    done_cond_.notify_all();
+}
+
+// 每轮：预处理新帧（NPU仍在运行上一帧）-> 等待上一帧并取回输出 -> 提交新帧 -> 上一帧后处理及回调（NPU运行新帧）
+void AsyncInferencer::driver_loop()
+{
+    AsyncJob* running = NULL;
+    int64_t submit_ns = 0;
+    for (;;)
+    {
+        // NPU空闲时阻塞等待新帧；NPU忙而没有新帧时不等待，直接取回当前帧，避免增加延迟
+        AsyncJob* next = take_job(running == NULL);
+        if (next == NULL && running == NULL)
+        {
+            break;
+        }
+
+        int next_ret = 0;
+        if (next != NULL)
+        {
+            next_ret = preprocess_yolov8_model(app_ctx_, next->img, &input_image_, &next->letter_box);
+        }
+
+        AsyncJob* done = running;
+        int done_ret = 0;
+        running = NULL;
+        if (done != NULL)
+        {
+            done_ret = wait_yolov8_model(app_ctx_, done->frame_id, outputs_.data());
+            perf_record(PERF_RUN, perf_now_ns() - submit_ns);
+        }
+
+        if (next != NULL && next_ret == 0)
+        {
+            submit_ns = perf_now_ns();
+            next_ret = submit_yolov8_model(app_ctx_, &input_image_, &next->frame_id);
+            if (next_ret == 0)
+            {
+                running = next;
+            }
+        }
+
+        if (done != NULL)
+        {
+            finish_job(done, done_ret);
+        }
+        if (next != NULL && running != next)
+        {
+            finish_job(next, -1);
+        }
+    }
+}
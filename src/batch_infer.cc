@@ -0,0 +1,354 @@
+/**
+ * @file batch_infer.cc
+ * @brief 多batch推理：多帧合并为一次NPU推理，分摊每次rknn_run的固定开销
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "batch_infer.h"
+#include "image_utils.h"
+#include "perf_stats.h"
+#include "log_utils.h"
+
+static int64_t batch_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void init_batch_infer_config(batch_infer_config_t* config)
+{
+    config->max_batch = 0;
+    config->timeout_us = 2000;
+    config->batch_core_num = 0;
+    config->queue_depth = 0;
+}
+
+BatchInferencer::BatchInferencer()
+    : app_ctx_(NULL), model_batch_(1), max_batch_(1), timeout_us_(0), queue_depth_(1), frame_input_size_(0),
+      pending_(0), next_seq_(0), stop_(false), running_(false)
+{
+    memset(&od_results_, 0, sizeof(od_results_));
+    stats_.batches = 0;
+    stats_.frames = 0;
+    stats_.queue_us_max = 0;
+    stats_.queue_us_sum = 0;
+}
+
+BatchInferencer::~BatchInferencer()
+{
+    deinit();
+}
+
+int BatchInferencer::init(rknn_app_context_t* app_ctx, const batch_infer_config_t* config)
+{
+    if (app_ctx == NULL || app_ctx->rknn_ctx == 0 || running_)
+    {
+        return -1;
+    }
+    if (app_ctx->io_mode != YOLOV8_IO_COPY)
+    {
+        LOGE("BatchInferencer: context must use copy io mode");
+        return -1;
+    }
+    batch_infer_config_t default_config;
+    if (config == NULL)
+    {
+        init_batch_infer_config(&default_config);
+        config = &default_config;
+    }
+    app_ctx_ = app_ctx;
+    model_batch_ = std::max(1, app_ctx->batch);
+    max_batch_ = config->max_batch > 0 ? std::min(config->max_batch, model_batch_) : model_batch_;
+    timeout_us_ = std::max<int64_t>(0, config->timeout_us);
+    queue_depth_ = std::max(max_batch_, config->queue_depth > 0 ? config->queue_depth : 2 * max_batch_);
+
+    if (config->batch_core_num > 0)
+    {
+        int ret = rknn_set_batch_core_num(app_ctx->rknn_ctx, config->batch_core_num);
+        if (ret != RKNN_SUCC)
+        {
+            // 单核平台不支持，batch仍在一个核心上执行
+            LOGW("rknn_set_batch_core_num(%d) fail! ret=%d", config->batch_core_num, ret);
+        }
+    }
+
+    // 输入输出缓冲区归本对象所有，按模型batch分配；每帧输出是整个输出的连续1/batch
+    frame_input_size_ = (size_t)app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
+    input_.assign(frame_input_size_ * model_batch_, 0);
+    staging_.resize(frame_input_size_ * queue_depth_);
+    free_inputs_.clear();
+    for (int i = 0; i < queue_depth_; i++)
+    {
+        free_inputs_.push_back(staging_.data() + i * frame_input_size_);
+    }
+    outputs_.resize(app_ctx->io_num.n_output);
+    frame_outputs_.resize(app_ctx->io_num.n_output);
+    memset(outputs_.data(), 0, outputs_.size() * sizeof(rknn_output));
+    bool ok = true;
+    for (size_t i = 0; ok && i < outputs_.size(); i++)
+    {
+        outputs_[i].index = i;
+        outputs_[i].want_float = !app_ctx->is_quant;
+        outputs_[i].is_prealloc = 1;
+        outputs_[i].size = get_yolov8_output_size(app_ctx, i);
+        outputs_[i].buf = malloc(outputs_[i].size);
+        ok = outputs_[i].buf != NULL;
+    }
+    init_detect_result_list(&od_results_, 0);
+    if (!ok)
+    {
+        LOGE("BatchInferencer: alloc io buffers fail");
+        deinit();
+        return -1;
+    }
+
+    stats_.batches = 0;
+    stats_.frames = 0;
+    stats_.fill.assign(max_batch_ + 1, 0);
+    stats_.queue_us_max = 0;
+    stats_.queue_us_sum = 0;
+    stop_ = false;
+    pending_ = 0;
+    running_ = true;
+    thread_ = std::thread(&BatchInferencer::driver_loop, this);
+    printf("batch inferencer: batch=%d (model %d), timeout=%lld us\n", max_batch_, model_batch_,
+           (long long)timeout_us_);
+    return 0;
+}
+
+int64_t BatchInferencer::submit(image_buffer_t* img, const BatchInferCallback& callback)
+{
+    if (img == NULL)
+    {
+        return -1;
+    }
+    int64_t submit_us = batch_now_us();
+    unsigned char* input;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cond_.wait(lock, [this] { return stop_ || pending_ < queue_depth_; });
+        if (stop_ || !running_)
+        {
+            return -1;
+        }
+        pending_++;
+        input = free_inputs_.back();
+        free_inputs_.pop_back();
+    }
+
+    // letterbox在调用线程中完成，不占用后台线程
+    BatchJob* job = new BatchJob();
+    job->img = img;
+    job->input = input;
+    job->callback = callback;
+    job->submit_us = submit_us;
+    image_buffer_t dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.virt_addr = input;
+    int ret = preprocess_yolov8_model(app_ctx_, img, &dst, &job->letter_box);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ret < 0)
+    {
+        free_inputs_.push_back(input);
+        pending_--;
+        done_cond_.notify_all();
+        delete job;
+        return -1;
+    }
+    job->seq = next_seq_++;
+    jobs_.push_back(job);
+    job_cond_.notify_one();
+    return job->seq;
+}
+
+void BatchInferencer::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cond_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void BatchInferencer::deinit()
+{
+    if (running_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        job_cond_.notify_all();
+        done_cond_.notify_all();
+        thread_.join();
+        running_ = false;
+    }
+    input_.clear();
+    staging_.clear();
+    free_inputs_.clear();
+    for (size_t i = 0; i < outputs_.size(); i++)
+    {
+        free(outputs_[i].buf);
+    }
+    outputs_.clear();
+    frame_outputs_.clear();
+    free_detect_result_list(&od_results_);
+}
+
+void BatchInferencer::get_stats(batch_infer_stats_t* stats)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    *stats = stats_;
+}
+
+void BatchInferencer::print_stats()
+{
+    batch_infer_stats_t stats;
+    get_stats(&stats);
+    printf("batch inferencer: %llu frames in %llu runs, mean batch %.2f, queue mean %.2f ms max %.2f ms\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.batches,
+           stats.batches > 0 ? (double)stats.frames / stats.batches : 0.0,
+           stats.frames > 0 ? stats.queue_us_sum / 1e3 / stats.frames : 0.0, stats.queue_us_max / 1e3);
+    printf("  batch fill:");
+    for (size_t n = 1; n < stats.fill.size(); n++)
+    {
+        printf(" %zu:%llu", n, (unsigned long long)stats.fill[n]);
+    }
+    printf("\n");
+}
+
+// 取出一个batch：队列为空时等待第一帧，之后最多等到第一帧提交后timeout_us，或凑满max_batch帧
+bool BatchInferencer::take_batch(std::vector<BatchJob*>* batch)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_cond_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+    if (jobs_.empty())
+    {
+        return false;
+    }
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point(std::chrono::microseconds(jobs_.front()->submit_us + timeout_us_));
+    job_cond_.wait_until(lock, deadline, [this] { return stop_ || (int)jobs_.size() >= max_batch_; });
+
+    int n = std::min((int)jobs_.size(), max_batch_);
+    batch->assign(jobs_.begin(), jobs_.begin() + n);
+    jobs_.erase(jobs_.begin(), jobs_.begin() + n);
+    return true;
+}
+
+int BatchInferencer::run_batch(std::vector<BatchJob*>& batch)
+{
+    int ret;
+    rknn_context ctx = app_ctx_->rknn_ctx;
+
+    // submit时的letterbox结果拷贝到batch输入中各自的位置
+    int64_t t0 = perf_now_ns();
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        memcpy(input_.data() + i * frame_input_size_, batch[i]->input, frame_input_size_);
+    }
+    rknn_input inputs[app_ctx_->io_num.n_input];
+    memset(inputs, 0, sizeof(inputs));
+    inputs[0].index = 0;
+    inputs[0].type = RKNN_TENSOR_UINT8;
+    inputs[0].fmt = RKNN_TENSOR_NHWC;
+    inputs[0].size = input_.size();
+    inputs[0].buf = input_.data();
+    ret = rknn_inputs_set(ctx, app_ctx_->io_num.n_input, inputs);
+    if (ret < 0)
+    {
+        LOGE("rknn_inputs_set (batch) fail! ret=%d", ret);
+        return -1;
+    }
+    int64_t t1 = perf_now_ns();
+    perf_record(PERF_INPUTS_SET, t1 - t0);
+
+    ret = rknn_run(ctx, nullptr);
+    if (ret < 0)
+    {
+        LOGE("rknn_run (batch) fail! ret=%d", ret);
+        return -1;
+    }
+    int64_t t2 = perf_now_ns();
+    perf_record(PERF_RUN, t2 - t1);
+
+    ret = rknn_outputs_get(ctx, app_ctx_->io_num.n_output, outputs_.data(), NULL);
+    if (ret < 0)
+    {
+        LOGE("rknn_outputs_get (batch) fail! ret=%d", ret);
+        return -1;
+    }
+    rknn_outputs_release(ctx, app_ctx_->io_num.n_output, outputs_.data());
+    perf_record(PERF_OUTPUTS_GET, perf_now_ns() - t2);
+    return 0;
+}
+
+void BatchInferencer::driver_loop()
+{
+    std::vector<BatchJob*> batch;
+    while (take_batch(&batch))
+    {
+        int64_t start_us = batch_now_us();
+        int64_t queue_us_max = 0;
+        int64_t queue_us_sum = 0;
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            int64_t queue_us = start_us - batch[i]->submit_us;
+            perf_record(PERF_BATCH_WAIT, queue_us * 1000);
+            queue_us_max = std::max(queue_us_max, queue_us);
+            queue_us_sum += queue_us;
+        }
+
+        int ret = run_batch(batch);
+
+        // 按batch下标切分输出：[B, C, H, W]中第i帧是连续的1/B
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            BatchJob* job = batch[i];
+            reset_detect_result_list(&od_results_);
+            if (ret == 0)
+            {
+                for (size_t k = 0; k < outputs_.size(); k++)
+                {
+                    uint32_t frame_size = outputs_[k].size / model_batch_;
+                    frame_outputs_[k] = outputs_[k];
+                    frame_outputs_[k].size = frame_size;
+                    frame_outputs_[k].buf = (unsigned char*)outputs_[k].buf + i * frame_size;
+                }
+                post_process(app_ctx_, frame_outputs_.data(), &job->letter_box, BOX_THRESH, NMS_THRESH,
+                             &od_results_);
+            }
+
+            BatchInferResult result;
+            result.seq = job->seq;
+            result.ret = ret;
+            result.img = job->img;
+            result.od_results = &od_results_;
+            result.batch_size = batch.size();
+            result.queue_us = start_us - job->submit_us;
+            result.latency_us = batch_now_us() - job->submit_us;
+            if (job->callback)
+            {
+                job->callback(result);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            free_inputs_.push_back(batch[i]->input);
+            delete batch[i];
+        }
+        stats_.batches++;
+        stats_.frames += batch.size();
+        stats_.fill[batch.size()]++;
+        stats_.queue_us_max = std::max(stats_.queue_us_max, queue_us_max);
+        stats_.queue_us_sum += queue_us_sum;
+        pending_ -= batch.size();
+        done_cond_.notify_all();
+    }
+}
@@ -0,0 +1,302 @@
+/**
+ * @file folder_scan.cc
+ * @brief 文件夹扫描（排序、扩展名不区分大小写、可递归并行）及断点续跑检查点
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+#include "folder_scan.h"
+#include "log_utils.h"
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = {'Y', 'O', 'L', 'O', 'C', 'K', 'P', 'T'};
+const uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+/**
+ * @brief 并行扫描的共享状态：待读取的目录栈，所有线程都空闲且栈为空时扫描结束
+ */
+struct ScanState {
+    std::string root;
+    bool recursive;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::string> dirs;   // 相对root的目录，""表示root
+    int active;
+    std::vector<std::string> files;
+};
+
+std::string join_path(const std::string& dir, const char* name)
+{
+    return dir.empty() ? std::string(name) : dir + "/" + name;
+}
+
+// 读取一个目录，返回其中的图像文件和子目录
+void read_dir(const ScanState& state, const std::string& rel_dir, std::vector<std::string>& files,
+              std::vector<std::string>& subdirs)
+{
+    std::string abs_dir = rel_dir.empty() ? state.root : state.root + "/" + rel_dir;
+    DIR* dir = opendir(abs_dir.c_str());
+    if (dir == NULL)
+    {
+        LOGW("scan: cannot open %s: %s", abs_dir.c_str(), strerror(errno));
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        {
+            continue;
+        }
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN || type == DT_LNK)
+        {
+            // 部分文件系统不提供d_type；符号链接按目标类型处理，但不进入链接的目录，避免循环
+            struct stat st;
+            std::string abs_path = abs_dir + "/" + name;
+            if (stat(abs_path.c_str(), &st) != 0)
+            {
+                continue;
+            }
+            type = S_ISREG(st.st_mode) ? DT_REG : (S_ISDIR(st.st_mode) && entry->d_type != DT_LNK ? DT_DIR : 0);
+        }
+        if (type == DT_DIR)
+        {
+            if (state.recursive)
+            {
+                subdirs.push_back(join_path(rel_dir, name));
+            }
+        }
+        else if (type == DT_REG && is_image_file_name(name))
+        {
+            files.push_back(join_path(rel_dir, name));
+        }
+    }
+    closedir(dir);
+}
+
+void scan_worker(ScanState* state)
+{
+    std::vector<std::string> files;
+    std::vector<std::string> subdirs;
+    for (;;)
+    {
+        std::string rel_dir;
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->cond.wait(lock, [state] { return !state->dirs.empty() || state->active == 0; });
+            if (state->dirs.empty())
+            {
+                return;
+            }
+            rel_dir = state->dirs.back();
+            state->dirs.pop_back();
+            state->active++;
+        }
+
+        files.clear();
+        subdirs.clear();
+        read_dir(*state, rel_dir, files, subdirs);
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->files.insert(state->files.end(), files.begin(), files.end());
+        state->dirs.insert(state->dirs.end(), subdirs.begin(), subdirs.end());
+        state->active--;
+        state->cond.notify_all();
+    }
+}
+
+} // namespace
+
+void init_folder_scan_options(folder_scan_options_t* opts)
+{
+    opts->recursive = false;
+    opts->threads = 4;
+}
+
+bool is_image_file_name(const char* name)
+{
+    const char* dot = strrchr(name, '.');
+    if (dot == NULL)
+    {
+        return false;
+    }
+    return strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0 || strcasecmp(dot, ".png") == 0;
+}
+
+int scan_image_folder(const std::string& root, const folder_scan_options_t* opts, std::vector<std::string>* files)
+{
+    struct stat st;
+    if (stat(root.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        LOGE("scan: %s is not a directory", root.c_str());
+        return -1;
+    }
+
+    ScanState state;
+    state.root = root;
+    state.recursive = opts->recursive;
+    state.active = 0;
+    state.dirs.push_back("");
+
+    // 不递归时只有一个目录，不需要额外线程
+    int threads = opts->recursive ? std::max(1, opts->threads) : 1;
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers.push_back(std::thread(scan_worker, &state));
+    }
+    scan_worker(&state);
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+
+    std::sort(state.files.begin(), state.files.end());
+    files->swap(state.files);
+    return (int)files->size();
+}
+
+int create_dirs(const std::string& path)
+{
+    for (size_t pos = 1; pos <= path.size(); pos++)
+    {
+        if (pos == path.size() || path[pos] == '/')
+        {
+            std::string dir = path.substr(0, pos);
+            if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                LOGE("mkdir %s fail: %s", dir.c_str(), strerror(errno));
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+FolderCheckpoint::FolderCheckpoint() : fp_(NULL) {}
+
+FolderCheckpoint::~FolderCheckpoint()
+{
+    close();
+}
+
+int FolderCheckpoint::open(const char* path)
+{
+    close();
+    done_.clear();
+
+    FILE* fp = fopen(path, "rb");
+    if (fp != NULL)
+    {
+        CheckpointHeader header;
+        size_t n = fread(&header, 1, sizeof(header), fp);
+        if (n > 0 && (n != sizeof(header) || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+                      header.version != CHECKPOINT_VERSION))
+        {
+            LOGE("checkpoint: %s is not a checkpoint file", path);
+            fclose(fp);
+            return -1;
+        }
+        uint64_t records[1024];
+        while ((n = fread(records, sizeof(uint64_t), 1024, fp)) > 0)
+        {
+            done_.insert(records, records + n);
+        }
+        fclose(fp);
+    }
+
+    fp_ = fopen(path, "ab");
+    if (fp_ == NULL)
+    {
+        LOGE("checkpoint: cannot write %s: %s", path, strerror(errno));
+        return -1;
+    }
+    // 追加模式下从文件末尾写入；新文件先写头，不完整的结尾记录被截断对齐到8字节
+    long size = ftell(fp_);
+    if (size <= 0)
+    {
+        CheckpointHeader header;
+        memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        header.version = CHECKPOINT_VERSION;
+        header.reserved = 0;
+        fwrite(&header, sizeof(header), 1, fp_);
+        fflush(fp_);
+    }
+    else if ((size - (long)sizeof(CheckpointHeader)) % sizeof(uint64_t) != 0)
+    {
+        long aligned = size - (size - (long)sizeof(CheckpointHeader)) % sizeof(uint64_t);
+        if (truncate(path, aligned) != 0)
+        {
+            LOGE("checkpoint: cannot repair %s: %s", path, strerror(errno));
+            fclose(fp_);
+            fp_ = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void FolderCheckpoint::close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fp_ != NULL)
+    {
+        fclose(fp_);
+        fp_ = NULL;
+    }
+}
+
+bool FolderCheckpoint::is_done(const std::string& rel_path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_.count(hash_path(rel_path)) > 0;
+}
+
+void FolderCheckpoint::mark_done(const std::string& rel_path)
+{
+    uint64_t hash = hash_path(rel_path);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!done_.insert(hash).second || fp_ == NULL)
+    {
+        return;
+    }
+    fwrite(&hash, sizeof(hash), 1, fp_);
+    fflush(fp_);
+}
+
+size_t FolderCheckpoint::size()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_.size();
+}
+
+uint64_t FolderCheckpoint::hash_path(const std::string& rel_path)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < rel_path.size(); i++)
+    {
+        hash ^= (unsigned char)rel_path[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
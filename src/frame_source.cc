@@ -0,0 +1,191 @@
+/**
+ * @file frame_source.cc
+ * @brief 视频帧数据源：OpenCV VideoCapture及原始YUV420SP帧序列
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+#include "frame_source.h"
+
+#include <opencv2/opencv.hpp>
+
+namespace {
+
+// 3rdparty中预编译的OpenCV未包含videoio模块，此时只支持原始YUV帧序列
+#ifdef HAVE_OPENCV_VIDEOIO
+/**
+ * @brief 通过OpenCV读取视频文件、V4L2设备或网络流，输出RGB888
+ */
+class VideoCaptureSource : public FrameSource
+{
+public:
+    explicit VideoCaptureSource(const std::string& uri) : uri_(uri)
+    {
+        live_ = uri.compare(0, 10, "/dev/video") == 0 || uri.find("://") != std::string::npos;
+    }
+
+    bool open()
+    {
+        if (!capture_.open(uri_))
+        {
+            printf("Error: Cannot open video source %s\n", uri_.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    int read(image_buffer_t* image)
+    {
+        if (!capture_.read(frame_) || frame_.empty())
+        {
+            return 1;
+        }
+        if (frame_.type() != CV_8UC3)
+        {
+            printf("Error: Unsupported video frame type %d\n", frame_.type());
+            return -1;
+        }
+        memset(image, 0, sizeof(image_buffer_t));
+        image->width = frame_.cols;
+        image->height = frame_.rows;
+        image->format = IMAGE_FORMAT_RGB888;
+        image->size = frame_.cols * frame_.rows * 3;
+        image->virt_addr = (unsigned char*)malloc(image->size);
+        if (image->virt_addr == NULL)
+        {
+            return -1;
+        }
+        cv::Mat rgb(frame_.rows, frame_.cols, CV_8UC3, image->virt_addr);
+        cv::cvtColor(frame_, rgb, cv::COLOR_BGR2RGB);
+        return 0;
+    }
+
+    double fps() const
+    {
+        double fps = capture_.get(cv::CAP_PROP_FPS);
+        return fps > 0 ? fps : 0;
+    }
+
+    bool is_live() const { return live_; }
+
+private:
+    std::string uri_;
+    bool live_;
+    cv::VideoCapture capture_;
+    cv::Mat frame_;
+};
+#endif
+
+/**
+ * @brief 原始YUV420SP帧序列（摄像头/解码器输出的转储），每帧width*height*3/2字节
+ */
+class RawYuvSource : public FrameSource
+{
+public:
+    RawYuvSource(const std::string& uri, int width, int height, image_format_t format)
+        : uri_(uri), width_(width), height_(height), format_(format), fp_(NULL)
+    {
+    }
+
+    ~RawYuvSource()
+    {
+        if (fp_ != NULL)
+        {
+            fclose(fp_);
+        }
+    }
+
+    bool open()
+    {
+        if (width_ <= 0 || height_ <= 0 || (width_ & 1) || (height_ & 1))
+        {
+            printf("Error: Raw yuv source needs an even frame size, got %dx%d\n", width_, height_);
+            return false;
+        }
+        fp_ = fopen(uri_.c_str(), "rb");
+        if (fp_ == NULL)
+        {
+            printf("Error: Cannot open raw yuv file %s\n", uri_.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    int read(image_buffer_t* image)
+    {
+        int size = width_ * height_ * 3 / 2;
+        memset(image, 0, sizeof(image_buffer_t));
+        image->virt_addr = (unsigned char*)malloc(size);
+        if (image->virt_addr == NULL)
+        {
+            return -1;
+        }
+        if (fread(image->virt_addr, 1, size, fp_) != (size_t)size)
+        {
+            free(image->virt_addr);
+            image->virt_addr = NULL;
+            return 1;
+        }
+        image->width = width_;
+        image->height = height_;
+        image->width_stride = width_;
+        image->height_stride = height_;
+        image->format = format_;
+        image->size = size;
+        return 0;
+    }
+
+    double fps() const { return 0; }
+
+    bool is_live() const { return false; }
+
+private:
+    std::string uri_;
+    int width_;
+    int height_;
+    image_format_t format_;
+    FILE* fp_;
+};
+
+bool has_extension(const std::string& uri, const char* ext)
+{
+    size_t len = strlen(ext);
+    return uri.size() > len && strcasecmp(uri.c_str() + uri.size() - len, ext) == 0;
+}
+
+} // namespace
+
+FrameSource* create_frame_source(const char* uri, int raw_width, int raw_height)
+{
+    std::string path = uri;
+    if (has_extension(path, ".nv12") || has_extension(path, ".nv21") || has_extension(path, ".yuv"))
+    {
+        image_format_t format = has_extension(path, ".nv21") ? IMAGE_FORMAT_YUV420SP_NV21 : IMAGE_FORMAT_YUV420SP_NV12;
+        RawYuvSource* source = new RawYuvSource(path, raw_width, raw_height, format);
+        if (!source->open())
+        {
+            delete source;
+            return NULL;
+        }
+        return source;
+    }
+
+#ifdef HAVE_OPENCV_VIDEOIO
+    VideoCaptureSource* source = new VideoCaptureSource(path);
+    if (!source->open())
+    {
+        delete source;
+        return NULL;
+    }
+    return source;
+#else
+    printf("Error: OpenCV is built without videoio, only raw .nv12/.nv21/.yuv sources are supported: %s\n",
+           uri);
+    return NULL;
+#endif
+}
@@ -0,0 +1,209 @@
+/**
+ * @file image_io.cc
+ * @brief 基于OpenCV的图像读写及检测结果绘制
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "image_io.h"
+#include "image_utils.h"
+#include "image_drawing.h"
+#include "perf_stats.h"
+#include "log_utils.h"
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief 使用OpenCV读取图像文件并转换为image_buffer_t格式
+ * @param path 图像文件路径
+ * @param image 输出的图像缓冲区结构体指针
+ * @return 成功返回0，失败返回-1
+ * 
+ * 功能说明：
+ * 1. 使用OpenCV读取各种格式的图像文件
+ * 2. 自动处理RGBA到RGB的转换
+ * 3. 使用普通内存分配，避免DMA相关问题
+ * 4. 设置正确的图像格式和尺寸信息
+ */
+int read_image_opencv(const char* path, image_buffer_t* image) {
+    // 使用OpenCV读取图像
+    cv::Mat cv_img = cv::imread(path, cv::IMREAD_COLOR);
+    if (cv_img.empty()) {
+        LOGE("Error: Cannot read image from %s", path);
+        return -1;
+    }
+    
+    // 设置图像基本信息
+    image->width = cv_img.cols;
+    image->height = cv_img.rows;
+    int channels = cv_img.channels();
+    
+    // 根据通道数设置图像格式
+    if (channels == 3) {
+        image->format = IMAGE_FORMAT_RGB888;
+        // OpenCV默认是BGR，转换为RGB
+        cv::cvtColor(cv_img, cv_img, cv::COLOR_BGR2RGB);
+    } else if (channels == 4) {
+        image->format = IMAGE_FORMAT_RGBA8888;
+        cv::cvtColor(cv_img, cv_img, cv::COLOR_BGRA2RGBA);
+    } else if (channels == 1) {
+        image->format = IMAGE_FORMAT_GRAY8;
+    } else {
+        LOGE("Error: Unsupported image format with %d channels", channels);
+        return -1;
+    }
+    
+    // 计算图像数据大小
+    int size = cv_img.total() * cv_img.elemSize();
+    image->size = size;
+    
+    // 使用普通内存分配
+    image->virt_addr = (unsigned char*)malloc(size);
+    image->fd = 0;  // 标记为普通内存
+    
+    if (image->virt_addr == NULL) {
+        LOGE("Error: Memory allocation failed for image size %d", size);
+        return -1;
+    }
+    
+    // 复制图像数据
+    memcpy(image->virt_addr, cv_img.data, size);
+    
+    LOGD("Image loaded: %dx%d, %d channels, %d bytes", 
+           image->width, image->height, channels, size);
+    
+    return 0;
+}
+
+static bool is_jpeg_file(const char* path)
+{
+    const char* ext = strrchr(path, '.');
+    if (ext == NULL) {
+        return false;
+    }
+    return strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0;
+}
+
+/**
+ * @brief 读取模型输入用的图像
+ * 
+ * 功能说明：
+ * 大尺寸JPEG缩放到640x640前需要先完整解码为全分辨率RGB，解码和缩放都与像素数成正比。
+ * 开启fast_decode后，libjpeg-turbo在IDCT阶段直接输出1/2、1/4、1/8尺寸的图像，
+ * 选择不小于letterbox缩放比例的最小因子，后续letterbox只需做剩余的小比例缩放。
+ * 解码失败（例如扩展名为.jpg的PNG文件）时回退到OpenCV。
+ */
+int read_image_for_model(const char* path, int model_width, int model_height, bool fast_decode,
+                         image_buffer_t* image, float* decode_scale)
+{
+    PerfSpan span(PERF_READ);
+    *decode_scale = 1.0f;
+    if (fast_decode && is_jpeg_file(path)) {
+        if (read_image_jpeg_scaled(path, model_width, model_height, image, decode_scale) == 0) {
+            return 0;
+        }
+        *decode_scale = 1.0f;
+    }
+    return read_image_opencv(path, image);
+}
+
+void restore_detect_results_scale(object_detect_result_list* od_results, float decode_scale)
+{
+    if (decode_scale <= 0.0f || decode_scale == 1.0f) {
+        return;
+    }
+    for (int i = 0; i < od_results->count; i++) {
+        image_rect_t* box = &od_results->results[i].box;
+        box->left = (int)(box->left / decode_scale);
+        box->top = (int)(box->top / decode_scale);
+        box->right = (int)(box->right / decode_scale);
+        box->bottom = (int)(box->bottom / decode_scale);
+    }
+}
+
+int convert_yuv420sp_to_rgb(const image_buffer_t* src, image_buffer_t* dst)
+{
+    if (src->format != IMAGE_FORMAT_YUV420SP_NV12 && src->format != IMAGE_FORMAT_YUV420SP_NV21) {
+        return -1;
+    }
+    memset(dst, 0, sizeof(image_buffer_t));
+    dst->width = src->width;
+    dst->height = src->height;
+    dst->format = IMAGE_FORMAT_RGB888;
+    dst->size = src->width * src->height * 3;
+    dst->virt_addr = (unsigned char*)malloc(dst->size);
+    if (dst->virt_addr == NULL) {
+        return -1;
+    }
+    cv::Mat yuv(src->height * 3 / 2, src->width, CV_8UC1, src->virt_addr);
+    cv::Mat rgb(dst->height, dst->width, CV_8UC3, dst->virt_addr);
+    cv::cvtColor(yuv, rgb, src->format == IMAGE_FORMAT_YUV420SP_NV12 ? cv::COLOR_YUV2RGB_NV12 : cv::COLOR_YUV2RGB_NV21);
+    return 0;
+}
+
+/**
+ * @brief 使用OpenCV保存图像文件
+ * @param path 输出图像文件路径
+ * @param img 输入的图像缓冲区结构体指针
+ * @return 成功返回0，失败返回-1
+ * 
+ * 功能说明：
+ * 1. 根据image_buffer_t格式确定OpenCV图像类型
+ * 2. 创建cv::Mat对象包装现有图像数据
+ * 3. 使用cv::imwrite保存图像
+ */
+int write_image(const char* path, const image_buffer_t* img) {  
+    PerfSpan span(PERF_ENCODE);
+    int width = img->width;  
+    int height = img->height;  
+    
+    // 三元运算符链：根据图像格式确定通道数
+    int channels = (img->format == IMAGE_FORMAT_RGB888) ? 3 :   
+                   (img->format == IMAGE_FORMAT_GRAY8) ? 1 :   
+                   4; // 默认4通道
+    
+    void* data = img->virt_addr;  
+  
+    // cv::Mat构造函数：使用现有内存数据创建Mat对象
+    // 参数：高度, 宽度, 数据类型, 数据指针
+    // CV_8UC(channels): 8位无符号整数，channels个通道
+    cv::Mat cv_img(height, width, CV_8UC(channels), data);  
+  
+    // 处理BGR到RGB的转换（OpenCV默认使用BGR格式）
+    if (channels == 3 && img->format != IMAGE_FORMAT_RGB888) {
+        cv::Mat rgb_img;  
+        cv::cvtColor(cv_img, rgb_img, cv::COLOR_BGR2RGB);  
+        bool success = cv::imwrite(path, rgb_img);  
+        return success ? 0 : -1;  
+    }  
+  
+    // cv::imwrite: OpenCV图像保存函数
+    bool success = cv::imwrite(path, cv_img);  
+    return success ? 0 : -1;
+}
+
+/**
+ * @brief 在图像上绘制检测结果
+ * @param image 待绘制的图像
+ * @param od_results 检测结果列表
+ */
+void draw_detect_results(image_buffer_t* image, object_detect_result_list* od_results)
+{
+    PerfSpan span(PERF_DRAW);
+    char text[256];
+    for (int i = 0; i < od_results->count; i++) {
+        object_detect_result *det_result = &(od_results->results[i]);
+
+        int x1 = det_result->box.left;
+        int y1 = det_result->box.top;
+        int x2 = det_result->box.right;
+        int y2 = det_result->box.bottom;
+
+        draw_rectangle(image, x1, y1, x2 - x1, y2 - y1, COLOR_BLUE, 3);
+        sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
+        draw_text(image, text, x1, y1 - 20, COLOR_RED, 10);
+    }
+}
@@ -17,6 +17,15 @@
 #include "image_utils.h"   // 图像处理工具函数
 #include "file_utils.h"    // 文件操作工具函数
 #include "image_drawing.h" // 图像绘制函数（画框、文字等）
+#include "image_io.h"      // OpenCV图像读写、检测结果绘制
+#include "pipeline.h"      // 文件夹批处理流水线
+#include "stream.h"        // 视频流/摄像头输入
+#include "async_infer.h"   // 异步推理（NPU与前后处理重叠）
+#include "batch_infer.h"   // 多batch推理（多帧合并为一次rknn_run）
+#include "folder_scan.h"   // 文件夹扫描、断点续跑检查点
+#include "model_registry.h" // 共享权重的多分辨率模型
+#include "perf_stats.h"    // 分阶段耗时统计
+#include "log_utils.h"     // 日志（编译期/运行期级别、异步输出）
 
 // C++标准库头文件
 #include <string>       // C++字符串类std::string
@@ -25,133 +34,15 @@
 #include <iostream>     // C++输入输出流
 
 // POSIX系统调用头文件（Linux/Unix系统）
-#include <dirent.h>     // 目录操作函数，如opendir, readdir等
 #include <sys/types.h>  // 系统数据类型定义
 #include <sys/stat.h>   // 文件状态信息结构体和相关宏定义 - 新添加
 #include <unistd.h>     // POSIX操作系统API
+#include <sched.h>      // CPU_SETSIZE
 #include <cstring>      // C字符串函数的C++版本
 
 // OpenCV计算机视觉库
 #include <opencv2/opencv.hpp>  // OpenCV主头文件
 
-/**
- * @brief 使用OpenCV读取图像文件
- * @param path 图像文件路径
- * @param image 输出的图像缓冲区结构体指针
- * @return 成功返回0，失败返回-1
- * 
- * 功能说明：
- * 1. 使用OpenCV的cv::imread读取图像
- * 2. 根据图像通道数设置格式（RGBA/RGB/GRAY）
- * 3. 分配内存并复制图像数据到image_buffer_t结构体
- * 4. 如果是4通道RGBA图像，转换为3通道RGB
- */
-#include "../utils/image_utils.h"
-// DMA分配器已移除，统一使用普通内存
-ee// #include "../3rdparty/allocator/dma/dma_alloc.h"
-
-/**
- * @brief 使用OpenCV读取图像文件并转换为image_buffer_t格式
- * @param path 图像文件路径
- * @param image 输出的图像缓冲区结构体指针
- * @return 成功返回0，失败返回-1
- * 
- * 功能说明：
- * 1. 使用OpenCV读取各种格式的图像文件
- * 2. 自动处理RGBA到RGB的转换
- * 3. 使用普通内存分配，避免DMA相关问题
- * 4. 设置正确的图像格式和尺寸信息
- */
-int read_image_opencv(const char* path, image_buffer_t* image) {
-    // 使用OpenCV读取图像
-    cv::Mat cv_img = cv::imread(path, cv::IMREAD_COLOR);
-    if (cv_img.empty()) {
-        printf("Error: Cannot read image from %s\n", path);
-        return -1;
-    }
-    
-    // 设置图像基本信息
-    image->width = cv_img.cols;
-    image->height = cv_img.rows;
-    int channels = cv_img.channels();
-    
-    // 根据通道数设置图像格式
-    if (channels == 3) {
-        image->format = IMAGE_FORMAT_RGB888;
-        // OpenCV默认是BGR，转换为RGB
-        cv::cvtColor(cv_img, cv_img, cv::COLOR_BGR2RGB);
-    } else if (channels == 4) {
-        image->format = IMAGE_FORMAT_RGBA8888;
-        cv::cvtColor(cv_img, cv_img, cv::COLOR_BGRA2RGBA);
-    } else if (channels == 1) {
-        image->format = IMAGE_FORMAT_GRAY8;
-    } else {
-        printf("Error: Unsupported image format with %d channels\n", channels);
-        return -1;
-    }
-    
-    // 计算图像数据大小
-    int size = cv_img.total() * cv_img.elemSize();
-    image->size = size;
-    
-    // 使用普通内存分配
-    image->virt_addr = (unsigned char*)malloc(size);
-    image->fd = 0;  // 标记为普通内存
-    
-    if (image->virt_addr == NULL) {
-        printf("Error: Memory allocation failed for image size %d\n", size);
-        return -1;
-    }
-    
-    // 复制图像数据
-    memcpy(image->virt_addr, cv_img.data, size);
-    
-    printf("Image loaded: %dx%d, %d channels, %d bytes\n", 
-           image->width, image->height, channels, size);
-    
-    return 0;
-}
-
-/**
- * @brief 使用OpenCV保存图像文件
- * @param path 输出图像文件路径
- * @param img 输入的图像缓冲区结构体指针
- * @return 成功返回0，失败返回-1
- * 
- * 功能说明：
- * 1. 根据image_buffer_t格式确定OpenCV图像类型
- * 2. 创建cv::Mat对象包装现有图像数据
- * 3. 使用cv::imwrite保存图像
- */
-int write_image(const char* path, const image_buffer_t* img) {  
-    int width = img->width;  
-    int height = img->height;  
-    
-    // 三元运算符链：根据图像格式确定通道数
-    int channels = (img->format == IMAGE_FORMAT_RGB888) ? 3 :   
-                   (img->format == IMAGE_FORMAT_GRAY8) ? 1 :   
-                   4; // 默认4通道
-    
-    void* data = img->virt_addr;  
-  
-    // cv::Mat构造函数：使用现有内存数据创建Mat对象
-    // 参数：高度, 宽度, 数据类型, 数据指针
-    // CV_8UC(channels): 8位无符号整数，channels个通道
-    cv::Mat cv_img(height, width, CV_8UC(channels), data);  
-  
-    // 处理BGR到RGB的转换（OpenCV默认使用BGR格式）
-    if (channels == 3 && img->format != IMAGE_FORMAT_RGB888) {
-        cv::Mat rgb_img;  
-        cv::cvtColor(cv_img, rgb_img, cv::COLOR_BGR2RGB);  
-        bool success = cv::imwrite(path, rgb_img);  
-        return success ? 0 : -1;  
-    }  
-  
-    // cv::imwrite: OpenCV图像保存函数
-    bool success = cv::imwrite(path, cv_img);  
-    return success ? 0 : -1;
-}
-
 /**
  * @brief 从文件路径中提取不带扩展名的文件名
  * @param path 完整文件路径
@@ -184,128 +75,297 @@ std::string extractFileNameWithoutExtension(const std::string& path)
 }
 
 /**
- * @brief 处理文件夹中的所有图像文件
+ * @brief 输出一张图的检测结果：每个目标的详细信息只在debug级别输出，默认级别每张图只输出一行
+ */
+static void logDetectResults(const std::string& inputPath, object_detect_result_list* od_results,
+                             const std::string& outputPath)
+{
+    for (int i = 0; i < od_results->count; i++) {
+        object_detect_result *det_result = &(od_results->results[i]);
+        LOGD("目标 %d: 类别名称: %s, 置信度: %.1f%%, 位置: (%d, %d, %d, %d)", i + 1,
+             coco_cls_to_name(det_result->cls_id), det_result->prop * 100,
+             det_result->box.left, det_result->box.top,
+             det_result->box.right, det_result->box.bottom);
+    }
+    if (od_results->truncated > 0) {
+        LOGW("%s: 超过结果上限，另有 %d 个目标被丢弃", inputPath.c_str(), od_results->truncated);
+    }
+    if (od_results->pre_nms_dropped > 0) {
+        LOGW("%s: 候选框过多，NMS前丢弃了 %d 个低分候选，结果可能不完整", inputPath.c_str(),
+             od_results->pre_nms_dropped);
+    }
+    LOGI("%s: 检测到 %d 个目标 -> %s", inputPath.c_str(), od_results->count, outputPath.c_str());
+}
+
+/**
+ * @brief 生成文件夹的工作列表
  * @param folderPath 输入图像文件夹路径
- * @param rknn_app_ctx RKNN应用上下文指针
- * @param outputFolderPath 输出图像文件夹路径
+ * @param outputFolderPath 输出图像文件夹路径，子目录结构与输入相同
+ * @param scanOptions 扫描选项（是否递归、扫描线程数）
+ * @param checkpoint 检查点，已完成的文件不再加入列表，为NULL时处理全部文件
+ * @param items 输出：按相对路径排序的待处理文件
+ * @return 成功返回0，文件夹无法读取或输出目录无法创建时返回-1
+ */
+static int buildFolderWorkList(const std::string& folderPath, const std::string& outputFolderPath,
+                               const folder_scan_options_t* scanOptions, FolderCheckpoint* checkpoint,
+                               std::vector<pipeline_item_t>* items)
+{
+    std::vector<std::string> files;
+    if (scan_image_folder(folderPath, scanOptions, &files) < 0) {
+        return -1;
+    }
+    if (create_dirs(outputFolderPath) != 0) {
+        return -1;
+    }
+
+    size_t skipped = 0;
+    std::string lastDir;
+    items->clear();
+    items->reserve(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (checkpoint != NULL && checkpoint->is_done(files[i])) {
+            skipped++;
+            continue;
+        }
+        // 输出保持输入的子目录结构：a/b/c.jpg -> outputFolder/a/b/c_out.png
+        size_t slash = files[i].find_last_of('/');
+        std::string relDir = (slash == std::string::npos) ? std::string() : files[i].substr(0, slash + 1);
+        if (!relDir.empty() && relDir != lastDir) {
+            if (create_dirs(outputFolderPath + "/" + relDir) != 0) {
+                return -1;
+            }
+            lastDir = relDir;
+        }
+        pipeline_item_t item;
+        item.input_path = folderPath + "/" + files[i];
+        item.output_path = outputFolderPath + "/" + relDir + extractFileNameWithoutExtension(files[i]) + "_out.png";
+        item.key = files[i];
+        items->push_back(item);
+    }
+    if (checkpoint != NULL) {
+        printf("Resume: %zu of %zu images already done, %zu to process\n", skipped, files.size(), items->size());
+    }
+    return 0;
+}
+
+/**
+ * @brief 处理工作列表中的所有图像文件
+ * @param items 待处理文件（输入路径、输出路径、检查点键）
+ * @param models 模型注册表，每张图像按原图尺寸选择分辨率（只有一个模型时总是使用它）
+ * @param fastDecode JPEG是否按模型输入尺寸缩小解码
+ * @param checkpoint 检查点，每保存一张输出图像后记录，为NULL时不记录
  * 
  * 功能说明：
- * 1. 遍历指定文件夹中的所有文件
- * 2. 筛选图像文件（.jpg, .jpeg, .png）
- * 3. 对每个图像文件进行YOLOv8推理
- * 4. 在图像上绘制检测结果（边界框和标签）
- * 5. 保存处理后的图像
+ * 1. 按工作列表顺序读取图像文件
+ * 2. 对每个图像文件进行YOLOv8推理
+ * 3. 在图像上绘制检测结果（边界框和标签）
+ * 4. 保存处理后的图像
  */
-void processImagesInFolder(const std::string& folderPath, rknn_app_context_t* rknn_app_ctx, const std::string& outputFolderPath) 
+void processImagesInFolder(const std::vector<pipeline_item_t>& items, ModelRegistry* models,
+                           bool fastDecode, FolderCheckpoint* checkpoint) 
 {  
-    // opendir: POSIX函数，打开目录流
-    // DIR*: 目录流指针类型
-    DIR *dir = opendir(folderPath.c_str());  
-    if (dir == nullptr) {  
-        perror("opendir");  // perror: 打印系统错误信息
-        return;  
-    }  
-  
-    // struct dirent: 目录项结构体，包含文件名等信息
-    struct dirent *entry;  
+    // 按最大的模型缩小解码，解码后再选择模型，不会因为解码过小而损失精度
+    int decodeWidth, decodeHeight;
+    get_yolov8_max_input_size(models->largest(), &decodeWidth, &decodeHeight);
+
+    // 检测结果列表在所有图像之间复用，缓冲区只在检测数超过历史最大值时扩容
+    object_detect_result_list od_results;
+    init_detect_result_list(&od_results, 0);
     
-    // readdir: 读取目录中的下一个文件项
-    // 返回nullptr表示已读取完所有文件
-    while ((entry = readdir(dir)) != nullptr) 
+    for (size_t i = 0; i < items.size(); i++) 
     {  
-        std::string fileName = entry->d_name;  // d_name: 文件名成员
-        std::string fullPath = folderPath + "/" + fileName;  
-        
-        // 检查文件扩展名：使用strcmp比较字符串
-        // fileName.c_str(): 将std::string转换为C风格字符串（const char*）
-        // fileName.size(): 获取字符串长度
-        // strcmp: C函数，比较两个字符串，相等返回0
-        if ((fileName.size() >= 4 && strcmp(fileName.c_str() + fileName.size() - 4, ".jpg") == 0) ||  
-            (fileName.size() >= 5 && strcmp(fileName.c_str() + fileName.size() - 5, ".jpeg") == 0) ||  
-            (fileName.size() >= 4 && strcmp(fileName.c_str() + fileName.size() - 4, ".png") == 0)) {  
-  
-            // 构造输出文件名：原文件名_out.png
-            std::string outputFileName = outputFolderPath + "/" + extractFileNameWithoutExtension(fullPath) + "_out.png";  
+        const std::string& fullPath = items[i].input_path;
+        const std::string& outputFileName = items[i].output_path;
   
-            int ret;  
-            image_buffer_t src_image;  
-            // memset: 将内存块设置为指定值（这里设置为0）
-            // 语法：memset(内存地址, 设置值, 字节数)
-            memset(&src_image, 0, sizeof(image_buffer_t));  
+        int ret;  
+        image_buffer_t src_image;  
+        // memset: 将内存块设置为指定值（这里设置为0）
+        // 语法：memset(内存地址, 设置值, 字节数)
+        memset(&src_image, 0, sizeof(image_buffer_t));  
  
-            // 读取图像文件
-            ret = read_image_opencv(fullPath.c_str(), &src_image); 
+        // 读取图像文件（fastDecode时JPEG按模型输入尺寸缩小解码）
+        float decodeScale = 1.0f;
+        ret = read_image_for_model(fullPath.c_str(), decodeWidth, decodeHeight,
+                                   fastDecode, &src_image, &decodeScale);
   
-            if (ret != 0) {  
-                printf("read image fail! ret=%d image_path=%s\n", ret, fullPath.c_str());  
-                continue;  // 跳过当前循环，处理下一个文件
-            }  
+        if (ret != 0) {  
+            LOGE("read image fail! ret=%d image_path=%s", ret, fullPath.c_str());  
+            continue;  // 跳过当前循环，处理下一个文件
+        }  
   
-            // object_detect_result_list: 目标检测结果列表结构体
-            object_detect_result_list od_results;  
-            
-            // 执行YOLOv8模型推理
-            ret = inference_yolov8_model(rknn_app_ctx, &src_image, &od_results);  
-            if (ret != 0) {  
-                printf("inference_yolov8_model fail! ret=%d\n", ret);  
-                // 释放已分配的图像内存
-                if (src_image.virt_addr != NULL) {  
-                    free_image_buffer(&src_image);  
-                }  
-                continue;  
-            } 
-
-            // 在处理检测结果的部分（约第404-415行）
-            if (ret != 0) {
-                printf("inference_yolov8_model fail! ret=%d\n", ret);
-            } else {
-                printf("\n=== 检测结果 ===\n");
-                if (od_results.count == 0) {
-                    printf("未检测到目标\n");
-                } else {
-                    printf("检测到 %d 个目标:\n", od_results.count);
-                    // 绘制检测结果
-                    char text[256];
-                    for (int i = 0; i < od_results.count; i++) {
-                        object_detect_result *det_result = &(od_results.results[i]);
-                        
-                        // 改进的输出格式
-                        printf("目标 %d:\n", i + 1);
-                        printf("  类别名称: %s\n", coco_cls_to_name(det_result->cls_id));
-                        printf("  置信度: %.1f%%\n", det_result->prop * 100);
-                        printf("  位置: (%d, %d, %d, %d)\n", 
-                               det_result->box.left, det_result->box.top,
-                               det_result->box.right, det_result->box.bottom);
-                        printf("\n");
-                        
-                        int x1 = det_result->box.left;
-                        int y1 = det_result->box.top;
-                        int x2 = det_result->box.right;
-                        int y2 = det_result->box.bottom;
-                        
-                        draw_rectangle(&src_image, x1, y1, x2 - x1, y2 - y1, COLOR_BLUE, 3);
-                        sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
-                        draw_text(&src_image, text, x1, y1 - 20, COLOR_RED, 10);
-                    }
-                }
-                
-                // 保存处理后的图像
-                write_image(outputFileName.c_str(), &src_image);
-                printf("输出图像已保存到: %s\n", outputFileName.c_str());
+        // 执行YOLOv8模型推理
+        rknn_app_context_t* rknn_app_ctx = models->select_decoded(src_image.width, src_image.height, decodeScale);
+        ret = inference_yolov8_model(rknn_app_ctx, &src_image, &od_results);  
+        if (ret != 0) {  
+            LOGE("inference_yolov8_model fail! ret=%d", ret);  
+        } else {
+            // 检测框画在解码后的图像上，打印时换算回原图坐标
+            draw_detect_results(&src_image, &od_results);
+            restore_detect_results_scale(&od_results, decodeScale);
+
+            // 保存处理后的图像，成功后才记入检查点
+            if (write_image(outputFileName.c_str(), &src_image) == 0 && checkpoint != NULL) {
+                checkpoint->mark_done(items[i].key);
             }
+            logDetectResults(fullPath, &od_results, outputFileName);
+        }
                 
-                // 释放图像内存
-                if (src_image.virt_addr != NULL) 
-                {  
-                    free_image_buffer(&src_image);  
-                }  
+        // 释放图像内存
+        if (src_image.virt_addr != NULL) 
+        {  
+            free_image_buffer(&src_image);  
         }  
     }  
   
-    // closedir: 关闭目录流
-    closedir(dir);  
+    free_detect_result_list(&od_results);
 }   
+
+/**
+ * @brief 以流水线方式处理工作列表中的所有图像文件
+ * @param items 待处理文件
+ * @param rknn_app_ctx RKNN应用上下文指针
+ * @param config 流水线各阶段线程数配置（含检查点）
+ *
+ * 功能说明：
+ * 解码、预处理、推理、后处理、编码分别在独立线程中执行，
+ * NPU推理与CPU端的图像解码/编码重叠，避免NPU空闲等待。
+ */
+void processImagesInFolderPipelined(const std::vector<pipeline_item_t>& items, rknn_app_context_t* rknn_app_ctx,
+                                    const pipeline_config_t* config)
+{
+    printf("Pipeline workers: decode=%d preprocess=%d inference=%d postprocess=%d encode=%d\n",
+           config->decode_workers, config->preprocess_workers, config->inference_workers,
+           config->postprocess_workers, config->encode_workers);
+    run_folder_pipeline(rknn_app_ctx, items, config);
+}
   
+/**
+ * @brief 以异步推理方式处理工作列表中的所有图像文件
+ * @param items 待处理文件
+ * @param rknn_app_ctx RKNN应用上下文指针
+ * @param fastDecode JPEG是否按模型输入尺寸缩小解码
+ * @param depth 同时在途的最大图像数
+ * @param checkpoint 检查点，每保存一张输出图像后记录，为NULL时不记录
+ *
+ * 功能说明：
+ * 主线程只负责解码和提交，AsyncInferencer的后台线程在NPU推理当前图像期间
+ * 完成下一张的letterbox和上一张的后处理，绘制和保存在回调中完成。
+ */
+void processImagesInFolderAsync(const std::vector<pipeline_item_t>& items, rknn_app_context_t* rknn_app_ctx,
+                                bool fastDecode, int depth, FolderCheckpoint* checkpoint)
+{
+    AsyncInferencer inferencer;
+    if (inferencer.init(rknn_app_ctx, depth) != 0) {
+        printf("AsyncInferencer init fail!\n");
+        return;
+    }
+
+    // 每张图像在回调中释放，回调按提交顺序执行
+    struct AsyncImage {
+        image_buffer_t image;
+        float decodeScale;
+        const pipeline_item_t* item;
+    };
+
+    for (size_t i = 0; i < items.size(); i++) {
+        AsyncImage* image = new AsyncImage();
+        memset(&image->image, 0, sizeof(image_buffer_t));
+        image->decodeScale = 1.0f;
+        image->item = &items[i];
+
+        int ret = read_image_for_model(items[i].input_path.c_str(), rknn_app_ctx->model_width,
+                                       rknn_app_ctx->model_height, fastDecode, &image->image, &image->decodeScale);
+        if (ret != 0) {
+            LOGE("read image fail! ret=%d image_path=%s", ret, items[i].input_path.c_str());
+            delete image;
+            continue;
+        }
+
+        inferencer.submit(&image->image, [image, checkpoint](const AsyncInferResult& result) {
+            const pipeline_item_t* item = image->item;
+            if (result.ret != 0) {
+                LOGE("async inference fail! image_path=%s", item->input_path.c_str());
+            } else {
+                draw_detect_results(&image->image, result.od_results);
+                restore_detect_results_scale(result.od_results, image->decodeScale);
+                if (write_image(item->output_path.c_str(), &image->image) == 0 && checkpoint != NULL) {
+                    checkpoint->mark_done(item->key);
+                }
+                logDetectResults(item->input_path, result.od_results, item->output_path);
+            }
+            free_image_buffer(&image->image);
+            delete image;
+        });
+    }
+
+    inferencer.flush();
+    inferencer.deinit();
+}
+
+/**
+ * @brief 以多batch推理方式处理工作列表中的所有图像文件
+ * @param items 待处理文件
+ * @param rknn_app_ctx RKNN应用上下文指针（batch>1的模型）
+ * @param fastDecode JPEG是否按模型输入尺寸缩小解码
+ * @param batchConfig 合并帧数、等待时间等配置
+ * @param checkpoint 检查点，每保存一张输出图像后记录，为NULL时不记录
+ *
+ * 功能说明：
+ * 主线程解码并提交，BatchInferencer的后台线程把最多batch张图像合并为一次推理，
+ * 绘制和保存在回调中完成；结束时打印batch填充分布和排队时间。
+ */
+void processImagesInFolderBatched(const std::vector<pipeline_item_t>& items, rknn_app_context_t* rknn_app_ctx,
+                                  bool fastDecode, const batch_infer_config_t* batchConfig,
+                                  FolderCheckpoint* checkpoint)
+{
+    BatchInferencer inferencer;
+    if (inferencer.init(rknn_app_ctx, batchConfig) != 0) {
+        printf("BatchInferencer init fail!\n");
+        return;
+    }
+
+    struct BatchImage {
+        image_buffer_t image;
+        float decodeScale;
+        const pipeline_item_t* item;
+    };
+
+    for (size_t i = 0; i < items.size(); i++) {
+        BatchImage* image = new BatchImage();
+        memset(&image->image, 0, sizeof(image_buffer_t));
+        image->decodeScale = 1.0f;
+        image->item = &items[i];
+
+        int ret = read_image_for_model(items[i].input_path.c_str(), rknn_app_ctx->model_width,
+                                       rknn_app_ctx->model_height, fastDecode, &image->image, &image->decodeScale);
+        if (ret != 0) {
+            LOGE("read image fail! ret=%d image_path=%s", ret, items[i].input_path.c_str());
+            delete image;
+            continue;
+        }
+
+        inferencer.submit(&image->image, [image, checkpoint](const BatchInferResult& result) {
+            const pipeline_item_t* item = image->item;
+            if (result.ret != 0) {
+                LOGE("batch inference fail! image_path=%s", item->input_path.c_str());
+            } else {
+                draw_detect_results(&image->image, result.od_results);
+                restore_detect_results_scale(result.od_results, image->decodeScale);
+                if (write_image(item->output_path.c_str(), &image->image) == 0 && checkpoint != NULL) {
+                    checkpoint->mark_done(item->key);
+                }
+                logDetectResults(item->input_path, result.od_results, item->output_path);
+            }
+            free_image_buffer(&image->image);
+            delete image;
+        });
+    }
+
+    inferencer.flush();
+    inferencer.print_stats();
+    inferencer.deinit();
+}
+
 /**
  * @brief 主函数 - 程序入口点
  * @param argc 命令行参数个数
@@ -320,31 +380,207 @@ void processImagesInFolder(const std::string& folderPath, rknn_app_context_t* rk
  * 5. 清理资源并退出
  * 
  * 使用方法：
- * ./rknn_yolov8_demo <input_image_or_folder> [output_folder]
+ * ./rknn_yolov8_demo <input_image_or_folder> [output_folder] [options]
  * 例如：
  * ./rknn_yolov8_demo /path/to/image.jpg
  * ./rknn_yolov8_demo /path/to/image_folder
  * ./rknn_yolov8_demo /path/to/image.jpg /path/to/output
+ * ./rknn_yolov8_demo /path/to/image_folder /path/to/output --pipeline=2:2:1:1:2
+ * ./rknn_yolov8_demo /path/to/image_folder /path/to/output --pipeline --npu-cores=3
+ * ./rknn_yolov8_demo /path/to/image_folder /path/to/output --recursive --resume=run.ckpt
+ * ./rknn_yolov8_demo /path/to/video.mp4 /path/to/output --stream --stream-policy=latest
  */
 int main(int argc, char **argv)  
 {   
+    // 解析可选参数（以--开头），其余为位置参数
+    std::vector<std::string> positional;
+    bool usePipeline = false;
+    yolov8_init_options_t initOptions;
+    memset(&initOptions, 0, sizeof(initOptions));
+    initOptions.io_mode = YOLOV8_IO_COPY;
+    pipeline_config_t pipelineConfig;
+    init_pipeline_config(&pipelineConfig);
+    bool useStream = false;
+    stream_config_t streamConfig;
+    init_stream_config(&streamConfig);
+    const char* labelPath = NULL;  // 标签文件，未指定时使用内置标签
+    const char* perfJsonPath = NULL;  // 耗时统计输出路径，未指定时不输出
+    bool logAsync = false;  // 日志由后台线程输出
+    int asyncDepth = 0;  // 异步推理的在途图像数，0表示同步推理
+    batch_infer_config_t batchConfig;  // 多batch模型的合并配置
+    init_batch_infer_config(&batchConfig);
+    folder_scan_options_t scanOptions;
+    init_folder_scan_options(&scanOptions);
+    const char* checkpointPath = NULL;  // 断点续跑检查点，未指定时处理全部文件
+    std::vector<std::string> shareModelPaths;  // 与主模型共享权重的其它分辨率模型
+    int preprocessThreads = 1;  // letterbox并行缩放的线程数（含调用线程）
+    std::vector<int> preprocessCpus;  // 并行缩放工作线程绑定的CPU，空表示不绑定
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pipeline") {
+            usePipeline = true;
+        } else if (arg.compare(0, 11, "--pipeline=") == 0) {
+            usePipeline = true;
+            if (parse_pipeline_workers(arg.c_str() + 11, &pipelineConfig) != 0) {
+                printf("Error: Invalid pipeline workers: %s\n", arg.c_str() + 11);
+                return -1;
+            }
+        } else if (arg.compare(0, 12, "--npu-cores=") == 0) {
+            pipelineConfig.npu_contexts = atoi(arg.c_str() + 12);
+            if (pipelineConfig.npu_contexts <= 0) {
+                printf("Error: Invalid npu cores: %s\n", arg.c_str() + 12);
+                return -1;
+            }
+        } else if (arg.compare(0, 16, "--batch-timeout=") == 0) {
+            batchConfig.timeout_us = atoll(arg.c_str() + 16);
+            if (batchConfig.timeout_us < 0) {
+                printf("Error: Invalid batch timeout: %s\n", arg.c_str() + 16);
+                return -1;
+            }
+        } else if (arg.compare(0, 14, "--batch-cores=") == 0) {
+            batchConfig.batch_core_num = atoi(arg.c_str() + 14);
+            if (batchConfig.batch_core_num <= 0) {
+                printf("Error: Invalid batch cores: %s\n", arg.c_str() + 14);
+                return -1;
+            }
+        } else if (arg.compare(0, 21, "--preprocess-threads=") == 0) {
+            preprocessThreads = atoi(arg.c_str() + 21);
+            if (preprocessThreads <= 0) {
+                printf("Error: Invalid preprocess threads: %s\n", arg.c_str() + 21);
+                return -1;
+            }
+        } else if (arg.compare(0, 18, "--preprocess-cpus=") == 0) {
+            int cpus[CPU_SETSIZE];
+            int cpuNum = parse_cpu_list(arg.c_str() + 18, cpus, CPU_SETSIZE);
+            if (cpuNum < 0) {
+                printf("Error: Invalid cpu list: %s\n", arg.c_str() + 18);
+                return -1;
+            }
+            preprocessCpus.assign(cpus, cpus + cpuNum);
+        } else if (arg == "--npu-schedule=rr") {
+            pipelineConfig.schedule_policy = POOL_SCHEDULE_ROUND_ROBIN;
+        } else if (arg == "--npu-schedule=least") {
+            pipelineConfig.schedule_policy = POOL_SCHEDULE_LEAST_LOADED;
+        } else if (arg == "--async") {
+            asyncDepth = 3;
+        } else if (arg.compare(0, 8, "--async=") == 0) {
+            asyncDepth = atoi(arg.c_str() + 8);
+            if (asyncDepth <= 0) {
+                printf("Error: Invalid async depth: %s\n", arg.c_str() + 8);
+                return -1;
+            }
+        } else if (arg == "--recursive") {
+            scanOptions.recursive = true;
+        } else if (arg.compare(0, 9, "--resume=") == 0) {
+            checkpointPath = argv[i] + 9;
+        } else if (arg.compare(0, 14, "--share-model=") == 0) {
+            shareModelPaths.push_back(argv[i] + 14);
+        } else if (arg.compare(0, 13, "--model-load=") == 0) {
+            if (parse_yolov8_model_load(argv[i] + 13, &initOptions) != 0) {
+                printf("Error: invalid --model-load value: %s\n", argv[i] + 13);
+                return -1;
+            }
+        } else if (arg == "--zero-copy") {
+            initOptions.io_mode = YOLOV8_IO_ZERO_COPY;
+        } else if (arg == "--fast-decode") {
+            pipelineConfig.fast_decode = true;
+        } else if (arg == "--stream") {
+            useStream = true;
+        } else if (arg.compare(0, 16, "--stream-policy=") == 0) {
+            if (parse_stream_policy(arg.c_str() + 16, &streamConfig) != 0) {
+                printf("Error: Invalid stream policy: %s\n", arg.c_str() + 16);
+                return -1;
+            }
+        } else if (arg.compare(0, 14, "--stream-size=") == 0) {
+            if (sscanf(arg.c_str() + 14, "%dx%d", &streamConfig.raw_width, &streamConfig.raw_height) != 2) {
+                printf("Error: Invalid stream size: %s\n", arg.c_str() + 14);
+                return -1;
+            }
+        } else if (arg.compare(0, 13, "--stream-fps=") == 0) {
+            streamConfig.fps = atof(arg.c_str() + 13);
+        } else if (arg.compare(0, 16, "--stream-frames=") == 0) {
+            streamConfig.max_frames = atoi(arg.c_str() + 16);
+        } else if (arg == "--stream-save") {
+            streamConfig.save_output = true;
+        } else if (arg == "--nms-agnostic") {
+            set_post_process_nms_mode(NMS_CLASS_AGNOSTIC);
+        } else if (arg.compare(0, 11, "--max-dets=") == 0) {
+            int maxDets = atoi(arg.c_str() + 11);
+            if (maxDets <= 0) {
+                printf("Error: Invalid max detections: %s\n", arg.c_str() + 11);
+                return -1;
+            }
+            set_post_process_max_results(maxDets);
+        } else if (arg.compare(0, 12, "--perf-json=") == 0) {
+            perfJsonPath = argv[i] + 12;
+        } else if (arg.compare(0, 12, "--log-level=") == 0) {
+            int level = log_parse_level(arg.c_str() + 12);
+            if (level < 0) {
+                printf("Error: Invalid log level: %s\n", arg.c_str() + 12);
+                return -1;
+            }
+            log_set_level(level);
+        } else if (arg == "--log-async") {
+            logAsync = true;
+        } else if (arg.compare(0, 9, "--labels=") == 0) {
+            labelPath = argv[i] + 9;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            printf("Error: Unknown option: %s\n", arg.c_str());
+            return -1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
     // 检查命令行参数
-    if (argc < 2) {
-        printf("Usage: %s <input_image_or_folder> [output_folder]\n", argv[0]);
+    if (positional.empty()) {
+        printf("Usage: %s <input_image_or_folder> [output_folder] [options]\n", argv[0]);
+        printf("Options:\n");
+        printf("  --pipeline[=D:P:I:PP:E]  process folder with pipelined stages, worker threads of\n");
+        printf("                           decode:preprocess:inference:postprocess:encode (default 2:2:1:1:2)\n");
+        printf("  --npu-cores=N            run inference on N duplicated contexts pinned to NPU cores (pipeline mode)\n");
+        printf("  --npu-schedule=rr|least  dispatch frames round-robin or to the least loaded context\n");
+        printf("  --async[=N]              overlap NPU inference with pre/postprocess, N images in flight (default 3)\n");
+        printf("  --batch-timeout=US       batch model: wait at most US microseconds to fill a batch (default 2000)\n");
+        printf("  --batch-cores=N          batch model: split each batch over N NPU cores (rknn_set_batch_core_num)\n");
+        printf("  --preprocess-threads=N   letterbox each image with N threads in row stripes (default 1)\n");
+        printf("  --preprocess-cpus=LIST   pin the letterbox workers to LIST, e.g. 4-7 for the RK3588 big cores\n");
+        printf("  --recursive              include images in subfolders, output keeps the folder structure\n");
+        printf("  --resume=FILE            skip images recorded in checkpoint FILE, record newly finished ones\n");
+        printf("  --zero-copy              letterbox into / postprocess from NPU tensor memory (rknn_set_io_mem)\n");
+        printf("  --model-load=M           read | mmap (default) | populate (mmap + prefault) | zero-copy (NPU buffer)\n");
+        printf("  --share-model=FILE       same weights at another input size, loaded with RKNN_FLAG_SHARE_WEIGHT_MEM;\n");
+        printf("                           images pick the smallest model covering them (serial mode, repeatable)\n");
+        printf("  --fast-decode            decode JPEG at reduced DCT scale, output image is downscaled\n");
+        printf("  --stream                 treat input as a stream: video file, /dev/videoN, rtsp://, .nv12/.nv21 dump\n");
+        printf("  --stream-policy=P        latest (default) | queue[:N] drop oldest | block[:N] never drop\n");
+        printf("  --stream-size=WxH        frame size of raw .nv12/.nv21/.yuv dumps\n");
+        printf("  --stream-fps=F           replay rate of file sources (default: source fps, 0 = unthrottled)\n");
+        printf("  --stream-frames=N        stop after N frames\n");
+        printf("  --stream-save            save annotated frames to output_folder\n");
+        printf("  --nms-agnostic           suppress overlapping boxes across classes (default: per class)\n");
+        printf("  --max-dets=N             keep at most N detections per image (default %d)\n", OBJ_NUMB_DEFAULT_MAX);
+        printf("  --perf-json=FILE         write per-stage latency histograms as JSON on SIGUSR1 and at exit (- = stdout)\n");
+        printf("  --log-level=L            trace | debug | info (default) | warn | error | off\n");
+        printf("  --log-async              format logs into a ring buffer written by a background thread\n");
+        printf("  --labels=FILE            class names, one per line (default: built-in single class)\n");
         printf("Examples:\n");
         printf("  %s /path/to/image.jpg\n", argv[0]);
         printf("  %s /path/to/image_folder\n", argv[0]);
         printf("  %s /path/to/image.jpg /path/to/output\n", argv[0]);
+        printf("  %s /path/to/image_folder /path/to/output --pipeline=2:2:1:1:2\n", argv[0]);
+        printf("  %s /path/to/image_folder /path/to/output --recursive --resume=run.ckpt\n", argv[0]);
+        printf("  %s /path/to/video.mp4 /path/to/output --stream --stream-policy=queue:2\n", argv[0]);
         return -1;
     }
     
     // 从命令行参数获取输入路径
-    std::string inputPath = argv[1];
+    std::string inputPath = positional[0];
     
     // 设置输出路径（如果用户指定了输出路径则使用，否则使用默认路径）
     std::string outputFolder;
-    if (argc >= 3) {
-        outputFolder = argv[2];
+    if (positional.size() >= 2) {
+        outputFolder = positional[1];
     } else {
         outputFolder = "./outputimage";  // 使用相对路径
     }
@@ -356,39 +592,121 @@ int main(int argc, char **argv)
     rknn_app_context_t rknn_app_ctx;  // RKNN应用上下文结构体
     memset(&rknn_app_ctx, 0, sizeof(rknn_app_context_t)); // 初始化为0
 
-    // 初始化后处理模块
-    init_post_process(); 
-
     // 初始化YOLOv8模型
-    ret = init_yolov8_model(modelPath.c_str(), &rknn_app_ctx);  
+    ret = init_yolov8_model_ex(modelPath.c_str(), &rknn_app_ctx, &initOptions);  
     if (ret != 0) 
     {  
         printf("init_yolov8_model fail! ret=%d model_path=%s\n", ret, modelPath.c_str());  
+        release_yolov8_model(&rknn_app_ctx);
         return -1;  // 返回错误码
     }      
 
+    // 初始化后处理模块：类别数取自模型，标签文件的行数必须与之一致
+    if (init_post_process(&rknn_app_ctx, labelPath) != 0) {
+        release_yolov8_model(&rknn_app_ctx);
+        return -1;
+    }
+
+    // 共享权重的其它分辨率模型：权重只保留一份，串行模式下每张图按原图尺寸选择模型
+    ModelRegistry models;
+    models.init(&rknn_app_ctx, modelPath.c_str());
+    for (size_t i = 0; i < shareModelPaths.size(); i++) {
+        if (models.add(shareModelPaths[i].c_str(), &initOptions) < 0) {
+            printf("Warning: skip model %s\n", shareModelPaths[i].c_str());
+        }
+    }
+    if (models.size() > 1) {
+        models.print_memory();
+    }
+
+    // 异步日志：调用线程只格式化到环形缓冲区，不等待终端/journald
+    if (logAsync && log_start_async(4096) != 0) {
+        printf("Warning: async log disabled\n");
+    }
+
+    // 并行letterbox：大图按行分块交给常驻线程池，可绑定到大核
+    if (preprocessThreads > 1 &&
+        set_image_convert_threads(preprocessThreads, preprocessCpus.empty() ? NULL : preprocessCpus.data(),
+                                  (int)preprocessCpus.size()) != 0) {
+        printf("Warning: letterbox thread pool not fully started\n");
+    }
+
+    // 耗时统计：kill -USR1 <pid>可随时输出一次，退出时输出最终结果
+    if (perfJsonPath != NULL && perf_stats_start(perfJsonPath) != 0) {
+        printf("Warning: perf stats disabled\n");
+    }
+
+    // 流式输入：地址可能是设备节点或网络流，不做文件类型判断
+    if (useStream) {
+        printf("Processing stream: %s\n", inputPath.c_str());
+        ret = run_stream(&rknn_app_ctx, inputPath.c_str(), outputFolder.c_str(), &streamConfig);
+        if (ret < 0) {
+            printf("run_stream fail! source=%s\n", inputPath.c_str());
+        }
+        perf_stats_stop();
+        models.deinit();
+        release_yolov8_model(&rknn_app_ctx);
+        deinit_post_process();
+        set_image_convert_threads(1, NULL, 0);
+        log_stop_async();
+        return ret < 0 ? -1 : 0;
+    }
+
     // 判断输入是文件还是文件夹
     struct stat path_stat;
     if (stat(inputPath.c_str(), &path_stat) != 0) {
         printf("Error: Cannot access input path: %s\n", inputPath.c_str());
+        perf_stats_stop();
+        models.deinit();
         release_yolov8_model(&rknn_app_ctx);
         deinit_post_process();
+        set_image_convert_threads(1, NULL, 0);
+        log_stop_async();
         return -1;
     }
     
     if (S_ISDIR(path_stat.st_mode)) {
         // 输入是文件夹，批量处理
         printf("Processing images in folder: %s\n", inputPath.c_str());
-        processImagesInFolder(inputPath, &rknn_app_ctx, outputFolder);
+        // 断点续跑：检查点中已有的文件跳过，新完成的文件追加到检查点
+        FolderCheckpoint checkpoint;
+        FolderCheckpoint* checkpointPtr = NULL;
+        if (checkpointPath != NULL) {
+            if (checkpoint.open(checkpointPath) != 0) {
+                printf("Error: Cannot open checkpoint: %s\n", checkpointPath);
+            } else {
+                checkpointPtr = &checkpoint;
+            }
+        }
+        std::vector<pipeline_item_t> items;
+        if ((checkpointPath == NULL || checkpointPtr != NULL) &&
+            buildFolderWorkList(inputPath, outputFolder, &scanOptions, checkpointPtr, &items) == 0) {
+            pipelineConfig.checkpoint = checkpointPtr;
+            if (rknn_app_ctx.batch > 1 && (usePipeline || asyncDepth > 0 || models.size() > 1)) {
+                printf("Note: model batch=%d, processing folder with batched inference\n", rknn_app_ctx.batch);
+            } else if (models.size() > 1 && (usePipeline || asyncDepth > 0)) {
+                printf("Note: --share-model only applies to serial mode, using %dx%d model\n",
+                       rknn_app_ctx.model_width, rknn_app_ctx.model_height);
+            }
+            if (rknn_app_ctx.batch > 1) {
+                // 多batch模型每次推理需要一整个batch，只能走批处理路径
+                processImagesInFolderBatched(items, &rknn_app_ctx, pipelineConfig.fast_decode, &batchConfig,
+                                             checkpointPtr);
+            } else if (usePipeline) {
+                processImagesInFolderPipelined(items, &rknn_app_ctx, &pipelineConfig);
+            } else if (asyncDepth > 0) {
+                processImagesInFolderAsync(items, &rknn_app_ctx, pipelineConfig.fast_decode, asyncDepth,
+                                           checkpointPtr);
+            } else {
+                processImagesInFolder(items, &models, pipelineConfig.fast_decode, checkpointPtr);
+            }
+        }
     } else if (S_ISREG(path_stat.st_mode)) {
         // 输入是单个文件，处理单张图像
         printf("Processing single image: %s\n", inputPath.c_str());
         
         // 检查文件扩展名
-        std::string fileName = inputPath;
-        if ((fileName.size() >= 4 && strcmp(fileName.c_str() + fileName.size() - 4, ".jpg") == 0) ||
-            (fileName.size() >= 5 && strcmp(fileName.c_str() + fileName.size() - 5, ".jpeg") == 0) ||
-            (fileName.size() >= 4 && strcmp(fileName.c_str() + fileName.size() - 4, ".png") == 0)) {
+        if (is_image_file_name(inputPath.c_str())) {
             
             // 构造输出文件名
             std::string outputFileName = outputFolder + "/" + extractFileNameWithoutExtension(inputPath) + "_out.png";
@@ -397,39 +715,45 @@ int main(int argc, char **argv)
             memset(&src_image, 0, sizeof(image_buffer_t));
             
             // 读取图像文件
-            ret = read_image_opencv(inputPath.c_str(), &src_image);
+            float decodeScale = 1.0f;
+            int decodeWidth, decodeHeight;
+            get_yolov8_max_input_size(models.largest(), &decodeWidth, &decodeHeight);
+            ret = read_image_for_model(inputPath.c_str(), decodeWidth, decodeHeight,
+                                       pipelineConfig.fast_decode, &src_image, &decodeScale);
             if (ret != 0) {
                 printf("read image fail! ret=%d image_path=%s\n", ret, inputPath.c_str());
             } else {
                 // 执行推理
                 object_detect_result_list od_results;
-                ret = inference_yolov8_model(&rknn_app_ctx, &src_image, &od_results);
+                init_detect_result_list(&od_results, 0);
+                ret = inference_yolov8_model(models.select_decoded(src_image.width, src_image.height, decodeScale),
+                                             &src_image, &od_results);
                 if (ret != 0) {
                     printf("inference_yolov8_model fail! ret=%d\n", ret);
                 } else {
                     // 绘制检测结果
-                    char text[256];
+                    draw_detect_results(&src_image, &od_results);
+                    restore_detect_results_scale(&od_results, decodeScale);
                     for (int i = 0; i < od_results.count; i++) {
                         object_detect_result *det_result = &(od_results.results[i]);
                         printf("%s @ (%d %d %d %d) %.3f\n", coco_cls_to_name(det_result->cls_id),
                                det_result->box.left, det_result->box.top,
                                det_result->box.right, det_result->box.bottom,
                                det_result->prop);
-                        
-                        int x1 = det_result->box.left;
-                        int y1 = det_result->box.top;
-                        int x2 = det_result->box.right;
-                        int y2 = det_result->box.bottom;
-                        
-                        draw_rectangle(&src_image, x1, y1, x2 - x1, y2 - y1, COLOR_BLUE, 3);
-                        sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
-                        draw_text(&src_image, text, x1, y1 - 20, COLOR_RED, 10);
+                    }
+                    
+                    if (od_results.truncated > 0) {
+                        printf("%d more objects dropped by result limit\n", od_results.truncated);
+                    }
+                    if (od_results.pre_nms_dropped > 0) {
+                        printf("%d low-score candidates dropped before NMS\n", od_results.pre_nms_dropped);
                     }
                     
                     // 保存处理后的图像
                     write_image(outputFileName.c_str(), &src_image);
                     printf("Output saved to: %s\n", outputFileName.c_str());
                 }
+                free_detect_result_list(&od_results);
                 
                 // 释放图像内存
                 if (src_image.virt_addr != NULL) {
@@ -443,7 +767,10 @@ int main(int argc, char **argv)
         printf("Error: Input path is neither a file nor a directory: %s\n", inputPath.c_str());
     }
 
-    // 释放YOLOv8模型资源
+    perf_stats_stop();
+
+    // 释放YOLOv8模型资源（共享权重的模型先释放）
+    models.deinit();
     ret = release_yolov8_model(&rknn_app_ctx); 
     if (ret != 0) 
     {  
@@ -452,6 +779,8 @@ int main(int argc, char **argv)
 
     // 清理后处理模块
     deinit_post_process();  
+    set_image_convert_threads(1, NULL, 0);
+    log_stop_async();
 
     return 0;  // 程序正常退出
 }
@@ -0,0 +1,205 @@
+/**
+ * @file model_registry.cc
+ * @brief 共享权重的多分辨率模型注册表
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "model_registry.h"
+#include "log_utils.h"
+
+ModelRegistry::ModelRegistry() {}
+
+ModelRegistry::~ModelRegistry()
+{
+    deinit();
+}
+
+int ModelRegistry::init(rknn_app_context_t* base_ctx, const char* model_path)
+{
+    if (base_ctx == NULL || base_ctx->rknn_ctx == 0)
+    {
+        return -1;
+    }
+    deinit();
+    ModelEntry entry;
+    entry.app_ctx = base_ctx;
+    entry.path = model_path != NULL ? model_path : "";
+    entry.owns_ctx = false;
+    entries_.push_back(entry);
+    return 0;
+}
+
+int ModelRegistry::add(const char* model_path, const yolov8_init_options_t* opts)
+{
+    if (entries_.empty())
+    {
+        LOGE("ModelRegistry: init with a base context first");
+        return -1;
+    }
+    yolov8_init_options_t share_opts;
+    if (opts != NULL)
+    {
+        share_opts = *opts;
+    }
+    else
+    {
+        memset(&share_opts, 0, sizeof(share_opts));
+    }
+    share_opts.share_weight_ctx = entries_[0].app_ctx->rknn_ctx;
+
+    rknn_app_context_t* app_ctx = new rknn_app_context_t();
+    memset(app_ctx, 0, sizeof(rknn_app_context_t));
+    if (init_yolov8_model_ex(model_path, app_ctx, &share_opts) != 0)
+    {
+        LOGE("ModelRegistry: %s cannot share weights with %s", model_path, entries_[0].path.c_str());
+        release_yolov8_model(app_ctx);
+        delete app_ctx;
+        return -1;
+    }
+    ModelEntry entry;
+    entry.app_ctx = app_ctx;
+    entry.path = model_path;
+    entry.owns_ctx = true;
+    entries_.push_back(entry);
+    LOGI("ModelRegistry: %s (%dx%d) shares weights with %s", model_path, app_ctx->model_width,
+         app_ctx->model_height, entries_[0].path.c_str());
+    return (int)entries_.size() - 1;
+}
+
+void ModelRegistry::deinit()
+{
+    // 共享权重的上下文先于基础上下文释放
+    for (size_t i = entries_.size(); i-- > 0;)
+    {
+        if (entries_[i].owns_ctx)
+        {
+            release_yolov8_model(entries_[i].app_ctx);
+            delete entries_[i].app_ctx;
+        }
+    }
+    entries_.clear();
+}
+
+rknn_app_context_t* ModelRegistry::get(int index)
+{
+    if (index < 0 || index >= (int)entries_.size())
+    {
+        return NULL;
+    }
+    return entries_[index].app_ctx;
+}
+
+rknn_app_context_t* ModelRegistry::find(int model_width, int model_height)
+{
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        if (entries_[i].app_ctx->model_width == model_width && entries_[i].app_ctx->model_height == model_height)
+        {
+            return entries_[i].app_ctx;
+        }
+    }
+    return NULL;
+}
+
+rknn_app_context_t* ModelRegistry::select(int img_width, int img_height)
+{
+    int img_side = img_width > img_height ? img_width : img_height;
+    rknn_app_context_t* best = NULL;
+    int best_side = 0;
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        rknn_app_context_t* app_ctx = entries_[i].app_ctx;
+        int width, height;
+        get_yolov8_max_input_size(app_ctx, &width, &height);
+        int side = width > height ? width : height;
+        // 能容纳图像的模型中选最小的；都容纳不下时选最大的
+        bool fits = side >= img_side;
+        bool best_fits = best != NULL && best_side >= img_side;
+        if (best == NULL || (fits && (!best_fits || side < best_side)) || (!fits && !best_fits && side > best_side))
+        {
+            best = app_ctx;
+            best_side = side;
+        }
+    }
+    return best;
+}
+
+rknn_app_context_t* ModelRegistry::select_decoded(int decoded_width, int decoded_height, float decode_scale)
+{
+    if (decode_scale <= 0.0f)
+    {
+        decode_scale = 1.0f;
+    }
+    return select((int)(decoded_width / decode_scale + 0.5f), (int)(decoded_height / decode_scale + 0.5f));
+}
+
+rknn_app_context_t* ModelRegistry::largest()
+{
+    rknn_app_context_t* best = NULL;
+    int best_area = 0;
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        int width, height;
+        get_yolov8_max_input_size(entries_[i].app_ctx, &width, &height);
+        if (best == NULL || width * height > best_area)
+        {
+            best = entries_[i].app_ctx;
+            best_area = width * height;
+        }
+    }
+    return best;
+}
+
+int ModelRegistry::get_memory(int index, model_memory_t* mem)
+{
+    rknn_app_context_t* app_ctx = get(index);
+    if (app_ctx == NULL)
+    {
+        return -1;
+    }
+    memset(mem, 0, sizeof(model_memory_t));
+    rknn_mem_size mem_size;
+    memset(&mem_size, 0, sizeof(mem_size));
+    int ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size));
+    if (ret != RKNN_SUCC)
+    {
+        LOGW("ModelRegistry: query mem size of %s fail! ret=%d", entries_[index].path.c_str(), ret);
+    }
+    if (entries_[index].owns_ctx)
+    {
+        mem->shared_weight_bytes = mem_size.total_weight_size;
+    }
+    else
+    {
+        mem->weight_bytes = mem_size.total_weight_size;
+    }
+    mem->internal_bytes = mem_size.total_internal_size;
+    mem->io_bytes = (uint64_t)app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
+    for (uint32_t i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        mem->io_bytes += get_yolov8_output_size(app_ctx, i);
+    }
+    return 0;
+}
+
+void ModelRegistry::print_memory()
+{
+    uint64_t total = 0;
+    uint64_t saved = 0;
+    printf("model registry: %zu models\n", entries_.size());
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        model_memory_t mem;
+        get_memory((int)i, &mem);
+        uint64_t ctx_total = mem.weight_bytes + mem.internal_bytes + mem.io_bytes;
+        total += ctx_total;
+        saved += mem.shared_weight_bytes;
+        printf("  [%zu] %dx%d %s: weight=%.2f MB%s internal=%.2f MB io=%.2f MB total=%.2f MB\n", i,
+               entries_[i].app_ctx->model_width, entries_[i].app_ctx->model_height, entries_[i].path.c_str(),
+               (mem.weight_bytes + mem.shared_weight_bytes) / 1048576.0, mem.shared_weight_bytes > 0 ? " (shared)" : "",
+               mem.internal_bytes / 1048576.0, mem.io_bytes / 1048576.0, ctx_total / 1048576.0);
+    }
+    printf("  total=%.2f MB, saved by weight sharing=%.2f MB\n", total / 1048576.0, saved / 1048576.0);
+}
@@ -0,0 +1,182 @@
+/**
+ * @file nms.cc
+ * @brief 基于左边界排序扫描（sorted-x sweep）的贪心NMS
+ *
+ * 逐对比较的NMS是O(n^2)，密集场景下候选数上千时成为后处理的主要耗时。
+ * 两个框有交集的必要条件是x方向区间重叠，因此把候选按左边界排序，
+ * 每个保留框只需扫描左边界在[x1 - 最大框宽, x2]内的一段连续区间。
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "nms.h"
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// 按左边界排序后的候选框副本，扫描区间在内存中连续，便于向量化
+struct SweepBoxes {
+    std::vector<int> order;
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> x2;
+    std::vector<float> y2;
+    std::vector<float> area;
+    std::vector<int> cls;
+    std::vector<int> rank;      // 对应的置信度排名（NmsBoxes中的下标）
+};
+
+struct LeftEdgeLess {
+    const float* x1;
+    bool operator()(int a, int b) const { return x1[a] < x1[b] || (x1[a] == x1[b] && a < b); }
+};
+
+inline float box_area(float x1, float y1, float x2, float y2)
+{
+    return (x2 - x1 + 1.0f) * (y2 - y1 + 1.0f);
+}
+
+// 第i个框是否抑制扫描区间中的第p个框
+inline bool overlaps(const SweepBoxes& s, int p, float x1, float y1, float x2, float y2, float area,
+                     float threshold)
+{
+    float w = std::max(0.0f, std::min(x2, s.x2[p]) - std::max(x1, s.x1[p]) + 1.0f);
+    float h = std::max(0.0f, std::min(y2, s.y2[p]) - std::max(y1, s.y1[p]) + 1.0f);
+    float inter = w * h;
+    float uni = area + s.area[p] - inter;
+    return uni > 0.0f && inter / uni > threshold;
+}
+
+/**
+ * 扫描[begin, end)区间，排名在i之后且被第i个框抑制的框keep置0
+ * 已被抑制的框再次置0没有影响，因此不需要逐个检查keep，向量结果可以直接写回。
+ */
+void suppress_range(const SweepBoxes& s, int begin, int end, int i, float x1, float y1, float x2, float y2,
+                    float area, int cls, bool per_class, float threshold, int* keep)
+{
+    int p = begin;
+#if (defined(__ARM_NEON) && defined(__aarch64__)) || defined(__SSE2__)
+    for (; p + 4 <= end; p += 4)
+    {
+        unsigned int mask[4];
+#if defined(__ARM_NEON) && defined(__aarch64__)
+        float32x4_t one = vdupq_n_f32(1.0f);
+        float32x4_t zero = vdupq_n_f32(0.0f);
+        float32x4_t w = vmaxq_f32(zero, vaddq_f32(vsubq_f32(vminq_f32(vdupq_n_f32(x2), vld1q_f32(&s.x2[p])),
+                                                           vmaxq_f32(vdupq_n_f32(x1), vld1q_f32(&s.x1[p]))), one));
+        float32x4_t h = vmaxq_f32(zero, vaddq_f32(vsubq_f32(vminq_f32(vdupq_n_f32(y2), vld1q_f32(&s.y2[p])),
+                                                           vmaxq_f32(vdupq_n_f32(y1), vld1q_f32(&s.y1[p]))), one));
+        float32x4_t inter = vmulq_f32(w, h);
+        float32x4_t uni = vsubq_f32(vaddq_f32(vdupq_n_f32(area), vld1q_f32(&s.area[p])), inter);
+        uint32x4_t hit = vandq_u32(vcgtq_f32(uni, zero),
+                                   vcgtq_f32(vdivq_f32(inter, uni), vdupq_n_f32(threshold)));
+        if (per_class)
+        {
+            hit = vandq_u32(hit, vceqq_s32(vld1q_s32(&s.cls[p]), vdupq_n_s32(cls)));
+        }
+        vst1q_u32(mask, hit);
+#else
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 zero = _mm_setzero_ps();
+        __m128 w = _mm_max_ps(zero, _mm_add_ps(_mm_sub_ps(_mm_min_ps(_mm_set1_ps(x2), _mm_loadu_ps(&s.x2[p])),
+                                                          _mm_max_ps(_mm_set1_ps(x1), _mm_loadu_ps(&s.x1[p]))), one));
+        __m128 h = _mm_max_ps(zero, _mm_add_ps(_mm_sub_ps(_mm_min_ps(_mm_set1_ps(y2), _mm_loadu_ps(&s.y2[p])),
+                                                          _mm_max_ps(_mm_set1_ps(y1), _mm_loadu_ps(&s.y1[p]))), one));
+        __m128 inter = _mm_mul_ps(w, h);
+        __m128 uni = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(area), _mm_loadu_ps(&s.area[p])), inter);
+        __m128 hit = _mm_and_ps(_mm_cmpgt_ps(uni, zero),
+                                _mm_cmpgt_ps(_mm_div_ps(inter, uni), _mm_set1_ps(threshold)));
+        if (per_class)
+        {
+            __m128i same = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)&s.cls[p]), _mm_set1_epi32(cls));
+            hit = _mm_and_ps(hit, _mm_castsi128_ps(same));
+        }
+        _mm_storeu_si128((__m128i*)mask, _mm_castps_si128(hit));
+#endif
+        for (int k = 0; k < 4; k++)
+        {
+            if (mask[k] && s.rank[p + k] > i)
+            {
+                keep[s.rank[p + k]] = 0;
+            }
+        }
+    }
+#endif
+    for (; p < end; p++)
+    {
+        if ((!per_class || s.cls[p] == cls) && s.rank[p] > i && overlaps(s, p, x1, y1, x2, y2, area, threshold))
+        {
+            keep[s.rank[p]] = 0;
+        }
+    }
+}
+
+} // namespace
+
+int nms_sorted(NmsBoxes& boxes, int count, float iou_threshold, nms_mode_t mode)
+{
+    static thread_local SweepBoxes s;
+    if (count <= 0)
+    {
+        return 0;
+    }
+    boxes.keep.assign(count, 1);
+
+    // 按左边界排序并整理为连续数组
+    s.order.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        s.order[i] = i;
+    }
+    LeftEdgeLess cmp = {boxes.x1.data()};
+    std::sort(s.order.begin(), s.order.end(), cmp);
+
+    s.x1.resize(count);
+    s.y1.resize(count);
+    s.x2.resize(count);
+    s.y2.resize(count);
+    s.area.resize(count);
+    s.cls.resize(count);
+    s.rank.resize(count);
+    float max_width = 0.0f;
+    for (int p = 0; p < count; p++)
+    {
+        int r = s.order[p];
+        s.x1[p] = boxes.x1[r];
+        s.y1[p] = boxes.y1[r];
+        s.x2[p] = boxes.x2[r];
+        s.y2[p] = boxes.y2[r];
+        s.area[p] = box_area(boxes.x1[r], boxes.y1[r], boxes.x2[r], boxes.y2[r]);
+        s.cls[p] = boxes.cls[r];
+        s.rank[p] = r;
+        max_width = std::max(max_width, boxes.x2[r] - boxes.x1[r]);
+    }
+
+    bool per_class = (mode == NMS_PER_CLASS);
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!boxes.keep[i])
+        {
+            continue;
+        }
+        kept++;
+        float x1 = boxes.x1[i];
+        float y1 = boxes.y1[i];
+        float x2 = boxes.x2[i];
+        float y2 = boxes.y2[i];
+        // 与i在x方向有交集的框，左边界必然落在[x1 - max_width - 1, x2 + 1]内（多留1像素余量）
+        int begin = std::lower_bound(s.x1.begin(), s.x1.end(), x1 - max_width - 2.0f) - s.x1.begin();
+        int end = std::upper_bound(s.x1.begin() + begin, s.x1.end(), x2 + 2.0f) - s.x1.begin();
+        suppress_range(s, begin, end, i, x1, y1, x2, y2, box_area(x1, y1, x2, y2), boxes.cls[i], per_class,
+                       iou_threshold, boxes.keep.data());
+    }
+    return kept;
+}
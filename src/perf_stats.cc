@@ -0,0 +1,263 @@
+/**
+ * @file perf_stats.cc
+ * @brief 分阶段耗时统计：无锁直方图，SIGUSR1或退出时输出JSON
+ *
+ * 直方图按HDR Histogram的思路分桶：小于16ns的值每个一桶，之后每个2的幂区间等分为16个子桶，
+ * 桶宽与数值成比例，分位数的相对误差不超过1/16，而总桶数只有几百个。
+ */
+
+#include <errno.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "perf_stats.h"
+
+namespace {
+
+const int SUB_BUCKET_BITS = 4;
+const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+const int MAX_EXPONENT = 40;    // 2^40 ns约18分钟，更大的值计入最后一个桶
+const int BUCKET_NUM = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+const char* stage_names[PERF_STAGE_NUM] = {"read", "letterbox", "inputs_set", "run",
+                                           "outputs_get", "postprocess", "draw", "encode",
+                                           "batch_wait"};
+
+struct StageHistogram {
+    std::atomic<uint64_t> buckets[BUCKET_NUM];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<int64_t> max_ns;
+};
+
+StageHistogram g_histograms[PERF_STAGE_NUM];
+int64_t g_start_ns = perf_now_ns();
+
+int bucket_index(uint64_t v)
+{
+    if (v < (uint64_t)SUB_BUCKETS)
+    {
+        return (int)v;
+    }
+    int e = 63 - __builtin_clzll(v);
+    if (e > MAX_EXPONENT)
+    {
+        return BUCKET_NUM - 1;
+    }
+    int mantissa = (int)(v >> (e - SUB_BUCKET_BITS));    // [16, 32)
+    return (e - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + mantissa - SUB_BUCKETS;
+}
+
+// 桶的中点，作为落在该桶中的值的估计
+double bucket_value(int index)
+{
+    if (index < SUB_BUCKETS)
+    {
+        return index;
+    }
+    int e = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int mantissa = index % SUB_BUCKETS + SUB_BUCKETS;
+    double width = (double)(1ULL << (e - SUB_BUCKET_BITS));
+    return mantissa * width + width / 2;
+}
+
+// 从快照中取分位数，结果不超过实际最大值
+double percentile_ns(const uint64_t* snapshot, uint64_t total, double p, int64_t max_ns)
+{
+    uint64_t rank = (uint64_t)(p * total + 0.5);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_NUM; i++)
+    {
+        seen += snapshot[i];
+        if (seen >= rank)
+        {
+            double v = bucket_value(i);
+            return v < max_ns ? v : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+// SIGUSR1处理：信号处理函数中只调用异步信号安全的sem_post，由监听线程写文件
+sem_t g_dump_sem;
+std::thread g_dump_thread;
+std::atomic<bool> g_dump_stop(false);
+bool g_started = false;
+std::string g_json_path;
+
+void on_sigusr1(int)
+{
+    sem_post(&g_dump_sem);
+}
+
+void write_json()
+{
+    if (g_json_path == "-")
+    {
+        perf_dump_json(stdout);
+        fflush(stdout);
+        return;
+    }
+    std::string tmp = g_json_path + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "w");
+    if (fp == NULL)
+    {
+        printf("perf_stats: open %s fail: %s\n", tmp.c_str(), strerror(errno));
+        return;
+    }
+    perf_dump_json(fp);
+    fclose(fp);
+    if (rename(tmp.c_str(), g_json_path.c_str()) != 0)
+    {
+        printf("perf_stats: rename to %s fail: %s\n", g_json_path.c_str(), strerror(errno));
+    }
+}
+
+void dump_loop()
+{
+    while (true)
+    {
+        if (sem_wait(&g_dump_sem) != 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if (g_dump_stop)
+        {
+            break;
+        }
+        write_json();
+    }
+}
+
+} // namespace
+
+int64_t perf_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void perf_record(perf_stage_t stage, int64_t elapsed_ns)
+{
+    if (stage < 0 || stage >= PERF_STAGE_NUM)
+    {
+        return;
+    }
+    if (elapsed_ns < 0)
+    {
+        elapsed_ns = 0;
+    }
+    StageHistogram& h = g_histograms[stage];
+    h.buckets[bucket_index((uint64_t)elapsed_ns)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.sum_ns.fetch_add((uint64_t)elapsed_ns, std::memory_order_relaxed);
+    int64_t prev = h.max_ns.load(std::memory_order_relaxed);
+    while (elapsed_ns > prev && !h.max_ns.compare_exchange_weak(prev, elapsed_ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+void perf_reset()
+{
+    for (int s = 0; s < PERF_STAGE_NUM; s++)
+    {
+        StageHistogram& h = g_histograms[s];
+        for (int i = 0; i < BUCKET_NUM; i++)
+        {
+            h.buckets[i].store(0, std::memory_order_relaxed);
+        }
+        h.count.store(0, std::memory_order_relaxed);
+        h.sum_ns.store(0, std::memory_order_relaxed);
+        h.max_ns.store(0, std::memory_order_relaxed);
+    }
+    g_start_ns = perf_now_ns();
+}
+
+void perf_dump_json(FILE* fp)
+{
+    uint64_t snapshot[BUCKET_NUM];
+    fprintf(fp, "{\n  \"uptime_ms\": %.3f,\n  \"stages\": {", (perf_now_ns() - g_start_ns) / 1e6);
+    bool first = true;
+    for (int s = 0; s < PERF_STAGE_NUM; s++)
+    {
+        StageHistogram& h = g_histograms[s];
+        // 快照期间其他线程仍在记录，总数以快照中各桶之和为准，保证分位数自洽
+        uint64_t total = 0;
+        for (int i = 0; i < BUCKET_NUM; i++)
+        {
+            snapshot[i] = h.buckets[i].load(std::memory_order_relaxed);
+            total += snapshot[i];
+        }
+        if (total == 0)
+        {
+            continue;
+        }
+        uint64_t count = h.count.load(std::memory_order_relaxed);
+        uint64_t sum_ns = h.sum_ns.load(std::memory_order_relaxed);
+        int64_t max_ns = h.max_ns.load(std::memory_order_relaxed);
+        fprintf(fp,
+                "%s\n    \"%s\": {\"count\": %llu, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, "
+                "\"p99_us\": %.3f, \"max_us\": %.3f}",
+                first ? "" : ",", stage_names[s], (unsigned long long)count,
+                count > 0 ? sum_ns / 1e3 / count : 0.0, percentile_ns(snapshot, total, 0.50, max_ns) / 1e3,
+                percentile_ns(snapshot, total, 0.90, max_ns) / 1e3,
+                percentile_ns(snapshot, total, 0.99, max_ns) / 1e3, max_ns / 1e3);
+        first = false;
+    }
+    fprintf(fp, "%s}\n}\n", first ? "" : "\n  ");
+}
+
+int perf_stats_start(const char* json_path)
+{
+    if (g_started || json_path == NULL)
+    {
+        return -1;
+    }
+    if (sem_init(&g_dump_sem, 0, 0) != 0)
+    {
+        printf("perf_stats: sem_init fail: %s\n", strerror(errno));
+        return -1;
+    }
+    g_json_path = json_path;
+    g_dump_stop = false;
+    g_dump_thread = std::thread(dump_loop);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigusr1;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+    g_started = true;
+    return 0;
+}
+
+void perf_stats_stop()
+{
+    if (!g_started)
+    {
+        return;
+    }
+    signal(SIGUSR1, SIG_IGN);
+    g_dump_stop = true;
+    sem_post(&g_dump_sem);
+    g_dump_thread.join();
+    sem_destroy(&g_dump_sem);
+    write_json();
+    g_started = false;
+}
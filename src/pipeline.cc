@@ -0,0 +1,405 @@
+/**
+ * @file pipeline.cc
+ * @brief 文件夹批处理流水线：解码、预处理、推理、后处理、编码分阶段并行执行
+ *
+ * 串行处理时NPU在解码和编码期间处于空闲状态。流水线将各阶段放到独立线程中，
+ * 吞吐量取决于最慢的阶段，而不是所有阶段耗时之和。帧缓冲在启动时一次性分配，
+ * 处理完成后回收到空闲队列重复使用，空闲队列同时限制了在途帧的数量。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "pipeline.h"
+#include "bounded_queue.h"
+#include "image_io.h"
+#include "image_utils.h"
+#include "log_utils.h"
+
+namespace {
+
+enum PipelineStage {
+    STAGE_DECODE = 0,
+    STAGE_PREPROCESS,
+    STAGE_INFERENCE,
+    STAGE_POSTPROCESS,
+    STAGE_ENCODE,
+    STAGE_NUM
+};
+
+const char* stage_names[STAGE_NUM] = {"decode", "preprocess", "inference", "postprocess", "encode"};
+
+struct PipelineFrame {
+    size_t item_index;
+    image_buffer_t src_image;
+    image_buffer_t model_input;     // 预分配的模型输入缓冲区
+    letterbox_t letter_box;
+    float decode_scale;
+    std::vector<rknn_output> outputs;
+    object_detect_result_list od_results;
+};
+
+typedef BoundedQueue<PipelineFrame*> FrameQueue;
+
+int64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class FolderPipeline
+{
+public:
+    FolderPipeline(rknn_app_context_t* app_ctx, RknnContextPool* pool, const std::vector<pipeline_item_t>& items,
+                   const pipeline_config_t& config)
+        : app_ctx_(app_ctx), pool_(pool), items_(items), config_(config), free_frames_(config.max_inflight),
+          next_item_(0), processed_(0)
+    {
+        for (int i = 0; i < STAGE_NUM; i++)
+        {
+            queues_.push_back(new FrameQueue(config.queue_depth));
+            stage_busy_us_[i] = 0;
+            stage_count_[i] = 0;
+        }
+    }
+
+    ~FolderPipeline()
+    {
+        for (size_t i = 0; i < queues_.size(); i++)
+        {
+            delete queues_[i];
+        }
+        for (size_t i = 0; i < frames_.size(); i++)
+        {
+            release_frame(frames_[i]);
+        }
+    }
+
+    int run()
+    {
+        if (allocate_frames() != 0)
+        {
+            return -1;
+        }
+
+        int workers[STAGE_NUM] = {config_.decode_workers, config_.preprocess_workers, config_.inference_workers,
+                                  config_.postprocess_workers, config_.encode_workers};
+        std::vector<std::thread> threads;
+        int64_t start_us = now_us();
+        for (int stage = 0; stage < STAGE_NUM; stage++)
+        {
+            remaining_workers_[stage] = workers[stage];
+            for (int w = 0; w < workers[stage]; w++)
+            {
+                threads.push_back(std::thread(&FolderPipeline::stage_loop, this, stage));
+            }
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            threads[i].join();
+        }
+        int64_t wall_us = now_us() - start_us;
+
+        print_summary(wall_us);
+        return processed_;
+    }
+
+private:
+    int allocate_frames()
+    {
+        for (int i = 0; i < config_.max_inflight; i++)
+        {
+            PipelineFrame* frame = new PipelineFrame();
+            memset(&frame->src_image, 0, sizeof(image_buffer_t));
+            memset(&frame->model_input, 0, sizeof(image_buffer_t));
+            init_detect_result_list(&frame->od_results, 0);
+            frame->model_input.width = app_ctx_->model_width;
+            frame->model_input.height = app_ctx_->model_height;
+            frame->model_input.format = IMAGE_FORMAT_RGB888;
+            frame->model_input.size = get_image_size(&frame->model_input);
+            frame->model_input.virt_addr = (unsigned char*)malloc(frame->model_input.size);
+
+            frame->outputs.resize(app_ctx_->io_num.n_output);
+            memset(frame->outputs.data(), 0, frame->outputs.size() * sizeof(rknn_output));
+            frames_.push_back(frame);
+
+            if (frame->model_input.virt_addr == NULL)
+            {
+                printf("pipeline: alloc model input buffer fail\n");
+                return -1;
+            }
+            for (size_t k = 0; k < frame->outputs.size(); k++)
+            {
+                int size = get_yolov8_output_size(app_ctx_, k);
+                frame->outputs[k].buf = malloc(size);
+                frame->outputs[k].size = size;
+                if (frame->outputs[k].buf == NULL)
+                {
+                    printf("pipeline: alloc output buffer %zu fail\n", k);
+                    return -1;
+                }
+            }
+            free_frames_.push(frame);
+        }
+        return 0;
+    }
+
+    void release_frame(PipelineFrame* frame)
+    {
+        free_image_buffer(&frame->src_image);
+        free_image_buffer(&frame->model_input);
+        for (size_t k = 0; k < frame->outputs.size(); k++)
+        {
+            free(frame->outputs[k].buf);
+        }
+        free_detect_result_list(&frame->od_results);
+        delete frame;
+    }
+
+    // 帧处理结束（成功或失败），释放源图像并放回空闲队列
+    void recycle(PipelineFrame* frame)
+    {
+        free_image_buffer(&frame->src_image);
+        free_frames_.push(frame);
+    }
+
+    bool acquire_next(PipelineFrame*& frame)
+    {
+        size_t index = next_item_.fetch_add(1);
+        if (index >= items_.size())
+        {
+            return false;
+        }
+        if (!free_frames_.pop(frame))
+        {
+            return false;
+        }
+        frame->item_index = index;
+        return true;
+    }
+
+    // busy_us：本阶段的处理耗时，推理阶段只计run_yolov8_model本身，不含等待上下文/锁的时间
+    bool process(int stage, PipelineFrame* frame, int64_t* busy_us)
+    {
+        int64_t t0 = now_us();
+        const pipeline_item_t& item = items_[frame->item_index];
+        int ret = 0;
+        switch (stage)
+        {
+        case STAGE_DECODE:
+            ret = read_image_for_model(item.input_path.c_str(), app_ctx_->model_width, app_ctx_->model_height,
+                                       config_.fast_decode, &frame->src_image, &frame->decode_scale);
+            break;
+        case STAGE_PREPROCESS:
+            ret = preprocess_yolov8_model(app_ctx_, &frame->src_image, &frame->model_input, &frame->letter_box);
+            break;
+        case STAGE_INFERENCE:
+            if (pool_ != NULL)
+            {
+                rknn_app_context_t* ctx = pool_->acquire();
+                t0 = now_us();
+                ret = run_yolov8_model(ctx, &frame->model_input, frame->outputs.data());
+                *busy_us = now_us() - t0;
+                pool_->release(ctx);
+            }
+            else
+            {
+                // 同一个rknn_context上的inputs_set/run/outputs_get必须串行
+                std::lock_guard<std::mutex> lock(rknn_mutex_);
+                t0 = now_us();
+                ret = run_yolov8_model(app_ctx_, &frame->model_input, frame->outputs.data());
+                *busy_us = now_us() - t0;
+            }
+            break;
+        case STAGE_POSTPROCESS:
+            ret = post_process(app_ctx_, frame->outputs.data(), &frame->letter_box, BOX_THRESH, NMS_THRESH,
+                               &frame->od_results);
+            break;
+        case STAGE_ENCODE:
+            draw_detect_results(&frame->src_image, &frame->od_results);
+            ret = write_image(item.output_path.c_str(), &frame->src_image);
+            if (ret == 0)
+            {
+                LOGI("%s: %d objects -> %s", item.input_path.c_str(), frame->od_results.count,
+                       item.output_path.c_str());
+                processed_++;
+                if (config_.checkpoint != NULL)
+                {
+                    config_.checkpoint->mark_done(item.key);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        if (stage != STAGE_INFERENCE)
+        {
+            *busy_us = now_us() - t0;
+        }
+        if (ret != 0)
+        {
+            LOGE("pipeline %s fail! ret=%d image_path=%s", stage_names[stage], ret, item.input_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void stage_loop(int stage)
+    {
+        FrameQueue* in = stage > 0 ? queues_[stage - 1] : NULL;
+        FrameQueue* out = stage < STAGE_NUM - 1 ? queues_[stage] : NULL;
+        PipelineFrame* frame = NULL;
+
+        while (stage == STAGE_DECODE ? acquire_next(frame) : in->pop(frame))
+        {
+            int64_t busy_us = 0;
+            bool ok = process(stage, frame, &busy_us);
+            stage_busy_us_[stage] += busy_us;
+            stage_count_[stage]++;
+
+            if (!ok || out == NULL)
+            {
+                recycle(frame);
+            }
+            else
+            {
+                out->push(frame);
+            }
+        }
+
+        // 本阶段最后一个线程退出时关闭下游队列，下游处理完剩余帧后依次退出
+        if (--remaining_workers_[stage] == 0 && out != NULL)
+        {
+            out->close();
+        }
+    }
+
+    void print_summary(int64_t wall_us)
+    {
+        double wall_ms = wall_us / 1000.0;
+        printf("\n=== 流水线统计 ===\n");
+        printf("处理图像: %d/%zu, 总耗时: %.2f ms, 吞吐: %.2f FPS\n", processed_.load(), items_.size(), wall_ms,
+               wall_us > 0 ? processed_ * 1000000.0 / wall_us : 0.0);
+        for (int stage = 0; stage < STAGE_NUM; stage++)
+        {
+            int64_t count = stage_count_[stage];
+            printf("  %-12s 平均 %.2f ms/帧, 累计 %.2f ms\n", stage_names[stage],
+                   count > 0 ? stage_busy_us_[stage] / 1000.0 / count : 0.0, stage_busy_us_[stage] / 1000.0);
+        }
+        if (wall_us > 0)
+        {
+            int contexts = pool_ != NULL ? pool_->size() : 1;
+            printf("  NPU占用率: %.1f%% (%d个上下文)\n", 100.0 * stage_busy_us_[STAGE_INFERENCE] / wall_us / contexts,
+                   contexts);
+        }
+        if (pool_ != NULL)
+        {
+            pool_->print_stats();
+        }
+    }
+
+    rknn_app_context_t* app_ctx_;
+    RknnContextPool* pool_;
+    const std::vector<pipeline_item_t>& items_;
+    pipeline_config_t config_;
+
+    std::vector<PipelineFrame*> frames_;
+    std::vector<FrameQueue*> queues_;
+    FrameQueue free_frames_;
+    std::mutex rknn_mutex_;
+
+    std::atomic<size_t> next_item_;
+    std::atomic<int> processed_;
+    std::atomic<int> remaining_workers_[STAGE_NUM];
+    std::atomic<int64_t> stage_busy_us_[STAGE_NUM];
+    std::atomic<int64_t> stage_count_[STAGE_NUM];
+};
+
+} // namespace
+
+void init_pipeline_config(pipeline_config_t* config)
+{
+    config->decode_workers = 2;
+    config->preprocess_workers = 2;
+    config->inference_workers = 1;
+    config->postprocess_workers = 1;
+    config->encode_workers = 2;
+    config->queue_depth = 4;
+    config->max_inflight = 12;
+    config->npu_contexts = 1;
+    config->schedule_policy = POOL_SCHEDULE_ROUND_ROBIN;
+    config->fast_decode = false;
+    config->checkpoint = NULL;
+}
+
+int parse_pipeline_workers(const char* spec, pipeline_config_t* config)
+{
+    int workers[STAGE_NUM];
+    if (sscanf(spec, "%d:%d:%d:%d:%d", &workers[0], &workers[1], &workers[2], &workers[3], &workers[4]) != STAGE_NUM)
+    {
+        return -1;
+    }
+    for (int i = 0; i < STAGE_NUM; i++)
+    {
+        if (workers[i] <= 0)
+        {
+            return -1;
+        }
+    }
+    config->decode_workers = workers[0];
+    config->preprocess_workers = workers[1];
+    config->inference_workers = workers[2];
+    config->postprocess_workers = workers[3];
+    config->encode_workers = workers[4];
+    return 0;
+}
+
+int run_folder_pipeline(rknn_app_context_t* app_ctx, const std::vector<pipeline_item_t>& items,
+                        const pipeline_config_t* config)
+{
+    if (app_ctx == NULL || config == NULL)
+    {
+        return -1;
+    }
+    if (items.empty())
+    {
+        return 0;
+    }
+
+    pipeline_config_t cfg = *config;
+
+    // 多个推理上下文时，推理线程数至少与上下文数相同，才能让每个NPU核心都保持忙碌
+    RknnContextPool pool;
+    RknnContextPool* pool_ptr = NULL;
+    if (cfg.npu_contexts > 1)
+    {
+        if (pool.init(app_ctx, cfg.npu_contexts, cfg.schedule_policy) != 0)
+        {
+            printf("pipeline: init rknn context pool fail\n");
+            return -1;
+        }
+        pool_ptr = &pool;
+        if (cfg.inference_workers < cfg.npu_contexts)
+        {
+            cfg.inference_workers = cfg.npu_contexts;
+        }
+    }
+
+    // 在途帧数至少要覆盖所有工作线程，否则部分线程永远拿不到帧
+    int total_workers = cfg.decode_workers + cfg.preprocess_workers + cfg.inference_workers +
+                        cfg.postprocess_workers + cfg.encode_workers;
+    if (cfg.max_inflight < total_workers)
+    {
+        cfg.max_inflight = total_workers;
+    }
+
+    FolderPipeline pipeline(app_ctx, pool_ptr, items, cfg);
+    return pipeline.run();
+}
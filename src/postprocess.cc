@@ -1,4 +1,7 @@
 #include "yolov8.h"
+#include "nms.h"
+#include "perf_stats.h"
+#include "log_utils.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -7,14 +10,36 @@
 #include <string.h>
 #include <sys/time.h>
 
-#include <set>
+#include <algorithm>
 #include <vector>
 
-// 直接在代码中定义标签信息，移除txt文件依赖
-static const char* class_labels[OBJ_CLASS_NUM] = {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 每个坐标分量分布长度的上限（YOLOv8默认reg_max=16）
+#define DFL_MAX_LEN 64
+
+static nms_mode_t g_nms_mode = NMS_PER_CLASS;
+static int g_max_results = OBJ_NUMB_DEFAULT_MAX;  // max_count为0的结果列表使用的上限
+
+// 列表的结果上限：max_count为0时使用全局上限
+static int detect_result_limit(const object_detect_result_list *list)
+{
+    return list->max_count > 0 ? list->max_count : g_max_results;
+}
+
+// 未指定标签文件时使用的内置标签
+static const char* builtin_labels[] = {
     "pot"  // 唯一的类别
 };
 
+// 从标签文件读取的标签（每行一个类别名），由init_post_process加载、deinit_post_process释放
+static char* file_labels[OBJ_CLASS_MAX_NUM];
+static int file_label_num = 0;
+
 inline static int clamp(float val, int min, int max) { return val > min ? (val < max ? val : max) : min; }
 
 static char *readLine(FILE *fp, char *buffer, int *len)
@@ -80,89 +105,51 @@ static int readLines(const char *fileName, char *lines[], int max_line)
 static int loadLabelName(const char *locationFilename, char *label[])
 {
     printf("load lable %s\n", locationFilename);
-    readLines(locationFilename, label, OBJ_CLASS_NUM);
-    return 0;
-}
-
-static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,
-                              float ymax1)
-{
-    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
-    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
-    float i = w * h;
-    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
-    return u <= 0.f ? 0.f : (i / u);
-}
-
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,
-               int filterId, float threshold)
-{
-    for (int i = 0; i < validCount; ++i)
+    int n = readLines(locationFilename, label, OBJ_CLASS_MAX_NUM);
+    // 去掉Windows换行符残留的'\r'
+    for (int i = 0; i < n; i++)
     {
-        int n = order[i];
-        if (n == -1 || classIds[n] != filterId)
+        size_t len = strlen(label[i]);
+        if (len > 0 && label[i][len - 1] == '\r')
         {
-            continue;
-        }
-        for (int j = i + 1; j < validCount; ++j)
-        {
-            int m = order[j];
-            if (m == -1 || classIds[m] != filterId)
-            {
-                continue;
-            }
-            float xmin0 = outputLocations[n * 4 + 0];
-            float ymin0 = outputLocations[n * 4 + 1];
-            float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
-            float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
-
-            float xmin1 = outputLocations[m * 4 + 0];
-            float ymin1 = outputLocations[m * 4 + 1];
-            float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
-            float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
-
-            float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
-
-            if (iou > threshold)
-            {
-                order[j] = -1;
-            }
+            label[i][len - 1] = '\0';
         }
     }
-    return 0;
+    return n;
 }
 
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices)
+/**
+ * 【功能】候选框排序规则：置信度降序，置信度相同时原始下标升序
+ * 【说明】严格全序，std::sort（内省排序，最坏O(n log n)）的结果与稳定排序相同，
+ *        大量同分或已经有序的输入也不会退化
+ */
+struct ScoreGreater {
+    const float* scores;
+    bool operator()(int a, int b) const
+    {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    }
+};
+
+/**
+ * 【功能】选出置信度最高的top_k个候选并排序，结果写入order
+ * 【说明】候选数超过top_k时先用nth_element做O(n)划分，只对前top_k个排序
+ */
+static int select_top_k(const std::vector<float> &scores, int count, int top_k, std::vector<int> &order)
 {
-    float key;
-    int key_index;
-    int low = left;
-    int high = right;
-    if (left < right)
-    {
-        key_index = indices[left];
-        key = input[left];
-        while (low < high)
-        {
-            while (low < high && input[high] <= key)
-            {
-                high--;
-            }
-            input[low] = input[high];
-            indices[low] = indices[high];
-            while (low < high && input[low] >= key)
-            {
-                low++;
-            }
-            input[high] = input[low];
-            indices[high] = indices[low];
-        }
-        input[low] = key;
-        indices[low] = key_index;
-        quick_sort_indice_inverse(input, left, low - 1, indices);
-        quick_sort_indice_inverse(input, low + 1, right, indices);
+    order.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        order[i] = i;
     }
-    return low;
+    ScoreGreater cmp = {scores.data()};
+    if (top_k > 0 && count > top_k)
+    {
+        std::nth_element(order.begin(), order.begin() + top_k, order.end(), cmp);
+        order.resize(top_k);
+    }
+    std::sort(order.begin(), order.end(), cmp);
+    return (int)order.size();
 }
 
 static float sigmoid(float x) { return 1.0 / (1.0 + expf(-x)); }
@@ -193,233 +180,495 @@ static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) { return (
 
 static float deqnt_affine_u8_to_f32(uint8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
 
-static void compute_dfl(float* tensor, int dfl_len, float* box){
-    for (int b=0; b<4; b++){
-        float exp_t[dfl_len];
-        float exp_sum=0;
-        float acc_sum=0;
-        for (int i=0; i< dfl_len; i++){
-            exp_t[i] = exp(tensor[i+b*dfl_len]);
-            exp_sum += exp_t[i];
+/**
+ * 【功能】DFL期望值：sum(i * w[i]) / sum(w[i])，w为未归一化的softmax权重
+ * 【语法】NEON/SSE每次累加4个bin，剩余部分标量处理
+ */
+static inline float dfl_expectation(const float* w, int n)
+{
+    float sum = 0;
+    float acc = 0;
+    int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    static const float idx_init[4] = {0, 1, 2, 3};
+    float32x4_t vidx = vld1q_f32(idx_init);
+    float32x4_t vstep = vdupq_n_f32(4.0f);
+    float32x4_t vsum = vdupq_n_f32(0.0f);
+    float32x4_t vacc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4)
+    {
+        float32x4_t v = vld1q_f32(w + i);
+        vsum = vaddq_f32(vsum, v);
+        vacc = vmlaq_f32(vacc, v, vidx);
+        vidx = vaddq_f32(vidx, vstep);
+    }
+    float32x2_t s2 = vadd_f32(vget_low_f32(vsum), vget_high_f32(vsum));
+    float32x2_t a2 = vadd_f32(vget_low_f32(vacc), vget_high_f32(vacc));
+    sum = vget_lane_f32(vpadd_f32(s2, s2), 0);
+    acc = vget_lane_f32(vpadd_f32(a2, a2), 0);
+#elif defined(__SSE2__)
+    __m128 vidx = _mm_setr_ps(0, 1, 2, 3);
+    __m128 vstep = _mm_set1_ps(4.0f);
+    __m128 vsum = _mm_setzero_ps();
+    __m128 vacc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(w + i);
+        vsum = _mm_add_ps(vsum, v);
+        vacc = _mm_add_ps(vacc, _mm_mul_ps(v, vidx));
+        vidx = _mm_add_ps(vidx, vstep);
+    }
+    float s4[4], a4[4];
+    _mm_storeu_ps(s4, vsum);
+    _mm_storeu_ps(a4, vacc);
+    sum = (s4[0] + s4[1]) + (s4[2] + s4[3]);
+    acc = (a4[0] + a4[1]) + (a4[2] + a4[3]);
+#endif
+    for (; i < n; i++)
+    {
+        sum += w[i];
+        acc += w[i] * i;
+    }
+    return acc / sum;
+}
+
+/**
+ * 【功能】浮点DFL解码，tensor为NCHW布局，同一bin在相邻通道间相隔grid_len
+ * 【说明】减去最大值后再求exp，避免溢出（softmax对整体平移不变）
+ */
+static void compute_dfl(const float* tensor, int grid_len, int dfl_len, float* box)
+{
+    float w[DFL_MAX_LEN];
+    for (int b = 0; b < 4; b++)
+    {
+        const float* p = tensor + (size_t)b * dfl_len * grid_len;
+        float max_v = p[0];
+        for (int i = 1; i < dfl_len; i++)
+        {
+            max_v = std::max(max_v, p[(size_t)i * grid_len]);
         }
-        
-        for (int i=0; i< dfl_len; i++){
-            acc_sum += exp_t[i]/exp_sum *i;
+        for (int i = 0; i < dfl_len; i++)
+        {
+            w[i] = expf(p[(size_t)i * grid_len] - max_v);
         }
-        box[b] = acc_sum;
+        box[b] = dfl_expectation(w, dfl_len);
     }
 }
 
-static int process_u8(uint8_t *box_tensor, int32_t box_zp, float box_scale,
+/**
+ * 【功能】量化域DFL解码所用的exp查找表
+ * 【说明】softmax对整体平移不变，减去同一分量内的最大量化值后，
+ *        bin的权重只取决于量化差值d = max_q - q（0~255）：w = exp(-d * scale)，与零点无关。
+ *        因此每个scale只需一张256项的表，int8/uint8共用，不需要先反量化再调用exp。
+ *        表项为float，与浮点路径相比误差来自求和顺序，期望值误差<1e-4个bin（乘以stride后远小于1像素）。
+ */
+struct DflExpLut {
+    float scale;
+    float exp_lut[256];
+};
+
+static const float* get_dfl_exp_lut(float scale)
+{
+    // 【语法】每个线程缓存最近使用的表：三个分支的box输出通常共用同一个scale
+    static thread_local DflExpLut lut = {0.0f, {0}};
+    if (lut.scale != scale)
+    {
+        for (int d = 0; d < 256; d++)
+        {
+            lut.exp_lut[d] = expf(-d * scale);
+        }
+        lut.scale = scale;
+    }
+    return lut.exp_lut;
+}
+
+/**
+ * 【功能】量化域DFL解码：直接读取int8/uint8 logits，查表得到softmax权重
+ * 【语法】模板参数T为int8_t或uint8_t
+ */
+template <typename T>
+static void compute_dfl_quant(const T* tensor, int grid_len, int dfl_len, const float* exp_lut, float* box)
+{
+    float w[DFL_MAX_LEN];
+    int q[DFL_MAX_LEN];
+    for (int b = 0; b < 4; b++)
+    {
+        const T* p = tensor + (size_t)b * dfl_len * grid_len;
+        int max_q = p[0];
+        for (int i = 0; i < dfl_len; i++)
+        {
+            q[i] = p[(size_t)i * grid_len];
+            max_q = std::max(max_q, q[i]);
+        }
+        for (int i = 0; i < dfl_len; i++)
+        {
+            w[i] = exp_lut[max_q - q[i]];
+        }
+        box[b] = dfl_expectation(w, dfl_len);
+    }
+}
+
+/**
+ * 【功能】网格预筛选：一次扫描score tensor（有score_sum时只扫描score_sum），
+ *        输出最大值大于阈值的网格下标，后续的类别比较和DFL解码只在这些网格上进行
+ * 【说明】tensor为NCHW布局，每个类别是一个连续的grid_len平面。逐网格按grid_len跨步访问各类别
+ *        对缓存不友好；这里按平面顺序读取，每次处理16个网格（NEON/SSE2），对各平面逐元素取最大值。
+ *        uint8数据异或0x80后按有符号比较，int8/uint8共用同一套指令。
+ * @param thres 与数据同域的量化阈值，选出max > thres的网格
+ */
+template <bool IS_UNSIGNED>
+static int prefilter_cells_q8(const void *base, int planes, int grid_len, int thres, std::vector<int> &cells)
+{
+    cells.clear();
+    const uint8_t flip = IS_UNSIGNED ? 0x80 : 0;
+    int sthr = IS_UNSIGNED ? thres - 128 : thres;   // 映射到有符号域
+    if (sthr >= 127)
+    {
+        return 0;
+    }
+    if (sthr < -128)
+    {
+        for (int c = 0; c < grid_len; c++)
+        {
+            cells.push_back(c);
+        }
+        return grid_len;
+    }
+
+    const uint8_t *p = (const uint8_t *)base;
+    int c = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    int8x16_t vthr = vdupq_n_s8((int8_t)sthr);
+    uint8x16_t vflip = vdupq_n_u8(flip);
+    for (; c + 16 <= grid_len; c += 16)
+    {
+        int8x16_t m = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(p + c), vflip));
+        for (int k = 1; k < planes; k++)
+        {
+            m = vmaxq_s8(m, vreinterpretq_s8_u8(veorq_u8(vld1q_u8(p + (size_t)k * grid_len + c), vflip)));
+        }
+        uint8x16_t hit = vcgtq_s8(m, vthr);
+        if (vmaxvq_u8(hit) == 0)
+        {
+            continue;
+        }
+        uint8_t lanes[16];
+        vst1q_u8(lanes, hit);
+        for (int l = 0; l < 16; l++)
+        {
+            if (lanes[l])
+            {
+                cells.push_back(c + l);
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    __m128i vthr = _mm_set1_epi8((char)sthr);
+    __m128i vflip = _mm_set1_epi8((char)flip);
+    for (; c + 16 <= grid_len; c += 16)
+    {
+        __m128i m = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + c)), vflip);
+        for (int k = 1; k < planes; k++)
+        {
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + (size_t)k * grid_len + c)), vflip);
+            __m128i gt = _mm_cmpgt_epi8(v, m);
+            m = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, m));
+        }
+        int bits = _mm_movemask_epi8(_mm_cmpgt_epi8(m, vthr));
+        while (bits)
+        {
+            cells.push_back(c + __builtin_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+#endif
+    for (; c < grid_len; c++)
+    {
+        int m = (int8_t)(p[c] ^ flip);
+        for (int k = 1; k < planes; k++)
+        {
+            m = std::max(m, (int)(int8_t)(p[(size_t)k * grid_len + c] ^ flip));
+        }
+        if (m > sthr)
+        {
+            cells.push_back(c);
+        }
+    }
+    return (int)cells.size();
+}
+
+/**
+ * 【功能】浮点网格预筛选，按平面顺序读取，逐元素取最大值（循环可被编译器自动向量化）
+ * @param inclusive true时选出max >= thres的网格（score_sum），否则max > thres
+ */
+static int prefilter_cells_f32(const float *base, int planes, int grid_len, float thres, bool inclusive,
+                               std::vector<int> &cells)
+{
+    static thread_local std::vector<float> cell_max;
+    cells.clear();
+    cell_max.assign(base, base + grid_len);
+    for (int k = 1; k < planes; k++)
+    {
+        const float *plane = base + (size_t)k * grid_len;
+        for (int c = 0; c < grid_len; c++)
+        {
+            cell_max[c] = std::max(cell_max[c], plane[c]);
+        }
+    }
+    for (int c = 0; c < grid_len; c++)
+    {
+        if (inclusive ? cell_max[c] >= thres : cell_max[c] > thres)
+        {
+            cells.push_back(c);
+        }
+    }
+    return (int)cells.size();
+}
+
+template <int CLASS_NUM>
+static int process_u8(uint8_t *box_tensor, float box_scale,
                       uint8_t *score_tensor, int32_t score_zp, float score_scale,
                       uint8_t *score_sum_tensor, int32_t score_sum_zp, float score_sum_scale,
-                      int grid_h, int grid_w, int stride, int dfl_len,
+                      int grid_h, int grid_w, int stride, int dfl_len, int class_num,
                       std::vector<float> &boxes,
                       std::vector<float> &objProbs,
                       std::vector<int> &classId,
                       float threshold)
 {
     int validCount = 0;
+    const int num_classes = CLASS_NUM > 0 ? CLASS_NUM : class_num;
     int grid_len = grid_h * grid_w;
     uint8_t score_thres_u8 = qnt_f32_to_affine_u8(threshold, score_zp, score_scale);
     uint8_t score_sum_thres_u8 = qnt_f32_to_affine_u8(threshold, score_sum_zp, score_sum_scale);
+    const float* exp_lut = get_dfl_exp_lut(box_scale);
 
-    for (int i = 0; i < grid_h; i++)
+    // 预筛选：score_sum存在时过滤条件为score_sum >= 阈值，否则为类别最大分数 > 阈值
+    static thread_local std::vector<int> cells;
+    if (score_sum_tensor != nullptr)
     {
-        for (int j = 0; j < grid_w; j++)
-        {
-            int offset = i * grid_w + j;
-            int max_class_id = -1;
+        prefilter_cells_q8<true>(score_sum_tensor, 1, grid_len, score_sum_thres_u8 - 1, cells);
+    }
+    else
+    {
+        prefilter_cells_q8<true>(score_tensor, num_classes, grid_len, score_thres_u8, cells);
+    }
 
-            // Use score sum to quickly filter
-            if (score_sum_tensor != nullptr)
-            {
-                if (score_sum_tensor[offset] < score_sum_thres_u8)
-                {
-                    continue;
-                }
-            }
+    for (size_t n = 0; n < cells.size(); n++)
+    {
+        int i = cells[n] / grid_w;
+        int j = cells[n] % grid_w;
+        int offset = cells[n];
+        int max_class_id = -1;
 
-            uint8_t max_score = -score_zp;
-            for (int c = 0; c < OBJ_CLASS_NUM; c++)
+        uint8_t max_score = 0;  // 只有高于阈值的分数才会被选中
+        for (int c = 0; c < num_classes; c++)
+        {
+            if ((score_tensor[offset] > score_thres_u8) && (score_tensor[offset] > max_score))
             {
-                if ((score_tensor[offset] > score_thres_u8) && (score_tensor[offset] > max_score))
-                {
-                    max_score = score_tensor[offset];
-                    max_class_id = c;
-                }
-                offset += grid_len;
+                max_score = score_tensor[offset];
+                max_class_id = c;
             }
+            offset += grid_len;
+        }
 
-            // compute box
-            if (max_score > score_thres_u8)
-            {
-                offset = i * grid_w + j;
-                float box[4];
-                float before_dfl[dfl_len * 4];
-                for (int k = 0; k < dfl_len * 4; k++)
-                {
-                    before_dfl[k] = deqnt_affine_u8_to_f32(box_tensor[offset], box_zp, box_scale);
-                    offset += grid_len;
-                }
-                compute_dfl(before_dfl, dfl_len, box);
-
-                float x1, y1, x2, y2, w, h;
-                x1 = (-box[0] + j + 0.5) * stride;
-                y1 = (-box[1] + i + 0.5) * stride;
-                x2 = (box[2] + j + 0.5) * stride;
-                y2 = (box[3] + i + 0.5) * stride;
-                w = x2 - x1;
-                h = y2 - y1;
-                boxes.push_back(x1);
-                boxes.push_back(y1);
-                boxes.push_back(w);
-                boxes.push_back(h);
-
-                objProbs.push_back(deqnt_affine_u8_to_f32(max_score, score_zp, score_scale));
-                classId.push_back(max_class_id);
-                validCount++;
-            }
+        // compute box
+        if (max_score > score_thres_u8)
+        {
+            offset = cells[n];
+            float box[4];
+            compute_dfl_quant(box_tensor + offset, grid_len, dfl_len, exp_lut, box);
+
+            float x1, y1, x2, y2, w, h;
+            x1 = (-box[0] + j + 0.5) * stride;
+            y1 = (-box[1] + i + 0.5) * stride;
+            x2 = (box[2] + j + 0.5) * stride;
+            y2 = (box[3] + i + 0.5) * stride;
+            w = x2 - x1;
+            h = y2 - y1;
+            boxes.push_back(x1);
+            boxes.push_back(y1);
+            boxes.push_back(w);
+            boxes.push_back(h);
+
+            objProbs.push_back(deqnt_affine_u8_to_f32(max_score, score_zp, score_scale));
+            classId.push_back(max_class_id);
+            validCount++;
         }
     }
     return validCount;
 }
 
-static int process_i8(int8_t *box_tensor, int32_t box_zp, float box_scale,
+template <int CLASS_NUM>
+static int process_i8(int8_t *box_tensor, float box_scale,
                       int8_t *score_tensor, int32_t score_zp, float score_scale,
                       int8_t *score_sum_tensor, int32_t score_sum_zp, float score_sum_scale,
-                      int grid_h, int grid_w, int stride, int dfl_len,
+                      int grid_h, int grid_w, int stride, int dfl_len, int class_num,
                       std::vector<float> &boxes, 
                       std::vector<float> &objProbs, 
                       std::vector<int> &classId, 
                       float threshold)
 {
     int validCount = 0;
+    const int num_classes = CLASS_NUM > 0 ? CLASS_NUM : class_num;
     int grid_len = grid_h * grid_w;
     int8_t score_thres_i8 = qnt_f32_to_affine(threshold, score_zp, score_scale);
     int8_t score_sum_thres_i8 = qnt_f32_to_affine(threshold, score_sum_zp, score_sum_scale);
+    const float* exp_lut = get_dfl_exp_lut(box_scale);
 
-    for (int i = 0; i < grid_h; i++)
+    // 预筛选：score_sum存在时过滤条件为score_sum >= 阈值，否则为类别最大分数 > 阈值
+    static thread_local std::vector<int> cells;
+    if (score_sum_tensor != nullptr)
     {
-        for (int j = 0; j < grid_w; j++)
-        {
-            int offset = i* grid_w + j;
-            int max_class_id = -1;
-
-            // 通过 score sum 起到快速过滤的作用
-            if (score_sum_tensor != nullptr){
-                if (score_sum_tensor[offset] < score_sum_thres_i8){
-                    continue;
-                }
-            }
+        prefilter_cells_q8<false>(score_sum_tensor, 1, grid_len, score_sum_thres_i8 - 1, cells);
+    }
+    else
+    {
+        prefilter_cells_q8<false>(score_tensor, num_classes, grid_len, score_thres_i8, cells);
+    }
 
-            int8_t max_score = -score_zp;
-            for (int c= 0; c< OBJ_CLASS_NUM; c++){
-                if ((score_tensor[offset] > score_thres_i8) && (score_tensor[offset] > max_score))
-                {
-                    max_score = score_tensor[offset];
-                    max_class_id = c;
-                }
-                offset += grid_len;
+    for (size_t n = 0; n < cells.size(); n++)
+    {
+        int i = cells[n] / grid_w;
+        int j = cells[n] % grid_w;
+        int offset = cells[n];
+        int max_class_id = -1;
+
+        int8_t max_score = -score_zp;
+        for (int c= 0; c< num_classes; c++){
+            if ((score_tensor[offset] > score_thres_i8) && (score_tensor[offset] > max_score))
+            {
+                max_score = score_tensor[offset];
+                max_class_id = c;
             }
+            offset += grid_len;
+        }
 
-            // compute box
-            if (max_score> score_thres_i8){
-                offset = i* grid_w + j;
-                float box[4];
-                float before_dfl[dfl_len*4];
-                for (int k=0; k< dfl_len*4; k++){
-                    before_dfl[k] = deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
-                    offset += grid_len;
-                }
-                compute_dfl(before_dfl, dfl_len, box);
-
-                float x1,y1,x2,y2,w,h;
-                x1 = (-box[0] + j + 0.5)*stride;
-                y1 = (-box[1] + i + 0.5)*stride;
-                x2 = (box[2] + j + 0.5)*stride;
-                y2 = (box[3] + i + 0.5)*stride;
-                w = x2 - x1;
-                h = y2 - y1;
-                boxes.push_back(x1);
-                boxes.push_back(y1);
-                boxes.push_back(w);
-                boxes.push_back(h);
-
-                objProbs.push_back(deqnt_affine_to_f32(max_score, score_zp, score_scale));
-                classId.push_back(max_class_id);
-                validCount ++;
-            }
+        // compute box
+        if (max_score> score_thres_i8){
+            offset = cells[n];
+            float box[4];
+            compute_dfl_quant(box_tensor + offset, grid_len, dfl_len, exp_lut, box);
+
+            float x1,y1,x2,y2,w,h;
+            x1 = (-box[0] + j + 0.5)*stride;
+            y1 = (-box[1] + i + 0.5)*stride;
+            x2 = (box[2] + j + 0.5)*stride;
+            y2 = (box[3] + i + 0.5)*stride;
+            w = x2 - x1;
+            h = y2 - y1;
+            boxes.push_back(x1);
+            boxes.push_back(y1);
+            boxes.push_back(w);
+            boxes.push_back(h);
+
+            objProbs.push_back(deqnt_affine_to_f32(max_score, score_zp, score_scale));
+            classId.push_back(max_class_id);
+            validCount ++;
         }
     }
     return validCount;
 }
 
+template <int CLASS_NUM>
 static int process_fp32(float *box_tensor, float *score_tensor, float *score_sum_tensor, 
-                        int grid_h, int grid_w, int stride, int dfl_len,
+                        int grid_h, int grid_w, int stride, int dfl_len, int class_num,
                         std::vector<float> &boxes, 
                         std::vector<float> &objProbs, 
                         std::vector<int> &classId, 
                         float threshold)
 {
     int validCount = 0;
+    const int num_classes = CLASS_NUM > 0 ? CLASS_NUM : class_num;
     int grid_len = grid_h * grid_w;
-    for (int i = 0; i < grid_h; i++)
+    // 预筛选：score_sum存在时过滤条件为score_sum >= 阈值，否则为类别最大分数 > 阈值
+    static thread_local std::vector<int> cells;
+    if (score_sum_tensor != nullptr)
     {
-        for (int j = 0; j < grid_w; j++)
-        {
-            int offset = i* grid_w + j;
-            int max_class_id = -1;
-
-            // 通过 score sum 起到快速过滤的作用
-            if (score_sum_tensor != nullptr){
-                if (score_sum_tensor[offset] < threshold){
-                    continue;
-                }
-            }
+        prefilter_cells_f32(score_sum_tensor, 1, grid_len, threshold, true, cells);
+    }
+    else
+    {
+        prefilter_cells_f32(score_tensor, num_classes, grid_len, threshold, false, cells);
+    }
 
-            float max_score = 0;
-            for (int c= 0; c< OBJ_CLASS_NUM; c++){
-                if ((score_tensor[offset] > threshold) && (score_tensor[offset] > max_score))
-                {
-                    max_score = score_tensor[offset];
-                    max_class_id = c;
-                }
-                offset += grid_len;
+    for (size_t n = 0; n < cells.size(); n++)
+    {
+        int i = cells[n] / grid_w;
+        int j = cells[n] % grid_w;
+        int offset = cells[n];
+        int max_class_id = -1;
+
+        float max_score = 0;
+        for (int c= 0; c< num_classes; c++){
+            if ((score_tensor[offset] > threshold) && (score_tensor[offset] > max_score))
+            {
+                max_score = score_tensor[offset];
+                max_class_id = c;
             }
+            offset += grid_len;
+        }
 
-            // compute box
-            if (max_score> threshold){
-                offset = i* grid_w + j;
-                float box[4];
-                float before_dfl[dfl_len*4];
-                for (int k=0; k< dfl_len*4; k++){
-                    before_dfl[k] = box_tensor[offset];
-                    offset += grid_len;
-                }
-                compute_dfl(before_dfl, dfl_len, box);
-
-                float x1,y1,x2,y2,w,h;
-                x1 = (-box[0] + j + 0.5)*stride;
-                y1 = (-box[1] + i + 0.5)*stride;
-                x2 = (box[2] + j + 0.5)*stride;
-                y2 = (box[3] + i + 0.5)*stride;
-                w = x2 - x1;
-                h = y2 - y1;
-                boxes.push_back(x1);
-                boxes.push_back(y1);
-                boxes.push_back(w);
-                boxes.push_back(h);
-
-                objProbs.push_back(max_score);
-                classId.push_back(max_class_id);
-                validCount ++;
-            }
+        // compute box
+        if (max_score> threshold){
+            offset = cells[n];
+            float box[4];
+            compute_dfl(box_tensor + offset, grid_len, dfl_len, box);
+
+            float x1,y1,x2,y2,w,h;
+            x1 = (-box[0] + j + 0.5)*stride;
+            y1 = (-box[1] + i + 0.5)*stride;
+            x2 = (box[2] + j + 0.5)*stride;
+            y2 = (box[3] + i + 0.5)*stride;
+            w = x2 - x1;
+            h = y2 - y1;
+            boxes.push_back(x1);
+            boxes.push_back(y1);
+            boxes.push_back(w);
+            boxes.push_back(h);
+
+            objProbs.push_back(max_score);
+            classId.push_back(max_class_id);
+            validCount ++;
         }
     }
     return validCount;
 }
 
+/**
+ * 【功能】按类别数选择编译期特化的解码函数
+ * 【说明】CLASS_NUM为常用类别数（1/3/80）时类别循环次数是编译期常量，可以完全展开；
+ *        单类别模型的预筛选只扫描一个平面，类别比较只剩一次。其他类别数使用CLASS_NUM=0的通用版本。
+ */
+template <typename Fn>
+static Fn select_decoder(int class_num, Fn f1, Fn f3, Fn f80, Fn generic)
+{
+    switch (class_num)
+    {
+    case 1:
+        return f1;
+    case 3:
+        return f3;
+    case 80:
+        return f80;
+    default:
+        return generic;
+    }
+}
+
+// 解码函数指针类型，与process_u8/process_i8/process_fp32的签名一致
+typedef int (*decode_u8_fn)(uint8_t *, float, uint8_t *, int32_t, float, uint8_t *, int32_t, float, int, int, int,
+                            int, int, std::vector<float> &, std::vector<float> &, std::vector<int> &, float);
+typedef int (*decode_i8_fn)(int8_t *, float, int8_t *, int32_t, float, int8_t *, int32_t, float, int, int, int,
+                            int, int, std::vector<float> &, std::vector<float> &, std::vector<int> &, float);
+typedef int (*decode_fp32_fn)(float *, float *, float *, int, int, int, int, int, std::vector<float> &,
+                              std::vector<float> &, std::vector<int> &, float);
+
+// 模型的类别数及对应的解码函数，由init_post_process按模型输出确定，post_process不再逐帧查询
+static int g_class_num = 0;
+static decode_u8_fn g_decode_u8 = NULL;
+static decode_i8_fn g_decode_i8 = NULL;
+static decode_fp32_fn g_decode_fp32 = NULL;
+
 /**
  * YOLOv8后处理主函数 - 将NPU输出转换为最终检测结果
  * @param app_ctx: 应用上下文，包含模型信息和配置
@@ -433,13 +682,21 @@ static int process_fp32(float *box_tensor, float *score_tensor, float *score_sum
 int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter_box, 
                  float conf_threshold, float nms_threshold, object_detect_result_list *od_results)
 {
+    // 【功能】耗时统计 - 析构时记录到postprocess阶段
+    PerfSpan span(PERF_POSTPROCESS);
+
     // 【语法】强制类型转换：将void*转换为rknn_output*，获取NPU输出数据结构
     rknn_output *_outputs = (rknn_output *)outputs;
     
-    // 【功能】初始化存储容器 - 使用STL容器动态管理检测结果
-    std::vector<float> filterBoxes;    // 存储过滤后的边界框坐标 [x,y,w,h]
-    std::vector<float> objProbs;       // 存储对应的置信度分数
-    std::vector<int> classId;          // 存储对应的类别ID
+    // 【功能】初始化存储容器 - 每个线程一份，clear()后容量保留，稳定运行时不再分配堆内存
+    static thread_local std::vector<float> filterBoxes;    // 存储过滤后的边界框坐标 [x,y,w,h]
+    static thread_local std::vector<float> objProbs;       // 存储对应的置信度分数
+    static thread_local std::vector<int> classId;          // 存储对应的类别ID
+    static thread_local std::vector<int> indexArray;       // 按置信度排序后的候选下标
+    static thread_local NmsBoxes candidates;               // 排序后的候选框（SoA）
+    filterBoxes.clear();
+    objProbs.clear();
+    classId.clear();
     
     // 【功能】初始化局部变量
     int validCount = 0;                // 有效检测框计数器
@@ -448,13 +705,26 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
     int model_in_w = app_ctx->model_width;   // 模型输入宽度
     int model_in_h = app_ctx->model_height;  // 模型输入高度
 
-    // 【语法】memset函数：将od_results结构体清零初始化
-    memset(od_results, 0, sizeof(object_detect_result_list));
+    // 【功能】清空上一帧的结果 - 只重置计数，不清零整个缓冲区
+    reset_detect_result_list(od_results);
 
     // 【功能】YOLOv8特征解析 - 计算DFL长度和输出分支数
     // DFL (Distribution Focal Loss) 是YOLOv8的边界框回归方法
     int dfl_len = app_ctx->output_attrs[0].dims[1] / 4;  // 每个坐标分量的分布长度
+    if (dfl_len <= 0 || dfl_len > DFL_MAX_LEN)
+    {
+        LOGE_EVERY_MS(1000, "post_process: unsupported dfl_len %d", dfl_len);
+        return -1;
+    }
     int output_per_branch = app_ctx->io_num.n_output / 3; // 每个尺度分支的输出数量
+
+    // 【功能】类别数和解码函数在init_post_process中按模型确定，循环内不再判断类别数
+    int class_num = g_class_num;
+    if (class_num <= 0)
+    {
+        LOGE_EVERY_MS(1000, "post_process: init_post_process has not been called");
+        return -1;
+    }
     
     // 【功能】多尺度处理 - YOLOv8使用3个不同尺度的特征图进行检测
     for (int i = 0; i < 3; i++)
@@ -484,19 +754,33 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
         stride = model_in_h / grid_h;  // 步长 = 输入尺寸 / 特征图尺寸
 
         // 【功能】根据量化类型选择处理函数
-        if (app_ctx->is_quant)
+        if (app_ctx->is_quant && app_ctx->output_attrs[box_idx].type == RKNN_TENSOR_UINT8)
+        {
+            // 【功能】uint8量化模型处理路径
+            validCount += g_decode_u8(
+                (uint8_t *)_outputs[box_idx].buf,          // 边界框tensor数据（DFL只用到量化差值，与零点无关）
+                app_ctx->output_attrs[box_idx].scale,      // 边界框量化缩放
+                (uint8_t *)_outputs[score_idx].buf,        // 分类tensor数据
+                app_ctx->output_attrs[score_idx].zp,       // 分类量化零点
+                app_ctx->output_attrs[score_idx].scale,    // 分类量化缩放
+                (uint8_t *)score_sum, score_sum_zp, score_sum_scale,  // score_sum相关参数
+                grid_h, grid_w, stride, dfl_len, class_num, // 网格、DFL及类别数参数
+                filterBoxes, objProbs, classId,            // 输出容器（引用传递）
+                conf_threshold                             // 置信度阈值
+            );
+        }
+        else if (app_ctx->is_quant)
         {
             // 【功能】int8量化模型处理路径
             // 【语法】强制类型转换：将void*转换为int8_t*，访问量化数据
-            validCount += process_i8(
-                (int8_t *)_outputs[box_idx].buf,           // 边界框tensor数据
-                app_ctx->output_attrs[box_idx].zp,         // 边界框量化零点
+            validCount += g_decode_i8(
+                (int8_t *)_outputs[box_idx].buf,           // 边界框tensor数据（DFL只用到量化差值，与零点无关）
                 app_ctx->output_attrs[box_idx].scale,      // 边界框量化缩放
                 (int8_t *)_outputs[score_idx].buf,         // 分类tensor数据
                 app_ctx->output_attrs[score_idx].zp,       // 分类量化零点
                 app_ctx->output_attrs[score_idx].scale,    // 分类量化缩放
                 (int8_t *)score_sum, score_sum_zp, score_sum_scale,  // score_sum相关参数
-                grid_h, grid_w, stride, dfl_len,           // 网格和DFL参数
+                grid_h, grid_w, stride, dfl_len, class_num, // 网格、DFL及类别数参数
                 filterBoxes, objProbs, classId,            // 输出容器（引用传递）
                 conf_threshold                             // 置信度阈值
             );
@@ -505,11 +789,11 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
         {
             // 【功能】float32浮点模型处理路径
             // 【语法】强制类型转换：将void*转换为float*，访问浮点数据
-            validCount += process_fp32(
+            validCount += g_decode_fp32(
                 (float *)_outputs[box_idx].buf,            // 边界框tensor数据
                 (float *)_outputs[score_idx].buf,          // 分类tensor数据
                 (float *)score_sum,                        // score_sum数据
-                grid_h, grid_w, stride, dfl_len,           // 网格和DFL参数
+                grid_h, grid_w, stride, dfl_len, class_num, // 网格、DFL及类别数参数
                 filterBoxes, objProbs, classId,            // 输出容器（引用传递）
                 conf_threshold                             // 置信度阈值
             );
@@ -522,55 +806,51 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
         return 0;  // 直接返回，od_results->count已经被初始化为0
     }
     
-    // 【功能】准备NMS处理 - 创建索引数组用于排序和NMS
-    std::vector<int> indexArray;
-    // 【语法】for循环：初始化索引数组 [0, 1, 2, ..., validCount-1]
-    for (int i = 0; i < validCount; ++i)
+    // 【功能】Top-K预选并按置信度排序 - 候选过多时只保留最高的若干个，个数不少于结果上限，
+    //        否则结果上限大于NMS_PRE_TOPK时无法达到；丢弃的候选数记入pre_nms_dropped
+    int resultLimit = detect_result_limit(od_results);
+    int candCount = select_top_k(objProbs, validCount, std::max(NMS_PRE_TOPK, resultLimit), indexArray);
+    od_results->pre_nms_dropped = validCount - candCount;
+
+    // 【功能】按排序结果整理为紧凑的SoA数组，NMS顺序访问连续内存
+    candidates.resize(candCount);
+    for (int i = 0; i < candCount; ++i)
     {
-        indexArray.push_back(i);  // 【语法】vector::push_back添加元素
+        int n = indexArray[i];
+        candidates.x1[i] = filterBoxes[n * 4 + 0];
+        candidates.y1[i] = filterBoxes[n * 4 + 1];
+        candidates.x2[i] = filterBoxes[n * 4 + 0] + filterBoxes[n * 4 + 2];
+        candidates.y2[i] = filterBoxes[n * 4 + 1] + filterBoxes[n * 4 + 3];
+        candidates.score[i] = objProbs[n];
+        candidates.cls[i] = classId[n];
     }
-    
-    // 【功能】置信度排序 - 按置信度从高到低排序
-    // 【语法】函数调用：传递引用参数，原地修改objProbs和indexArray
-    quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
 
-    // 【功能】获取所有检测到的类别 - 用于分类别进行NMS
-    // 【语法】STL set容器：自动去重和排序
-    std::set<int> class_set(std::begin(classId), std::end(classId));
+    // 【功能】NMS处理 - 按类别或不区分类别进行非极大值抑制
+    int keptCount = nms_sorted(candidates, candCount, nms_threshold, g_nms_mode);
 
-    // 【功能】分类别NMS处理 - 对每个类别分别进行非极大值抑制
-    // 【语法】范围for循环（C++11）：遍历set中的每个类别
-    for (auto c : class_set)
-    {
-        // 【功能】对类别c执行NMS，移除重复检测框
-        nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
-    }
-
-    // 【功能】结果输出准备
+    // 【功能】结果输出准备 - 按保留框数扩容，超过上限的部分记入truncated
+    int maxCount = reserve_detect_result_list(od_results, keptCount);
     int last_count = 0;           // 最终输出的检测框计数
-    od_results->count = 0;        // 初始化输出结果计数
+    od_results->truncated = keptCount - maxCount;
 
     // 【功能】构建最终检测结果 - 坐标变换和格式转换
-    for (int i = 0; i < validCount; ++i)
+    for (int i = 0; i < candCount && last_count < maxCount; ++i)
     {
-        // 【功能】跳过被NMS标记为无效的检测框和超出最大数量限制的框
-        // 【语法】逻辑或运算符：任一条件为真则跳过
-        if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE)
+        // 【功能】跳过被NMS标记为无效的检测框
+        if (!candidates.keep[i])
         {
             continue;  // 【语法】continue语句：跳过当前循环迭代
         }
-        
-        int n = indexArray[i];  // 获取有效检测框的原始索引
 
         // 【功能】坐标变换 - 从模型坐标系转换到原图坐标系
         // 步骤1：移除letterbox填充
-        float x1 = filterBoxes[n * 4 + 0] - letter_box->x_pad;  // 左上角x坐标
-        float y1 = filterBoxes[n * 4 + 1] - letter_box->y_pad;  // 左上角y坐标
-        float x2 = x1 + filterBoxes[n * 4 + 2];                 // 右下角x坐标
-        float y2 = y1 + filterBoxes[n * 4 + 3];                 // 右下角y坐标
-        
-        int id = classId[n];           // 获取类别ID
-        float obj_conf = objProbs[i];  // 获取置信度分数
+        float x1 = candidates.x1[i] - letter_box->x_pad;  // 左上角x坐标
+        float y1 = candidates.y1[i] - letter_box->y_pad;  // 左上角y坐标
+        float x2 = candidates.x2[i] - letter_box->x_pad;  // 右下角x坐标
+        float y2 = candidates.y2[i] - letter_box->y_pad;  // 右下角y坐标
+
+        int id = candidates.cls[i];              // 获取类别ID
+        float obj_conf = candidates.score[i];    // 获取置信度分数
 
         // 【功能】最终坐标计算和边界裁剪
         // 步骤2：缩放回原图尺寸并确保坐标在有效范围内
@@ -596,25 +876,115 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
     return 0;  // 【功能】返回成功状态
 }
 
-int init_post_process()
+void set_post_process_nms_mode(nms_mode_t mode)
+{
+    g_nms_mode = mode;
+}
+
+void set_post_process_max_results(int max_results)
 {
-    printf("Using built-in class labels: %s\n", class_labels[0]);
+    g_max_results = max_results > 0 ? max_results : OBJ_NUMB_DEFAULT_MAX;
+}
+
+void init_detect_result_list(object_detect_result_list *list, int max_count)
+{
+    memset(list, 0, sizeof(object_detect_result_list));
+    list->max_count = max_count;
+}
+
+void reset_detect_result_list(object_detect_result_list *list)
+{
+    list->count = 0;
+    list->truncated = 0;
+    list->pre_nms_dropped = 0;
+}
+
+int reserve_detect_result_list(object_detect_result_list *list, int count)
+{
+    int limit = detect_result_limit(list);
+    count = std::min(count, limit);
+    if (count > list->capacity)
+    {
+        // 【说明】按2倍扩容，检测数逐帧小幅增长时不会每帧realloc
+        int capacity = std::min(std::max(count, list->capacity * 2), limit);
+        object_detect_result *results =
+            (object_detect_result *)realloc(list->results, capacity * sizeof(object_detect_result));
+        if (results == NULL)
+        {
+            LOGE("reserve_detect_result_list: alloc %d results fail", capacity);
+            return list->capacity;
+        }
+        list->results = results;
+        list->capacity = capacity;
+    }
+    return count;
+}
+
+void free_detect_result_list(object_detect_result_list *list)
+{
+    free(list->results);
+    list->results = NULL;
+    list->capacity = 0;
+    list->count = 0;
+}
+
+int init_post_process(rknn_app_context_t *app_ctx, const char *label_path)
+{
+    deinit_post_process();
+    // 类别数取自分类tensor的通道维度（NCHW: [1, class_num, grid_h, grid_w]），更换模型无需重新编译
+    int class_num = app_ctx->output_attrs[1].dims[1];
+    if (class_num <= 0)
+    {
+        printf("init_post_process: invalid class num %d\n", class_num);
+        return -1;
+    }
+    if (label_path == NULL)
+    {
+        printf("Using built-in class labels: %s\n", builtin_labels[0]);
+    }
+    else
+    {
+        int n = loadLabelName(label_path, file_labels);
+        file_label_num = n > 0 ? n : 0;
+        if (n <= 0)
+        {
+            printf("load label file %s fail\n", label_path);
+            return -1;
+        }
+        if (n != class_num)
+        {
+            printf("label file %s has %d labels, but the model has %d classes\n", label_path, n, class_num);
+            deinit_post_process();
+            return -1;
+        }
+        printf("Loaded %d class labels from %s\n", n, label_path);
+    }
+
+    // 【语法】函数指针：按类别数选择一次解码函数
+    g_class_num = class_num;
+    g_decode_u8 = select_decoder(class_num, process_u8<1>, process_u8<3>, process_u8<80>, process_u8<0>);
+    g_decode_i8 = select_decoder(class_num, process_i8<1>, process_i8<3>, process_i8<80>, process_i8<0>);
+    g_decode_fp32 = select_decoder(class_num, process_fp32<1>, process_fp32<3>, process_fp32<80>, process_fp32<0>);
     return 0;
 }
 
-// 修改后的类别名称获取函数
 const char *coco_cls_to_name(int cls_id)
 {
-    if (cls_id >= 0 && cls_id < OBJ_CLASS_NUM)
+    if (file_label_num > 0)
     {
-        return class_labels[cls_id];
+        return (cls_id >= 0 && cls_id < file_label_num) ? file_labels[cls_id] : "unknown";
     }
-    return "unknown";
+    int builtin_num = sizeof(builtin_labels) / sizeof(builtin_labels[0]);
+    return (cls_id >= 0 && cls_id < builtin_num) ? builtin_labels[cls_id] : "unknown";
 }
 
-// 简化的清理函数，不再需要释放动态分配的内存
 void deinit_post_process()
 {
-    // 不需要释放内存，因为使用的是静态字符串常量
-    printf("Post-process deinitialized\n");
+    for (int i = 0; i < file_label_num; i++)
+    {
+        free(file_labels[i]);
+        file_labels[i] = NULL;
+    }
+    file_label_num = 0;
+    g_class_num = 0;
 }
@@ -0,0 +1,218 @@
+/**
+ * @file rknn_pool.cc
+ * @brief NPU多核推理上下文池
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "rknn_pool.h"
+
+static int64_t pool_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// RK3588有三个NPU核心，第i个上下文绑定到第i%3个核心
+static const rknn_core_mask core_masks[] = {RKNN_NPU_CORE_0, RKNN_NPU_CORE_1, RKNN_NPU_CORE_2};
+static const int core_mask_num = sizeof(core_masks) / sizeof(core_masks[0]);
+
+// 为副本复制一份输入输出属性，失败时两者都为NULL
+static int copy_attrs(rknn_app_context_t* app_ctx, const rknn_app_context_t* base_ctx)
+{
+    size_t input_bytes = base_ctx->io_num.n_input * sizeof(rknn_tensor_attr);
+    size_t output_bytes = base_ctx->io_num.n_output * sizeof(rknn_tensor_attr);
+    rknn_tensor_attr* input_attrs = (rknn_tensor_attr*)malloc(input_bytes);
+    rknn_tensor_attr* output_attrs = (rknn_tensor_attr*)malloc(output_bytes);
+    if (input_attrs == NULL || output_attrs == NULL)
+    {
+        free(input_attrs);
+        free(output_attrs);
+        app_ctx->input_attrs = NULL;
+        app_ctx->output_attrs = NULL;
+        return -1;
+    }
+    memcpy(input_attrs, base_ctx->input_attrs, input_bytes);
+    memcpy(output_attrs, base_ctx->output_attrs, output_bytes);
+    app_ctx->input_attrs = input_attrs;
+    app_ctx->output_attrs = output_attrs;
+    return 0;
+}
+
+// 释放副本持有的全部资源：缓冲区、复制的上下文和属性
+static void release_slot_ctx(rknn_app_context_t* app_ctx)
+{
+    release_yolov8_io_buffers(app_ctx);
+    if (app_ctx->rknn_ctx != 0)
+    {
+        rknn_destroy(app_ctx->rknn_ctx);
+        app_ctx->rknn_ctx = 0;
+    }
+    free(app_ctx->input_attrs);
+    free(app_ctx->output_attrs);
+    app_ctx->input_attrs = NULL;
+    app_ctx->output_attrs = NULL;
+}
+
+RknnContextPool::RknnContextPool() : policy_(POOL_SCHEDULE_ROUND_ROBIN), next_slot_(0) {}
+
+RknnContextPool::~RknnContextPool()
+{
+    deinit();
+}
+
+int RknnContextPool::init(rknn_app_context_t* base_ctx, int num_contexts, pool_schedule_policy_t policy)
+{
+    int ret;
+    if (base_ctx == NULL || base_ctx->rknn_ctx == 0 || num_contexts <= 0)
+    {
+        return -1;
+    }
+    deinit();
+    policy_ = policy;
+    next_slot_ = 0;
+
+    for (int i = 0; i < num_contexts; i++)
+    {
+        PoolSlot slot;
+        memset(&slot, 0, sizeof(slot));
+        // 每个槽位（包括第一个）都是复制出的上下文，持有自己的属性和输入输出缓冲区：
+        // 动态形状模型按帧切换档位时改写属性，基础上下文及其缓冲区仍归调用者使用
+        slot.app_ctx = *base_ctx;
+        slot.app_ctx.rknn_ctx = 0;
+        slot.app_ctx.input_attrs = NULL;
+        slot.app_ctx.output_attrs = NULL;
+        slot.app_ctx.input_image.virt_addr = NULL;
+        slot.app_ctx.outputs = NULL;
+        slot.app_ctx.input_mem = NULL;
+        slot.app_ctx.output_mems = NULL;
+        slot.app_ctx.model_mem = NULL;  // 模型内存归基础上下文，副本共享权重
+
+        rknn_context dup_ctx = 0;
+        ret = rknn_dup_context(&base_ctx->rknn_ctx, &dup_ctx);
+        if (ret != RKNN_SUCC)
+        {
+            printf("rknn_dup_context fail! ret=%d\n", ret);
+            deinit();
+            return -1;
+        }
+        slot.app_ctx.rknn_ctx = dup_ctx;
+        if (copy_attrs(&slot.app_ctx, base_ctx) != 0 || init_yolov8_io_buffers(&slot.app_ctx) != 0)
+        {
+            release_slot_ctx(&slot.app_ctx);
+            deinit();
+            return -1;
+        }
+
+        rknn_core_mask mask = core_masks[i % core_mask_num];
+        ret = rknn_set_core_mask(slot.app_ctx.rknn_ctx, mask);
+        if (ret != RKNN_SUCC)
+        {
+            // 单核平台不支持绑核，仍然可以使用多个上下文
+            printf("rknn_set_core_mask(%d) fail! ret=%d, context %d runs on default core\n", mask, ret, i);
+        }
+        slots_.push_back(slot);
+    }
+    printf("rknn context pool: %d contexts, policy=%s\n", num_contexts,
+           policy_ == POOL_SCHEDULE_ROUND_ROBIN ? "round-robin" : "least-loaded");
+    return 0;
+}
+
+void RknnContextPool::deinit()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        release_slot_ctx(&slots_[i].app_ctx);
+    }
+    slots_.clear();
+}
+
+int RknnContextPool::pick_slot_locked()
+{
+    int n = slots_.size();
+    if (policy_ == POOL_SCHEDULE_ROUND_ROBIN)
+    {
+        int idx = next_slot_ % n;
+        if (slots_[idx].busy)
+        {
+            return -1;
+        }
+        next_slot_++;
+        return idx;
+    }
+
+    int best = -1;
+    for (int i = 0; i < n; i++)
+    {
+        if (slots_[i].busy)
+        {
+            continue;
+        }
+        if (best < 0 || slots_[i].frames < slots_[best].frames)
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+rknn_app_context_t* RknnContextPool::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (slots_.empty())
+    {
+        return NULL;
+    }
+    int idx;
+    while ((idx = pick_slot_locked()) < 0)
+    {
+        slot_freed_.wait(lock);
+    }
+    slots_[idx].busy = true;
+    slots_[idx].acquire_us = pool_now_us();
+    return &slots_[idx].app_ctx;
+}
+
+void RknnContextPool::release(rknn_app_context_t* app_ctx)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        if (&slots_[i].app_ctx == app_ctx)
+        {
+            slots_[i].busy = false;
+            slots_[i].frames++;
+            slots_[i].busy_us += pool_now_us() - slots_[i].acquire_us;
+            break;
+        }
+    }
+    slot_freed_.notify_all();
+}
+
+int RknnContextPool::inference(image_buffer_t* img, object_detect_result_list* od_results)
+{
+    rknn_app_context_t* app_ctx = acquire();
+    if (app_ctx == NULL)
+    {
+        return -1;
+    }
+    int ret = inference_yolov8_model(app_ctx, img, od_results);
+    release(app_ctx);
+    return ret;
+}
+
+void RknnContextPool::print_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        const PoolSlot& slot = slots_[i];
+        printf("  context %zu (core %d): %lld frames, avg %.2f ms\n", i, (int)(i % core_mask_num),
+               (long long)slot.frames, slot.frames > 0 ? slot.busy_us / 1000.0 / slot.frames : 0.0);
+    }
+}
@@ -0,0 +1,176 @@
+/**
+ * @file rknn_record.cc
+ * @brief 模型输出录制文件的读写
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rknn_record.h"
+
+namespace {
+
+const char RECORD_MAGIC[8] = {'R', 'K', 'N', 'N', 'R', 'E', 'C', '\0'};
+const uint32_t RECORD_VERSION = 1;
+
+struct RecordHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t attr_size;
+    uint32_t n_input;
+    uint32_t n_output;
+    uint32_t want_float;
+    uint32_t frame_count;
+};
+
+bool write_all(FILE* fp, const void* data, size_t size)
+{
+    return size == 0 || fwrite(data, 1, size, fp) == size;
+}
+
+} // namespace
+
+int save_rknn_recording(const char* path, const RknnRecording& rec)
+{
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        printf("save_rknn_recording: open %s fail\n", path);
+        return -1;
+    }
+    RecordHeader header;
+    memcpy(header.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    header.version = RECORD_VERSION;
+    header.attr_size = sizeof(rknn_tensor_attr);
+    header.n_input = rec.input_attrs.size();
+    header.n_output = rec.output_attrs.size();
+    header.want_float = rec.want_float ? 1 : 0;
+    header.frame_count = rec.frames.size();
+
+    bool ok = write_all(fp, &header, sizeof(header)) &&
+              write_all(fp, rec.input_attrs.data(), rec.input_attrs.size() * sizeof(rknn_tensor_attr)) &&
+              write_all(fp, rec.output_attrs.data(), rec.output_attrs.size() * sizeof(rknn_tensor_attr));
+    for (size_t f = 0; ok && f < rec.frames.size(); f++)
+    {
+        if (rec.frames[f].size() != header.n_output)
+        {
+            ok = false;
+            break;
+        }
+        for (size_t i = 0; ok && i < rec.frames[f].size(); i++)
+        {
+            uint32_t size = rec.frames[f][i].size();
+            ok = write_all(fp, &size, sizeof(size)) && write_all(fp, rec.frames[f][i].data(), size);
+        }
+    }
+    if (fclose(fp) != 0 || !ok)
+    {
+        printf("save_rknn_recording: write %s fail\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+namespace {
+
+/**
+ * @brief 按顺序读取录制数据，数据来源是文件或内存
+ */
+class RecordReader {
+public:
+    explicit RecordReader(FILE* fp) : fp_(fp), data_(NULL), size_(0), pos_(0) {}
+    RecordReader(const uint8_t* data, size_t size) : fp_(NULL), data_(data), size_(size), pos_(0) {}
+
+    bool read(void* out, size_t size)
+    {
+        if (size == 0)
+        {
+            return true;
+        }
+        if (fp_ != NULL)
+        {
+            return fread(out, 1, size, fp_) == size;
+        }
+        if (size > size_ - pos_)
+        {
+            return false;
+        }
+        memcpy(out, data_ + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+private:
+    FILE* fp_;
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+int parse_rknn_recording(RecordReader& reader, const char* name, RknnRecording* rec)
+{
+    RecordHeader header;
+    if (!reader.read(&header, sizeof(header)) || memcmp(header.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0 ||
+        header.version != RECORD_VERSION || header.attr_size != sizeof(rknn_tensor_attr) || header.n_input == 0 ||
+        header.n_output == 0)
+    {
+        printf("load_rknn_recording: %s is not a recording of this version\n", name);
+        return -1;
+    }
+
+    rec->io_num.n_input = header.n_input;
+    rec->io_num.n_output = header.n_output;
+    rec->want_float = header.want_float != 0;
+    rec->input_attrs.resize(header.n_input);
+    rec->output_attrs.resize(header.n_output);
+    bool ok = reader.read(rec->input_attrs.data(), header.n_input * sizeof(rknn_tensor_attr)) &&
+              reader.read(rec->output_attrs.data(), header.n_output * sizeof(rknn_tensor_attr));
+    rec->frames.resize(header.frame_count);
+    for (uint32_t f = 0; ok && f < header.frame_count; f++)
+    {
+        rec->frames[f].resize(header.n_output);
+        for (uint32_t i = 0; ok && i < header.n_output; i++)
+        {
+            uint32_t size = 0;
+            ok = reader.read(&size, sizeof(size));
+            if (ok)
+            {
+                rec->frames[f][i].resize(size);
+                ok = reader.read(rec->frames[f][i].data(), size);
+            }
+        }
+    }
+    if (!ok)
+    {
+        printf("load_rknn_recording: %s is truncated\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int load_rknn_recording(const char* path, RknnRecording* rec)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        printf("load_rknn_recording: open %s fail\n", path);
+        return -1;
+    }
+    RecordReader reader(fp);
+    int ret = parse_rknn_recording(reader, path, rec);
+    fclose(fp);
+    return ret;
+}
+
+int load_rknn_recording_from_memory(const void* data, size_t size, RknnRecording* rec)
+{
+    RecordReader reader((const uint8_t*)data, size);
+    return parse_rknn_recording(reader, "buffer", rec);
+}
+
+bool is_rknn_recording(const void* data, size_t size)
+{
+    return data != NULL && size >= sizeof(RECORD_MAGIC) && memcmp(data, RECORD_MAGIC, sizeof(RECORD_MAGIC)) == 0;
+}
@@ -0,0 +1,995 @@
+/**
+ * @file rknn_stub.cc
+ * @brief rknn_api替身：回放板端录制的模型输出，在没有NPU的主机上测试调度和前后处理性能
+ *
+ * 接口与librknnrt相同（rknn_api.h），链接rknn_stub代替rknnrt即可（cmake -DRKNN_STUB=ON）。
+ * 模型：rknn_init收到的数据本身是录制文件（yolov8_bench --record生成）时直接使用，
+ *       否则读取环境变量RKNN_STUB_RECORDING指定的录制文件，传入的.rknn模型只起占位作用，
+ *       但与runtime一样复制一份（RKNN_FLAG_MODEL_BUFFER_ZERO_COPY时不复制），加载方式的内存对比与板端一致。
+ * 动态形状：RKNN_STUB_INPUT_SHAPES="640x640,640x384"（WxH）把模型当作动态形状模型，
+ *       rknn_set_input_shapes后输出网格按比例缩小，数据取录制输出左上角的对应区域，档位不能大于录制的形状。
+ * 多batch：RKNN_STUB_BATCH=N把batch为1的录制当作batch为N的模型，输入输出的第0维为N，
+ *       一次推理输出N个连续的录制帧。
+ * 推理：每个上下文按顺序循环回放录制的帧，不读取输入内容。
+ *       RKNN_FLAG_ASYNC_MASK与runtime一致：rknn_outputs_get返回上一帧的结果，通过rknn_output_extend.frame_id区分。
+ * 耗时：RKNN_STUB_RUN_US指定单核推理耗时（微秒，默认0）。模拟RKNN_STUB_NPU_CORES个核心（默认3），
+ *       一个核心同一时间只执行一次推理，绑定同一核心的上下文排队；绑定多个核心时耗时按核心数均分，
+ *       RKNN_NPU_CORE_AUTO选择最早空闲的核心（rknn_set_batch_core_num设置为n时使用前n个核心）。
+ *       多batch模型的耗时为RKNN_STUB_RUN_US * N；RKNN_STUB_RUN_OVERHEAD_US是每次rknn_run的固定开销
+ *       （提交、同步、调度，默认0），不随batch增加，也不按核心数均分。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rknn_api.h"
+#include "rknn_record.h"
+
+namespace {
+
+const uint32_t STUB_CTX_MAGIC = 0x52424E53;    // "SNBR"
+
+struct StubModel {
+    RknnRecording rec;
+    std::string source;
+    int64_t run_us;
+    int64_t run_overhead_us;
+    uint32_t batch;         // 输入输出第0维，录制帧的batch为1
+    // 模拟runtime把模型数据复制到NPU内存：RKNN_FLAG_MODEL_BUFFER_ZERO_COPY时不复制，
+    // RKNN_FLAG_SHARE_WEIGHT_MEM时引用extend->ctx的副本
+    std::shared_ptr<const std::vector<char> > weights;
+    uint64_t weight_size;   // RKNN_QUERY_MEM_SIZE返回的权重大小（模型数据大小）
+    std::vector<std::pair<uint32_t, uint32_t> > shapes;     // 动态形状档位(w, h)，为空时是静态模型
+};
+
+struct StubContext {
+    uint32_t magic;
+    std::shared_ptr<const StubModel> model;
+    uint32_t flag;
+    rknn_core_mask core_mask;
+    int batch_core_num;                         // rknn_set_batch_core_num，0表示未设置
+    uint64_t frame_id;                          // 已提交的推理次数，最近一次推理的frame_id
+    int64_t finish_us;                          // 最近一次推理的模拟完成时间
+    int64_t prev_finish_us;                     // 上一次推理的模拟完成时间（RKNN_FLAG_ASYNC_MASK取上一帧结果）
+    int64_t last_run_us;                        // 最近一次推理的模拟耗时，RKNN_QUERY_PERF_RUN返回
+    std::vector<std::vector<uint8_t> > input_bufs;  // rknn_inputs_set拷贝的输入，与runtime一样多一次拷贝
+    std::vector<bool> input_ready;
+    std::vector<rknn_tensor_mem*> output_mems;  // rknn_set_io_mem绑定的输出，推理时写入
+    std::vector<bool> output_mem_float;
+    std::vector<rknn_tensor_attr> input_attrs;  // 当前形状下的属性，rknn_set_input_shapes后改变
+    std::vector<rknn_tensor_attr> output_attrs;
+};
+
+/**
+ * @brief 模拟的NPU核心：每个核心记录忙到什么时候
+ */
+struct StubNpu {
+    std::mutex mutex;
+    std::vector<int64_t> busy_until_us;
+};
+
+StubNpu& stub_npu()
+{
+    static StubNpu npu;
+    return npu;
+}
+
+int64_t stub_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void stub_sleep_until(int64_t until_us)
+{
+    int64_t now = stub_now_us();
+    if (until_us > now)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(until_us - now));
+    }
+}
+
+int64_t env_int(const char* name, int64_t default_value)
+{
+    const char* value = getenv(name);
+    return (value != NULL && value[0] != '\0') ? atoll(value) : default_value;
+}
+
+StubContext* get_ctx(rknn_context context)
+{
+    StubContext* ctx = (StubContext*)(uintptr_t)context;
+    return (ctx != NULL && ctx->magic == STUB_CTX_MAGIC) ? ctx : NULL;
+}
+
+StubContext* new_ctx(const std::shared_ptr<const StubModel>& model, uint32_t flag)
+{
+    StubContext* ctx = new StubContext();
+    ctx->magic = STUB_CTX_MAGIC;
+    ctx->model = model;
+    ctx->flag = flag;
+    ctx->core_mask = RKNN_NPU_CORE_AUTO;
+    ctx->batch_core_num = 0;
+    ctx->frame_id = 0;
+    ctx->finish_us = 0;
+    ctx->prev_finish_us = 0;
+    ctx->last_run_us = 0;
+    ctx->input_bufs.resize(model->rec.io_num.n_input);
+    ctx->input_ready.assign(model->rec.io_num.n_input, false);
+    ctx->output_mems.assign(model->rec.io_num.n_output, NULL);
+    ctx->output_mem_float.assign(model->rec.io_num.n_output, false);
+    ctx->input_attrs = model->rec.input_attrs;
+    ctx->output_attrs = model->rec.output_attrs;
+    return ctx;
+}
+
+bool file_is_recording(const char* path)
+{
+    char magic[8];
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    bool ok = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && is_rknn_recording(magic, sizeof(magic));
+    fclose(fp);
+    return ok;
+}
+
+// 录制的第一个输入的宽高，输入为NHWC或NCHW
+void input_size(const rknn_tensor_attr& attr, uint32_t* w, uint32_t* h)
+{
+    bool nchw = attr.fmt == RKNN_TENSOR_NCHW;
+    *h = nchw ? attr.dims[2] : attr.dims[1];
+    *w = nchw ? attr.dims[3] : attr.dims[2];
+}
+
+/**
+ * @brief 解析RKNN_STUB_INPUT_SHAPES，每个档位都不能大于录制的形状，且输出网格能按比例整除
+ */
+bool parse_stub_shapes(const char* spec, const RknnRecording& rec, std::vector<std::pair<uint32_t, uint32_t> >* shapes)
+{
+    shapes->clear();
+    if (spec == NULL || spec[0] == '\0')
+    {
+        return true;
+    }
+    uint32_t rec_w, rec_h;
+    input_size(rec.input_attrs[0], &rec_w, &rec_h);
+    const char* p = spec;
+    while (*p != '\0')
+    {
+        unsigned w = 0, h = 0;
+        int n = 0;
+        if (sscanf(p, "%ux%u%n", &w, &h, &n) != 2 || w == 0 || h == 0 || w > rec_w || h > rec_h)
+        {
+            printf("rknn stub: bad RKNN_STUB_INPUT_SHAPES entry at \"%s\" (recorded %ux%u)\n", p, rec_w, rec_h);
+            return false;
+        }
+        for (size_t i = 0; i < rec.output_attrs.size(); i++)
+        {
+            const rknn_tensor_attr& attr = rec.output_attrs[i];
+            if (attr.n_dims != 4 || (attr.dims[2] * h) % rec_h != 0 || (attr.dims[3] * w) % rec_w != 0)
+            {
+                printf("rknn stub: shape %ux%u does not scale output %d evenly\n", w, h, (int)i);
+                return false;
+            }
+        }
+        shapes->push_back(std::make_pair((uint32_t)w, (uint32_t)h));
+        p += n;
+        if (*p == ',')
+        {
+            p++;
+        }
+    }
+    return true;
+}
+
+// 把batch为1的录制的输入输出属性改为batch个，录制帧本身不变
+bool apply_stub_batch(uint32_t batch, RknnRecording* rec)
+{
+    for (int k = 0; k < 2; k++)
+    {
+        std::vector<rknn_tensor_attr>& attrs = k == 0 ? rec->input_attrs : rec->output_attrs;
+        for (size_t i = 0; i < attrs.size(); i++)
+        {
+            rknn_tensor_attr& attr = attrs[i];
+            if (attr.n_dims < 1 || attr.dims[0] != 1)
+            {
+                printf("rknn stub: RKNN_STUB_BATCH needs a batch-1 recording (%s dims[0]=%u)\n", attr.name,
+                       attr.dims[0]);
+                return false;
+            }
+            attr.dims[0] = batch;
+            attr.n_elems *= batch;
+            attr.size *= batch;
+            attr.size_with_stride *= batch;
+        }
+    }
+    return true;
+}
+
+// shared非NULL时（RKNN_FLAG_SHARE_WEIGHT_MEM）引用它的权重副本
+std::shared_ptr<const StubModel> load_stub_model(void* model, uint32_t size, uint32_t flag, const StubModel* shared)
+{
+    std::shared_ptr<StubModel> stub(new StubModel());
+    int ret;
+    if (size == 0 && model != NULL && file_is_recording((const char*)model))
+    {
+        stub->source = (const char*)model;
+        ret = load_rknn_recording(stub->source.c_str(), &stub->rec);
+    }
+    else if (size > 0 && is_rknn_recording(model, size))
+    {
+        stub->source = "model buffer";
+        ret = load_rknn_recording_from_memory(model, size, &stub->rec);
+    }
+    else
+    {
+        const char* path = getenv("RKNN_STUB_RECORDING");
+        if (path == NULL || path[0] == '\0')
+        {
+            printf("rknn stub: model is not a recording and RKNN_STUB_RECORDING is not set\n");
+            return std::shared_ptr<const StubModel>();
+        }
+        stub->source = path;
+        ret = load_rknn_recording(path, &stub->rec);
+    }
+    if (ret != 0)
+    {
+        return std::shared_ptr<const StubModel>();
+    }
+    if (stub->rec.frames.empty())
+    {
+        printf("rknn stub: %s has no frames\n", stub->source.c_str());
+        return std::shared_ptr<const StubModel>();
+    }
+    stub->run_us = std::max<int64_t>(0, env_int("RKNN_STUB_RUN_US", 0));
+    stub->run_overhead_us = std::max<int64_t>(0, env_int("RKNN_STUB_RUN_OVERHEAD_US", 0));
+    stub->batch = std::max<int64_t>(1, env_int("RKNN_STUB_BATCH", 1));
+    if (stub->batch > 1 && !apply_stub_batch(stub->batch, &stub->rec))
+    {
+        return std::shared_ptr<const StubModel>();
+    }
+    if (!parse_stub_shapes(getenv("RKNN_STUB_INPUT_SHAPES"), stub->rec, &stub->shapes))
+    {
+        return std::shared_ptr<const StubModel>();
+    }
+    stub->weight_size = size;
+    if (shared != NULL)
+    {
+        stub->weights = shared->weights;
+        stub->weight_size = shared->weight_size;
+    }
+    else if (size > 0 && !(flag & RKNN_FLAG_MODEL_BUFFER_ZERO_COPY))
+    {
+        stub->weights.reset(new std::vector<char>((const char*)model, (const char*)model + size));
+    }
+    return stub;
+}
+
+/**
+ * @brief 在模拟的NPU核心上排队一次推理
+ * @return 模拟的完成时间
+ */
+int64_t schedule_run(rknn_core_mask core_mask, int64_t run_us, int64_t overhead_us, int64_t* cost_us)
+{
+    int64_t now = stub_now_us();
+    *cost_us = run_us + overhead_us;
+    if (*cost_us <= 0)
+    {
+        return now;
+    }
+    StubNpu& npu = stub_npu();
+    std::lock_guard<std::mutex> lock(npu.mutex);
+    if (npu.busy_until_us.empty())
+    {
+        npu.busy_until_us.assign(std::max<int64_t>(1, env_int("RKNN_STUB_NPU_CORES", 3)), 0);
+    }
+    int core_num = std::min<int>(npu.busy_until_us.size(), 16);
+
+    // 固定大小的数组，推理路径上不分配内存
+    int cores[16];
+    int n = 0;
+    for (int i = 0; i < core_num; i++)
+    {
+        if (core_mask == RKNN_NPU_CORE_ALL || (core_mask & (1 << i)))
+        {
+            cores[n++] = i;
+        }
+    }
+    if (n == 0)
+    {
+        int earliest = 0;
+        for (int i = 1; i < core_num; i++)
+        {
+            if (npu.busy_until_us[i] < npu.busy_until_us[earliest])
+            {
+                earliest = i;
+            }
+        }
+        cores[n++] = earliest;
+    }
+
+    int64_t start = now;
+    for (int i = 0; i < n; i++)
+    {
+        start = std::max(start, npu.busy_until_us[cores[i]]);
+    }
+    *cost_us = run_us / n + overhead_us;
+    int64_t finish = start + *cost_us;
+    for (int i = 0; i < n; i++)
+    {
+        npu.busy_until_us[cores[i]] = finish;
+    }
+    return finish;
+}
+
+/**
+ * @brief 输出需要的字节数：录制的是量化输出而调用方要float时按元素数*4计算
+ * @return 字节数，不支持的转换返回-1
+ */
+int64_t output_size(const StubContext& ctx, uint32_t index, bool want_float)
+{
+    const StubModel& model = *ctx.model;
+    const rknn_tensor_attr& attr = model.rec.output_attrs[index];
+    // 当前形状的元素数 * 录制数据的元素大小（录制帧的batch为1）
+    int64_t elem_size = model.rec.frames[0][index].size() / std::max<uint32_t>(1, attr.n_elems / model.batch);
+    int64_t n_elems = ctx.output_attrs[index].n_elems;
+    if (want_float == model.rec.want_float)
+    {
+        return n_elems * elem_size;
+    }
+    if (want_float && (attr.type == RKNN_TENSOR_INT8 || attr.type == RKNN_TENSOR_UINT8))
+    {
+        return n_elems * (int64_t)sizeof(float);
+    }
+    return -1;
+}
+
+// 一个batch元素：录制帧data写入dst，当前形状小于录制形状时取每个通道左上角的区域（[1, C, H, W]布局）
+void copy_output_frame(const StubContext& ctx, const std::vector<uint8_t>& data, uint32_t index, bool want_float,
+                       void* dst)
+{
+    const StubModel& model = *ctx.model;
+    const rknn_tensor_attr& attr = model.rec.output_attrs[index];
+    const rknn_tensor_attr& cur = ctx.output_attrs[index];
+    size_t elem_size = data.size() / std::max<uint32_t>(1, attr.n_elems / model.batch);
+    bool crop = cur.n_elems != attr.n_elems;
+    size_t rows = crop ? (size_t)attr.dims[1] * cur.dims[2] : 1;
+    size_t row_elems = crop ? cur.dims[3] : data.size() / elem_size;
+    for (size_t r = 0; r < rows; r++)
+    {
+        size_t src_elem = crop ? ((r / cur.dims[2]) * attr.dims[2] + r % cur.dims[2]) * attr.dims[3] : 0;
+        const uint8_t* src = data.data() + src_elem * elem_size;
+        size_t dst_elem = r * row_elems;
+        if (want_float == model.rec.want_float)
+        {
+            memcpy((uint8_t*)dst + dst_elem * elem_size, src, row_elems * elem_size);
+            continue;
+        }
+        // 量化输出转float，与runtime的want_float一致：(q - zp) * scale
+        float* out = (float*)dst + dst_elem;
+        for (size_t i = 0; i < row_elems; i++)
+        {
+            int q = attr.type == RKNN_TENSOR_INT8 ? (int)(int8_t)src[i] : (int)src[i];
+            out[i] = (q - attr.zp) * attr.scale;
+        }
+    }
+}
+
+// 第b个batch元素取第frame + b个录制帧
+int copy_output(const StubContext& ctx, size_t frame, uint32_t index, bool want_float, void* dst, uint32_t dst_size)
+{
+    const StubModel& model = *ctx.model;
+    int64_t need = output_size(ctx, index, want_float);
+    if (need < 0 || need > dst_size)
+    {
+        return RKNN_ERR_OUTPUT_INVALID;
+    }
+    size_t frame_bytes = need / model.batch;
+    for (uint32_t b = 0; b < model.batch; b++)
+    {
+        const std::vector<uint8_t>& data = model.rec.frames[(frame + b) % model.rec.frames.size()][index];
+        copy_output_frame(ctx, data, index, want_float, (uint8_t*)dst + b * frame_bytes);
+    }
+    return RKNN_SUCC;
+}
+
+int find_tensor(const std::vector<rknn_tensor_attr>& attrs, const rknn_tensor_attr* attr)
+{
+    for (size_t i = 0; i < attrs.size(); i++)
+    {
+        if (strncmp(attrs[i].name, attr->name, RKNN_MAX_NAME_LEN) == 0 && attrs[i].index == attr->index)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int query_attr(const std::vector<rknn_tensor_attr>& attrs, void* info, uint32_t size)
+{
+    if (size < sizeof(rknn_tensor_attr))
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    rknn_tensor_attr* attr = (rknn_tensor_attr*)info;
+    if (attr->index >= attrs.size())
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    *attr = attrs[attr->index];
+    return RKNN_SUCC;
+}
+
+rknn_tensor_mem* wrap_mem(void* virt_addr, uint64_t phys_addr, int32_t fd, int32_t offset, uint32_t size,
+                          uint32_t flags)
+{
+    rknn_tensor_mem* mem = (rknn_tensor_mem*)calloc(1, sizeof(rknn_tensor_mem));
+    if (mem == NULL)
+    {
+        return NULL;
+    }
+    mem->virt_addr = virt_addr;
+    mem->phys_addr = phys_addr;
+    mem->fd = fd;
+    mem->offset = offset;
+    mem->size = size;
+    mem->flags = flags;
+    return mem;
+}
+
+} // namespace
+
+int rknn_init(rknn_context* context, void* model, uint32_t size, uint32_t flag, rknn_init_extend* extend)
+{
+    if (context == NULL || model == NULL)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    // 共享权重时仍加载本模型（输入分辨率可以不同），只是不再复制权重
+    StubContext* shared = NULL;
+    if (flag & RKNN_FLAG_SHARE_WEIGHT_MEM)
+    {
+        shared = extend != NULL ? get_ctx(extend->ctx) : NULL;
+        if (shared == NULL)
+        {
+            return RKNN_ERR_CTX_INVALID;
+        }
+    }
+    std::shared_ptr<const StubModel> stub = load_stub_model(model, size, flag,
+                                                            shared != NULL ? shared->model.get() : NULL);
+    if (!stub)
+    {
+        return RKNN_ERR_MODEL_INVALID;
+    }
+    *context = (rknn_context)(uintptr_t)new_ctx(stub, flag);
+    return RKNN_SUCC;
+}
+
+int rknn_dup_context(rknn_context* context_in, rknn_context* context_out)
+{
+    StubContext* ctx = context_in != NULL ? get_ctx(*context_in) : NULL;
+    if (ctx == NULL || context_out == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    StubContext* dup = new_ctx(ctx->model, ctx->flag);
+    dup->input_attrs = ctx->input_attrs;
+    dup->output_attrs = ctx->output_attrs;
+    *context_out = (rknn_context)(uintptr_t)dup;
+    return RKNN_SUCC;
+}
+
+int rknn_destroy(rknn_context context)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    ctx->magic = 0;
+    delete ctx;
+    return RKNN_SUCC;
+}
+
+int rknn_query(rknn_context context, rknn_query_cmd cmd, void* info, uint32_t size)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (info == NULL)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    const StubModel& model = *ctx->model;
+    switch (cmd)
+    {
+    case RKNN_QUERY_IN_OUT_NUM:
+        if (size < sizeof(rknn_input_output_num))
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        *(rknn_input_output_num*)info = model.rec.io_num;
+        return RKNN_SUCC;
+    // 录制文件只保存了普通属性，native/current属性也返回它
+    case RKNN_QUERY_INPUT_ATTR:
+    case RKNN_QUERY_NATIVE_INPUT_ATTR:
+    case RKNN_QUERY_NATIVE_NHWC_INPUT_ATTR:
+        return query_attr(model.rec.input_attrs, info, size);
+    case RKNN_QUERY_OUTPUT_ATTR:
+    case RKNN_QUERY_NATIVE_OUTPUT_ATTR:
+    case RKNN_QUERY_NATIVE_NHWC_OUTPUT_ATTR:
+        return query_attr(model.rec.output_attrs, info, size);
+    // 动态形状模型rknn_set_input_shapes之后的属性
+    case RKNN_QUERY_CURRENT_INPUT_ATTR:
+    case RKNN_QUERY_CURRENT_NATIVE_INPUT_ATTR:
+        return query_attr(ctx->input_attrs, info, size);
+    case RKNN_QUERY_CURRENT_OUTPUT_ATTR:
+    case RKNN_QUERY_CURRENT_NATIVE_OUTPUT_ATTR:
+        return query_attr(ctx->output_attrs, info, size);
+    case RKNN_QUERY_INPUT_DYNAMIC_RANGE:
+    {
+        if (size < sizeof(rknn_input_range))
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        rknn_input_range* range = (rknn_input_range*)info;
+        uint32_t index = range->index;
+        if (index >= model.rec.input_attrs.size())
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        const rknn_tensor_attr& attr = model.rec.input_attrs[index];
+        memset(range, 0, sizeof(rknn_input_range));
+        range->index = index;
+        range->fmt = attr.fmt;
+        range->n_dims = attr.n_dims;
+        memcpy(range->name, attr.name, sizeof(range->name));
+        range->shape_number = index == 0 ? model.shapes.size() : 0;
+        for (uint32_t i = 0; i < range->shape_number; i++)
+        {
+            memcpy(range->dyn_range[i], attr.dims, sizeof(attr.dims));
+            bool nchw = attr.fmt == RKNN_TENSOR_NCHW;
+            range->dyn_range[i][nchw ? 2 : 1] = model.shapes[i].second;
+            range->dyn_range[i][nchw ? 3 : 2] = model.shapes[i].first;
+        }
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_SDK_VERSION:
+    {
+        if (size < sizeof(rknn_sdk_version))
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        rknn_sdk_version* version = (rknn_sdk_version*)info;
+        snprintf(version->api_version, sizeof(version->api_version), "rknn stub (replay)");
+        snprintf(version->drv_version, sizeof(version->drv_version), "%s, %d frames, run %lld us",
+                 model.source.c_str(), (int)model.rec.frames.size(), (long long)model.run_us);
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_PERF_RUN:
+        if (size < sizeof(rknn_perf_run))
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        ((rknn_perf_run*)info)->run_duration = ctx->last_run_us;
+        return RKNN_SUCC;
+    case RKNN_QUERY_MEM_SIZE:
+        if (size < sizeof(rknn_mem_size))
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+    {
+        // 权重为模型数据大小，中间结果以输出tensor大小之和代替；共享权重和零拷贝模型不占用本上下文的DMA内存
+        rknn_mem_size* mem_size = (rknn_mem_size*)info;
+        memset(mem_size, 0, sizeof(rknn_mem_size));
+        mem_size->total_weight_size = (uint32_t)model.weight_size;
+        for (size_t i = 0; i < model.rec.output_attrs.size(); i++)
+        {
+            mem_size->total_internal_size += model.rec.output_attrs[i].size;
+        }
+        mem_size->total_dma_allocated_size = mem_size->total_internal_size;
+        if (!(ctx->flag & (RKNN_FLAG_SHARE_WEIGHT_MEM | RKNN_FLAG_MODEL_BUFFER_ZERO_COPY)))
+        {
+            mem_size->total_dma_allocated_size += model.weight_size;
+        }
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_CUSTOM_STRING:
+        if (size < sizeof(rknn_custom_string))
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        memset(info, 0, sizeof(rknn_custom_string));
+        return RKNN_SUCC;
+    default:
+        return RKNN_ERR_PARAM_INVALID;
+    }
+}
+
+int rknn_inputs_set(rknn_context context, uint32_t n_inputs, rknn_input inputs[])
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    for (uint32_t i = 0; i < n_inputs; i++)
+    {
+        uint32_t index = inputs[i].index;
+        if (index >= ctx->input_bufs.size() || inputs[i].buf == NULL || inputs[i].size == 0)
+        {
+            return RKNN_ERR_INPUT_INVALID;
+        }
+        ctx->input_bufs[index].resize(inputs[i].size);
+        memcpy(ctx->input_bufs[index].data(), inputs[i].buf, inputs[i].size);
+        ctx->input_ready[index] = true;
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_set_batch_core_num(rknn_context context, int core_num)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (core_num <= 0)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    ctx->batch_core_num = core_num;
+    return RKNN_SUCC;
+}
+
+int rknn_set_core_mask(rknn_context context, rknn_core_mask core_mask)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    ctx->core_mask = core_mask;
+    return RKNN_SUCC;
+}
+
+int rknn_run(rknn_context context, rknn_run_extend* extend)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    for (size_t i = 0; i < ctx->input_ready.size(); i++)
+    {
+        if (!ctx->input_ready[i])
+        {
+            return RKNN_ERR_INPUT_INVALID;
+        }
+    }
+    const StubModel& model = *ctx->model;
+    size_t frame = (ctx->frame_id * model.batch) % model.rec.frames.size();
+    for (size_t i = 0; i < ctx->output_mems.size(); i++)
+    {
+        if (ctx->output_mems[i] != NULL)
+        {
+            int ret = copy_output(*ctx, frame, i, ctx->output_mem_float[i], ctx->output_mems[i]->virt_addr,
+                                  ctx->output_mems[i]->size);
+            if (ret != RKNN_SUCC)
+            {
+                return ret;
+            }
+        }
+    }
+    ctx->frame_id++;
+    ctx->prev_finish_us = ctx->finish_us;
+    // 多batch模型按batch_core_num把batch分到前n个核心上
+    rknn_core_mask core_mask = ctx->core_mask;
+    if (core_mask == RKNN_NPU_CORE_AUTO && ctx->batch_core_num > 1)
+    {
+        core_mask = (rknn_core_mask)((1 << std::min(ctx->batch_core_num, 16)) - 1);
+    }
+    ctx->finish_us = schedule_run(core_mask, model.run_us * model.batch, model.run_overhead_us, &ctx->last_run_us);
+    if (extend != NULL)
+    {
+        extend->frame_id = ctx->frame_id;
+    }
+    // 非阻塞模式立即返回，由rknn_wait/rknn_outputs_get等待完成
+    bool non_block = (ctx->flag & RKNN_FLAG_ASYNC_MASK) || (extend != NULL && extend->non_block);
+    if (!non_block)
+    {
+        stub_sleep_until(ctx->finish_us);
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_wait(rknn_context context, rknn_run_extend* extend)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (extend != NULL && extend->timeout_ms > 0 &&
+        ctx->finish_us - stub_now_us() > (int64_t)extend->timeout_ms * 1000)
+    {
+        stub_sleep_until(stub_now_us() + (int64_t)extend->timeout_ms * 1000);
+        return RKNN_ERR_TIMEOUT;
+    }
+    stub_sleep_until(ctx->finish_us);
+    if (extend != NULL)
+    {
+        extend->frame_id = ctx->frame_id;
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_get(rknn_context context, uint32_t n_outputs, rknn_output outputs[], rknn_output_extend* extend)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (ctx->frame_id == 0)
+    {
+        return RKNN_ERR_OUTPUT_INVALID;
+    }
+    const StubModel& model = *ctx->model;
+    // RKNN_FLAG_ASYNC_MASK：除第一帧外返回上一帧的结果，不等待当前帧
+    uint64_t frame_id = ctx->frame_id;
+    if ((ctx->flag & RKNN_FLAG_ASYNC_MASK) && frame_id > 1)
+    {
+        frame_id--;
+        stub_sleep_until(ctx->prev_finish_us);
+    }
+    else
+    {
+        stub_sleep_until(ctx->finish_us);
+    }
+    size_t frame = ((frame_id - 1) * model.batch) % model.rec.frames.size();
+    for (uint32_t i = 0; i < n_outputs; i++)
+    {
+        uint32_t index = outputs[i].index;
+        if (index >= model.rec.io_num.n_output)
+        {
+            return RKNN_ERR_OUTPUT_INVALID;
+        }
+        int64_t need = output_size(*ctx, index, outputs[i].want_float);
+        if (need < 0)
+        {
+            return RKNN_ERR_OUTPUT_INVALID;
+        }
+        if (!outputs[i].is_prealloc)
+        {
+            outputs[i].buf = malloc(need);
+            if (outputs[i].buf == NULL)
+            {
+                return RKNN_ERR_MALLOC_FAIL;
+            }
+            outputs[i].size = need;
+        }
+        int ret = copy_output(*ctx, frame, index, outputs[i].want_float, outputs[i].buf, outputs[i].size);
+        if (ret != RKNN_SUCC)
+        {
+            return ret;
+        }
+    }
+    if (extend != NULL)
+    {
+        extend->frame_id = frame_id;
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_release(rknn_context context, uint32_t n_ouputs, rknn_output outputs[])
+{
+    if (get_ctx(context) == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    for (uint32_t i = 0; i < n_ouputs; i++)
+    {
+        if (!outputs[i].is_prealloc && outputs[i].buf != NULL)
+        {
+            free(outputs[i].buf);
+            outputs[i].buf = NULL;
+        }
+    }
+    return RKNN_SUCC;
+}
+
+rknn_tensor_mem* rknn_create_mem_from_phys(rknn_context ctx, uint64_t phys_addr, void* virt_addr, uint32_t size)
+{
+    (void)ctx;
+    return wrap_mem(virt_addr, phys_addr, -1, 0, size, RKNN_TENSOR_MEMORY_FLAGS_FROM_PHYS);
+}
+
+rknn_tensor_mem* rknn_create_mem_from_fd(rknn_context ctx, int32_t fd, void* virt_addr, uint32_t size, int32_t offset)
+{
+    (void)ctx;
+    return wrap_mem((uint8_t*)virt_addr + offset, 0, fd, offset, size, RKNN_TENSOR_MEMORY_FLAGS_FROM_FD);
+}
+
+rknn_tensor_mem* rknn_create_mem_from_mb_blk(rknn_context ctx, void* mb_blk, int32_t offset)
+{
+    (void)ctx;
+    (void)mb_blk;
+    (void)offset;
+    printf("rknn stub: rknn_create_mem_from_mb_blk not supported\n");
+    return NULL;
+}
+
+rknn_tensor_mem* rknn_create_mem(rknn_context ctx, uint32_t size)
+{
+    return rknn_create_mem2(ctx, size, RKNN_FLAG_MEMORY_CACHEABLE);
+}
+
+rknn_tensor_mem* rknn_create_mem2(rknn_context ctx, uint64_t size, uint64_t alloc_flags)
+{
+    bool no_context = (alloc_flags & RKNN_MEM_FLAG_ALLOC_NO_CONTEXT) != 0;
+    if ((!no_context && get_ctx(ctx) == NULL) || size == 0 || size > UINT32_MAX)
+    {
+        return NULL;
+    }
+    void* buf = calloc(1, size);
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+    rknn_tensor_mem* mem = wrap_mem(buf, 0, -1, 0, size, RKNN_TENSOR_MEMORY_FLAGS_ALLOC_INSIDE);
+    if (mem == NULL)
+    {
+        free(buf);
+    }
+    return mem;
+}
+
+int rknn_destroy_mem(rknn_context ctx, rknn_tensor_mem* mem)
+{
+    (void)ctx;
+    if (mem == NULL)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    if (mem->flags == RKNN_TENSOR_MEMORY_FLAGS_ALLOC_INSIDE)
+    {
+        free(mem->virt_addr);
+    }
+    free(mem);
+    return RKNN_SUCC;
+}
+
+int rknn_set_weight_mem(rknn_context ctx, rknn_tensor_mem* mem)
+{
+    return (get_ctx(ctx) != NULL && mem != NULL) ? RKNN_SUCC : RKNN_ERR_PARAM_INVALID;
+}
+
+int rknn_set_internal_mem(rknn_context ctx, rknn_tensor_mem* mem)
+{
+    return (get_ctx(ctx) != NULL && mem != NULL) ? RKNN_SUCC : RKNN_ERR_PARAM_INVALID;
+}
+
+int rknn_set_io_mem(rknn_context context, rknn_tensor_mem* mem, rknn_tensor_attr* attr)
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    if (mem == NULL || attr == NULL)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    const StubModel& model = *ctx->model;
+    // 与runtime一样按tensor名称区分输入和输出
+    int index = find_tensor(model.rec.input_attrs, attr);
+    if (index >= 0)
+    {
+        if (mem->size < attr->size)
+        {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        ctx->input_ready[index] = true;
+        return RKNN_SUCC;
+    }
+    index = find_tensor(model.rec.output_attrs, attr);
+    if (index < 0)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    bool want_float = attr->type == RKNN_TENSOR_FLOAT32;
+    int64_t need = output_size(*ctx, index, want_float);
+    if (need < 0 || need > mem->size)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    ctx->output_mems[index] = mem;
+    ctx->output_mem_float[index] = want_float;
+    return RKNN_SUCC;
+}
+
+int rknn_set_input_shape(rknn_context ctx, rknn_tensor_attr* attr)
+{
+    return rknn_set_input_shapes(ctx, 1, attr);
+}
+
+int rknn_set_input_shapes(rknn_context context, uint32_t n_inputs, rknn_tensor_attr attr[])
+{
+    StubContext* ctx = get_ctx(context);
+    if (ctx == NULL)
+    {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    const StubModel& model = *ctx->model;
+    const std::vector<rknn_tensor_attr>& inputs = model.rec.input_attrs;
+    if (model.shapes.empty())
+    {
+        // 静态模型：只接受与录制时相同的形状
+        for (uint32_t i = 0; i < n_inputs; i++)
+        {
+            if (attr[i].index >= inputs.size() || attr[i].n_dims != inputs[attr[i].index].n_dims ||
+                memcmp(attr[i].dims, inputs[attr[i].index].dims, attr[i].n_dims * sizeof(uint32_t)) != 0)
+            {
+                return RKNN_ERR_PARAM_INVALID;
+            }
+        }
+        return RKNN_SUCC;
+    }
+
+    // 动态形状：第一个输入的宽高必须是登记的档位之一，其它维度与录制时相同
+    if (n_inputs < 1 || attr[0].index != 0 || attr[0].n_dims != inputs[0].n_dims)
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    uint32_t rec_w, rec_h, w, h;
+    input_size(inputs[0], &rec_w, &rec_h);
+    rknn_tensor_attr in = inputs[0];
+    memcpy(in.dims, attr[0].dims, sizeof(in.dims));
+    input_size(in, &w, &h);
+    if (std::find(model.shapes.begin(), model.shapes.end(), std::make_pair(w, h)) == model.shapes.end())
+    {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    in.n_elems = 1;
+    for (uint32_t d = 0; d < in.n_dims; d++)
+    {
+        in.n_elems *= in.dims[d];
+    }
+    in.size = (uint64_t)inputs[0].size * in.n_elems / inputs[0].n_elems;
+    in.size_with_stride = in.size;
+    in.w_stride = w;
+    ctx->input_attrs[0] = in;
+    for (size_t i = 0; i < model.rec.output_attrs.size(); i++)
+    {
+        const rknn_tensor_attr& rec = model.rec.output_attrs[i];
+        rknn_tensor_attr& out = ctx->output_attrs[i];
+        out = rec;
+        out.dims[2] = rec.dims[2] * h / rec_h;
+        out.dims[3] = rec.dims[3] * w / rec_w;
+        out.n_elems = out.dims[0] * out.dims[1] * out.dims[2] * out.dims[3];
+        out.size = (uint64_t)rec.size * out.n_elems / rec.n_elems;
+        out.size_with_stride = out.size;
+        out.w_stride = out.dims[3];
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_mem_sync(rknn_context context, rknn_tensor_mem* mem, rknn_mem_sync_mode mode)
+{
+    (void)mode;
+    return (get_ctx(context) != NULL && mem != NULL) ? RKNN_SUCC : RKNN_ERR_PARAM_INVALID;
+}
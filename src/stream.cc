@@ -0,0 +1,314 @@
+/**
+ * @file stream.cc
+ * @brief 流式输入：读取线程按数据源节拍采集帧，推理线程按策略从队列取帧
+ *
+ * 推理速度低于数据源帧率时，如果所有帧都排队等待，端到端延迟会无限增长。
+ * latest/queue策略在队列满时丢弃最旧的帧，保证推理线程取到的帧总是足够新；
+ * block策略不丢帧，读取线程被推理速度限制，适合离线处理文件。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "stream.h"
+#include "bounded_queue.h"
+#include "frame_source.h"
+#include "image_io.h"
+#include "image_utils.h"
+#include "perf_stats.h"
+#include "log_utils.h"
+
+namespace {
+
+struct StreamFrame {
+    int64_t index;
+    int64_t capture_us;     // 读取完成的时间，用于计算端到端延迟
+    image_buffer_t image;
+};
+
+typedef BoundedQueue<StreamFrame*> StreamQueue;
+
+int64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* policy_name(stream_policy_t policy)
+{
+    switch (policy)
+    {
+    case STREAM_POLICY_LATEST:
+        return "latest";
+    case STREAM_POLICY_QUEUE:
+        return "queue";
+    default:
+        return "block";
+    }
+}
+
+void free_stream_frame(StreamFrame* frame)
+{
+    free_image_buffer(&frame->image);
+    delete frame;
+}
+
+class StreamRunner
+{
+public:
+    StreamRunner(rknn_app_context_t* app_ctx, FrameSource* source, const std::string& output_dir,
+                 const stream_config_t& config)
+        : app_ctx_(app_ctx), source_(source), output_dir_(output_dir), config_(config),
+          queue_(config.policy == STREAM_POLICY_LATEST ? 1 : config.queue_depth), frames_read_(0),
+          frames_dropped_(0), frames_processed_(0), latency_sum_us_(0), latency_max_us_(0)
+    {
+        init_detect_result_list(&od_results_, 0);
+    }
+
+    ~StreamRunner()
+    {
+        free_detect_result_list(&od_results_);
+    }
+
+    int run()
+    {
+        double fps = config_.fps;
+        if (fps < 0)
+        {
+            fps = source_->fps() > 0 ? source_->fps() : 30.0;
+        }
+        // 实时数据源的read()本身按采集节拍阻塞，不需要额外限速
+        period_us_ = (fps > 0 && !source_->is_live()) ? (int64_t)(1000000.0 / fps) : 0;
+        printf("stream: policy=%s depth=%d replay %.1f fps%s\n", policy_name(config_.policy),
+               config_.policy == STREAM_POLICY_LATEST ? 1 : config_.queue_depth, period_us_ > 0 ? fps : 0.0,
+               period_us_ > 0 ? "" : " (unthrottled)");
+
+        int64_t start_us = now_us();
+        std::thread reader(&StreamRunner::reader_loop, this);
+        infer_loop();
+        reader.join();
+        int64_t wall_us = now_us() - start_us;
+
+        print_summary(wall_us);
+        return frames_processed_;
+    }
+
+private:
+    void reader_loop()
+    {
+        int64_t next_due_us = now_us();
+        for (int64_t index = 0; config_.max_frames <= 0 || index < config_.max_frames; index++)
+        {
+            if (period_us_ > 0)
+            {
+                int64_t wait_us = next_due_us - now_us();
+                if (wait_us > 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+                }
+                next_due_us += period_us_;
+            }
+
+            StreamFrame* frame = new StreamFrame();
+            memset(&frame->image, 0, sizeof(image_buffer_t));
+            int64_t read_start_ns = perf_now_ns();
+            int ret = source_->read(&frame->image);
+            perf_record(PERF_READ, perf_now_ns() - read_start_ns);
+            if (ret != 0)
+            {
+                if (ret < 0)
+                {
+                    LOGE_EVERY_MS(1000, "stream: read frame %lld fail", (long long)index);
+                }
+                delete frame;
+                break;
+            }
+            frame->index = index;
+            frame->capture_us = now_us();
+            frames_read_++;
+
+            if (config_.policy == STREAM_POLICY_BLOCK)
+            {
+                if (!queue_.push(frame))
+                {
+                    free_stream_frame(frame);
+                    break;
+                }
+                continue;
+            }
+
+            StreamFrame* evicted = NULL;
+            bool did_evict = false;
+            if (!queue_.push_drop_oldest(frame, evicted, did_evict))
+            {
+                free_stream_frame(frame);
+                break;
+            }
+            if (did_evict)
+            {
+                free_stream_frame(evicted);
+                frames_dropped_++;
+            }
+        }
+        queue_.close();
+    }
+
+    void infer_loop()
+    {
+        StreamFrame* frame = NULL;
+        while (queue_.pop(frame))
+        {
+            process(frame);
+            free_stream_frame(frame);
+        }
+    }
+
+    void process(StreamFrame* frame)
+    {
+        // NV12/NV21帧直接送入letterbox，在缩放的同时转换为RGB，不生成全尺寸RGB帧
+        object_detect_result_list& od_results = od_results_;
+        int ret = inference_yolov8_model(app_ctx_, &frame->image, &od_results);
+        if (ret != 0)
+        {
+            LOGE_EVERY_MS(1000, "stream: inference frame %lld fail! ret=%d", (long long)frame->index, ret);
+            return;
+        }
+        int64_t latency_us = now_us() - frame->capture_us;
+        latency_sum_us_ += latency_us;
+        latency_max_us_ = std::max(latency_max_us_, latency_us);
+        frames_processed_++;
+        LOGD("frame %lld: %d objects%s, latency %.2f ms", (long long)frame->index, od_results.count,
+               od_results.truncated > 0 || od_results.pre_nms_dropped > 0 ? " (truncated)" : "",
+               latency_us / 1000.0);
+
+        if (config_.save_output)
+        {
+            save_result(frame, &od_results);
+        }
+    }
+
+    void save_result(StreamFrame* frame, object_detect_result_list* od_results)
+    {
+        image_buffer_t rgb_image;
+        image_buffer_t* image = &frame->image;
+        memset(&rgb_image, 0, sizeof(image_buffer_t));
+        // 只有保存结果时才需要全尺寸RGB图像
+        if (image->format == IMAGE_FORMAT_YUV420SP_NV12 || image->format == IMAGE_FORMAT_YUV420SP_NV21)
+        {
+            if (convert_yuv420sp_to_rgb(image, &rgb_image) != 0)
+            {
+                LOGE_EVERY_MS(1000, "stream: convert frame %lld to rgb fail", (long long)frame->index);
+                return;
+            }
+            image = &rgb_image;
+        }
+        char path[512];
+        snprintf(path, sizeof(path), "%s/frame_%05lld_out.jpg", output_dir_.c_str(), (long long)frame->index);
+        draw_detect_results(image, od_results);
+        write_image(path, image);
+        free_image_buffer(&rgb_image);
+    }
+
+    void print_summary(int64_t wall_us)
+    {
+        int64_t read = frames_read_;
+        int processed = frames_processed_;
+        printf("\n=== 流式处理统计 ===\n");
+        printf("读取: %lld 帧, 丢弃: %lld 帧, 处理: %d 帧, 总耗时: %.2f ms, 吞吐: %.2f FPS\n", (long long)read,
+               (long long)frames_dropped_.load(), processed, wall_us / 1000.0,
+               wall_us > 0 ? processed * 1000000.0 / wall_us : 0.0);
+        printf("端到端延迟: 平均 %.2f ms, 最大 %.2f ms\n",
+               processed > 0 ? latency_sum_us_ / 1000.0 / processed : 0.0, latency_max_us_ / 1000.0);
+    }
+
+    rknn_app_context_t* app_ctx_;
+    FrameSource* source_;
+    std::string output_dir_;
+    stream_config_t config_;
+    int64_t period_us_;
+
+    StreamQueue queue_;
+    std::atomic<int64_t> frames_read_;
+    std::atomic<int64_t> frames_dropped_;
+    // 以下统计只由推理线程访问
+    int frames_processed_;
+    int64_t latency_sum_us_;
+    int64_t latency_max_us_;
+    object_detect_result_list od_results_;  // 逐帧复用的结果列表
+};
+
+} // namespace
+
+void init_stream_config(stream_config_t* config)
+{
+    config->policy = STREAM_POLICY_LATEST;
+    config->queue_depth = 4;
+    config->raw_width = 0;
+    config->raw_height = 0;
+    config->fps = -1;
+    config->max_frames = 0;
+    config->save_output = false;
+}
+
+int parse_stream_policy(const char* spec, stream_config_t* config)
+{
+    std::string s = spec;
+    std::string name = s.substr(0, s.find(':'));
+    if (name == "latest")
+    {
+        config->policy = STREAM_POLICY_LATEST;
+    }
+    else if (name == "queue")
+    {
+        config->policy = STREAM_POLICY_QUEUE;
+    }
+    else if (name == "block")
+    {
+        config->policy = STREAM_POLICY_BLOCK;
+    }
+    else
+    {
+        return -1;
+    }
+
+    size_t colon = s.find(':');
+    if (colon != std::string::npos)
+    {
+        if (config->policy == STREAM_POLICY_LATEST)
+        {
+            return -1;
+        }
+        int depth = atoi(s.c_str() + colon + 1);
+        if (depth <= 0)
+        {
+            return -1;
+        }
+        config->queue_depth = depth;
+    }
+    return 0;
+}
+
+int run_stream(rknn_app_context_t* app_ctx, const char* uri, const char* output_dir, const stream_config_t* config)
+{
+    if (app_ctx == NULL || uri == NULL || config == NULL)
+    {
+        return -1;
+    }
+    FrameSource* source = create_frame_source(uri, config->raw_width, config->raw_height);
+    if (source == NULL)
+    {
+        return -1;
+    }
+
+    StreamRunner runner(app_ctx, source, output_dir != NULL ? output_dir : ".", *config);
+    int processed = runner.run();
+    delete source;
+    return processed;
+}
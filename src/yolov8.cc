@@ -2,12 +2,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <sys/time.h>  // 添加时间头文件
+#include <stdint.h>
+#include <sys/resource.h>
+
+#include <algorithm>
 
 #include "yolov8.h"
 #include "common.h"
 #include "file_utils.h"
 #include "image_utils.h"
+#include "perf_stats.h"
+#include "log_utils.h"
 
 static void dump_tensor_attr(rknn_tensor_attr *attr)
 {
@@ -29,35 +34,268 @@ int get_rknn_version(rknn_context &ctx, rknn_sdk_version &version)
   return 0;
 }
 
-int init_yolov8_model(const char *model_path, rknn_app_context_t *app_ctx)
+static const char *model_load_name(yolov8_model_load_t mode, int map_flags)
 {
-    int ret;
-    int model_len = 0;
-    char *model;
-    rknn_context ctx = 0;
+    switch (mode)
+    {
+    case YOLOV8_MODEL_LOAD_READ:
+        return "read";
+    case YOLOV8_MODEL_LOAD_ZERO_COPY:
+        return "zero-copy";
+    default:
+        return map_flags != 0 ? "populate" : "mmap";
+    }
+}
 
-    // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
-    if (model == NULL)
+// 文件直接读入NPU内存，runtime引用该内存而不是复制一份权重；成功时*model_mem需在rknn_destroy之后释放。
+// *init_ns为读完文件、调用rknn_init的时刻；flag/extend中已填好共享权重等其它选项
+static int init_rknn_zero_copy(const char *model_path, uint32_t flag, rknn_init_extend extend, rknn_context *ctx,
+                               rknn_tensor_mem **model_mem, int64_t *init_ns)
+{
+    long long size = get_file_size(model_path);
+    if (size <= 0 || size > UINT32_MAX)
     {
-        printf("load_model fail!\n");
+        printf("zero-copy load: bad model size %lld\n", size);
         return -1;
     }
+    rknn_tensor_mem *mem = rknn_create_mem2(0, size, RKNN_MEM_FLAG_ALLOC_NO_CONTEXT);
+    if (mem == NULL)
+    {
+        printf("zero-copy load: rknn_create_mem2 fail!\n");
+        return -1;
+    }
+    if (read_file_to_buffer(model_path, mem->virt_addr, size) != 0)
+    {
+        rknn_destroy_mem(0, mem);
+        return -1;
+    }
+    *init_ns = perf_now_ns();
+    extend.model_buffer_fd = mem->fd;
+    extend.model_buffer_flags = mem->flags;
+    int ret = rknn_init(ctx, mem->virt_addr, size, flag | RKNN_FLAG_MODEL_BUFFER_ZERO_COPY, &extend);
+    if (ret < 0)
+    {
+        printf("zero-copy load: rknn_init fail! ret=%d\n", ret);
+        rknn_destroy_mem(0, mem);
+        return -1;
+    }
+    *model_mem = mem;
+    return 0;
+}
+
+// 按opts指定的方式加载模型并初始化上下文，打印加载耗时和峰值RSS（冷启动看门狗重启关心这两项）
+static int init_rknn_context(const char *model_path, const yolov8_init_options_t *opts, rknn_context *ctx,
+                             rknn_tensor_mem **model_mem)
+{
+    yolov8_model_load_t mode = opts != NULL ? opts->model_load : YOLOV8_MODEL_LOAD_MMAP;
+    int map_flags = opts != NULL ? opts->model_map_flags : 0;
+
+    // 共享权重：runtime不再为本上下文分配权重内存，直接使用share_weight_ctx的权重
+    uint32_t flag = 0;
+    rknn_init_extend extend;
+    memset(&extend, 0, sizeof(extend));
+    if (opts != NULL && opts->share_weight_ctx != 0)
+    {
+        flag |= RKNN_FLAG_SHARE_WEIGHT_MEM;
+        extend.ctx = opts->share_weight_ctx;
+    }
+
+    int64_t start_ns = perf_now_ns();
+    int64_t init_ns = start_ns;
+    int ret = -1;
 
-    ret = rknn_init(&ctx, model, model_len, 0, NULL);
-    free(model);
+    *model_mem = NULL;
+    if (mode == YOLOV8_MODEL_LOAD_ZERO_COPY)
+    {
+        ret = init_rknn_zero_copy(model_path, flag, extend, ctx, model_mem, &init_ns);
+        if (ret != 0)
+        {
+            printf("zero-copy model load not available, fall back to mmap\n");
+            mode = YOLOV8_MODEL_LOAD_MMAP;
+            start_ns = perf_now_ns();
+        }
+    }
+    if (mode == YOLOV8_MODEL_LOAD_READ)
+    {
+        char *model = NULL;
+        int model_len = read_data_from_file(model_path, &model);
+        if (model == NULL)
+        {
+            printf("load_model fail!\n");
+            return -1;
+        }
+        init_ns = perf_now_ns();
+        ret = rknn_init(ctx, model, model_len, flag, &extend);
+        free(model);
+    }
+    else if (mode == YOLOV8_MODEL_LOAD_MMAP)
+    {
+        mapped_file_t model;
+        if (map_file(model_path, map_flags, &model) != 0)
+        {
+            printf("load_model fail!\n");
+            return -1;
+        }
+        if (model.size > UINT32_MAX)
+        {
+            printf("load_model fail! model size %zu exceeds rknn_init limit\n", model.size);
+            unmap_file(&model);
+            return -1;
+        }
+        init_ns = perf_now_ns();
+        ret = rknn_init(ctx, model.data, (uint32_t)model.size, flag, &extend);
+        unmap_file(&model);
+    }
     if (ret < 0)
     {
         printf("rknn_init fail! ret=%d\n", ret);
         return -1;
     }
 
+    int64_t end_ns = perf_now_ns();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("model load (%s): %.2f ms, rknn_init: %.2f ms, peak RSS: %ld KB\n", model_load_name(mode, map_flags),
+           (init_ns - start_ns) / 1e6, (end_ns - init_ns) / 1e6, usage.ru_maxrss);
+    return 0;
+}
+
+// 由第一个输入的属性更新模型输入尺寸
+static void update_model_size(rknn_app_context_t *app_ctx)
+{
+    const rknn_tensor_attr &attr = app_ctx->input_attrs[0];
+    if (attr.fmt == RKNN_TENSOR_NCHW)
+    {
+        app_ctx->model_channel = attr.dims[1];
+        app_ctx->model_height = attr.dims[2];
+        app_ctx->model_width = attr.dims[3];
+    }
+    else
+    {
+        app_ctx->model_height = attr.dims[1];
+        app_ctx->model_width = attr.dims[2];
+        app_ctx->model_channel = attr.dims[3];
+    }
+}
+
+static int compare_shape_area(const void *a, const void *b)
+{
+    const yolov8_shape_t *sa = (const yolov8_shape_t *)a;
+    const yolov8_shape_t *sb = (const yolov8_shape_t *)b;
+    int area_a = sa->width * sa->height;
+    int area_b = sb->width * sb->height;
+    if (area_a != area_b)
+    {
+        return area_a < area_b ? -1 : 1;
+    }
+    return sa->width - sb->width;
+}
+
+// 查询第一个输入的动态形状档位，静态模型（shape_number<=1）时shapes保持为NULL
+static int query_yolov8_shapes(rknn_app_context_t *app_ctx)
+{
+    // rknn_input_range包含512组维度，约32KB，不放在栈上
+    rknn_input_range *range = (rknn_input_range *)calloc(1, sizeof(rknn_input_range));
+    if (range == NULL)
+    {
+        return -1;
+    }
+    range->index = 0;
+    int ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_INPUT_DYNAMIC_RANGE, range, sizeof(rknn_input_range));
+    if (ret != RKNN_SUCC || range->shape_number <= 1)
+    {
+        free(range);
+        return 0;
+    }
+    app_ctx->shapes = (yolov8_shape_t *)malloc(range->shape_number * sizeof(yolov8_shape_t));
+    if (app_ctx->shapes == NULL)
+    {
+        free(range);
+        return -1;
+    }
+    bool nchw = range->fmt == RKNN_TENSOR_NCHW;
+    for (uint32_t i = 0; i < range->shape_number; i++)
+    {
+        app_ctx->shapes[i].height = range->dyn_range[i][nchw ? 2 : 1];
+        app_ctx->shapes[i].width = range->dyn_range[i][nchw ? 3 : 2];
+    }
+    app_ctx->shape_num = range->shape_number;
+    free(range);
+    qsort(app_ctx->shapes, app_ctx->shape_num, sizeof(yolov8_shape_t), compare_shape_area);
+
+    printf("dynamic input shapes:");
+    for (int i = 0; i < app_ctx->shape_num; i++)
+    {
+        printf(" %dx%d", app_ctx->shapes[i].width, app_ctx->shapes[i].height);
+    }
+    printf("\n");
+    return 0;
+}
+
+int parse_yolov8_model_load(const char *spec, yolov8_init_options_t *opts)
+{
+    if (strcmp(spec, "read") == 0)
+    {
+        opts->model_load = YOLOV8_MODEL_LOAD_READ;
+        opts->model_map_flags = 0;
+    }
+    else if (strcmp(spec, "mmap") == 0)
+    {
+        opts->model_load = YOLOV8_MODEL_LOAD_MMAP;
+        opts->model_map_flags = 0;
+    }
+    else if (strcmp(spec, "populate") == 0)
+    {
+        opts->model_load = YOLOV8_MODEL_LOAD_MMAP;
+        opts->model_map_flags = FILE_MAP_POPULATE | FILE_MAP_WILLNEED;
+    }
+    else if (strcmp(spec, "zero-copy") == 0)
+    {
+        opts->model_load = YOLOV8_MODEL_LOAD_ZERO_COPY;
+        opts->model_map_flags = 0;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// 初始化失败、上下文还未交给app_ctx时释放：先rknn_destroy，零拷贝加载的模型内存在其后释放
+static void destroy_rknn_context(rknn_context ctx, rknn_tensor_mem *model_mem)
+{
+    rknn_destroy(ctx);
+    if (model_mem != NULL)
+    {
+        rknn_destroy_mem(0, model_mem);
+    }
+}
+
+int init_yolov8_model(const char *model_path, rknn_app_context_t *app_ctx)
+{
+    return init_yolov8_model_ex(model_path, app_ctx, NULL);
+}
+
+int init_yolov8_model_ex(const char *model_path, rknn_app_context_t *app_ctx, const yolov8_init_options_t *opts)
+{
+    int ret;
+    rknn_context ctx = 0;
+    rknn_tensor_mem *model_mem = NULL;
+
+    // Load RKNN Model
+    ret = init_rknn_context(model_path, opts, &ctx, &model_mem);
+    if (ret < 0)
+    {
+        return -1;
+    }
+
     rknn_sdk_version rknn_version;
     // rknn_sdk version
     ret = get_rknn_version(ctx, rknn_version);
     if (ret < 0)
     {
         printf("== get_rknn_version error ret=%d\n", ret);
+        destroy_rknn_context(ctx, model_mem);
         return -1;
     }
     printf("=== sdk api version: %s\n", rknn_version.api_version);
@@ -71,6 +309,7 @@ int init_yolov8_model(const char *model_path, rknn_app_context_t *app_ctx)
     if (ret != RKNN_SUCC)
     {
         printf("rknn_query fail! ret=%d\n", ret);
+        destroy_rknn_context(ctx, model_mem);
         return -1;
     }
     printf("model input num: %d, output num: %d\n", io_num.n_input, io_num.n_output);
@@ -86,6 +325,7 @@ int init_yolov8_model(const char *model_path, rknn_app_context_t *app_ctx)
         if (ret != RKNN_SUCC)
         {
             printf("rknn_query fail! ret=%d\n", ret);
+            destroy_rknn_context(ctx, model_mem);
             return -1;
         }
         dump_tensor_attr(&(input_attrs[i]));
@@ -102,16 +342,30 @@ int init_yolov8_model(const char *model_path, rknn_app_context_t *app_ctx)
         if (ret != RKNN_SUCC)
         {
             printf("rknn_query fail! ret=%d\n", ret);
+            destroy_rknn_context(ctx, model_mem);
             return -1;
         }
         dump_tensor_attr(&(output_attrs[i]));
     }
 
-    // Set to context
+    // Set to context：之后的失败都通过release_yolov8_model释放，先清空它会释放的字段
     app_ctx->rknn_ctx = ctx;
+    app_ctx->model_mem = model_mem;
+    app_ctx->io_num = io_num;
+    app_ctx->input_attrs = NULL;
+    app_ctx->output_attrs = NULL;
+    memset(&app_ctx->input_image, 0, sizeof(image_buffer_t));
+    app_ctx->outputs = NULL;
+    app_ctx->input_mem = NULL;
+    app_ctx->output_mems = NULL;
+    app_ctx->shapes = NULL;
+    app_ctx->shape_num = 0;
+    app_ctx->shape_index = -1;
+    app_ctx->io_mode = YOLOV8_IO_COPY;
 
     // TODO
-    if (output_attrs[0].qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC && output_attrs[0].type == RKNN_TENSOR_INT8)
+    if (output_attrs[0].qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC &&
+        (output_attrs[0].type == RKNN_TENSOR_INT8 || output_attrs[0].type == RKNN_TENSOR_UINT8))
     {
         app_ctx->is_quant = true;
     }
@@ -120,34 +374,59 @@ int init_yolov8_model(const char *model_path, rknn_app_context_t *app_ctx)
         app_ctx->is_quant = false;
     }
 
-    app_ctx->io_num = io_num;
     app_ctx->input_attrs = (rknn_tensor_attr *)malloc(io_num.n_input * sizeof(rknn_tensor_attr));
-    memcpy(app_ctx->input_attrs, input_attrs, io_num.n_input * sizeof(rknn_tensor_attr));
     app_ctx->output_attrs = (rknn_tensor_attr *)malloc(io_num.n_output * sizeof(rknn_tensor_attr));
+    if (app_ctx->input_attrs == NULL || app_ctx->output_attrs == NULL)
+    {
+        printf("alloc tensor attrs fail!\n");
+        release_yolov8_model(app_ctx);
+        return -1;
+    }
+    memcpy(app_ctx->input_attrs, input_attrs, io_num.n_input * sizeof(rknn_tensor_attr));
     memcpy(app_ctx->output_attrs, output_attrs, io_num.n_output * sizeof(rknn_tensor_attr));
 
-    if (input_attrs[0].fmt == RKNN_TENSOR_NCHW)
+    printf("model is %s input fmt\n", input_attrs[0].fmt == RKNN_TENSOR_NCHW ? "NCHW" : "NHWC");
+    update_model_size(app_ctx);
+    app_ctx->batch = (input_attrs[0].n_dims == 4 && input_attrs[0].dims[0] > 1) ? input_attrs[0].dims[0] : 1;
+    printf("model input height=%d, width=%d, channel=%d, batch=%d\n",
+           app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel, app_ctx->batch);
+
+    // 动态形状模型先切换到面积最大的档位，缓冲区按它分配，之后切换到较小档位时不用重新分配
+    app_ctx->io_mode = (opts != NULL) ? opts->io_mode : YOLOV8_IO_COPY;
+    if (app_ctx->batch > 1 && app_ctx->io_mode == YOLOV8_IO_ZERO_COPY)
     {
-        printf("model is NCHW input fmt\n");
-        app_ctx->model_channel = input_attrs[0].dims[1];
-        app_ctx->model_height = input_attrs[0].dims[2];
-        app_ctx->model_width = input_attrs[0].dims[3];
+        // BatchInferencer通过rknn_inputs_set/rknn_outputs_get提交整个batch，不能与rknn_set_io_mem混用
+        printf("batch model does not support zero-copy io, use copy mode\n");
+        app_ctx->io_mode = YOLOV8_IO_COPY;
     }
-    else
+    if (query_yolov8_shapes(app_ctx) != 0 ||
+        (app_ctx->shape_num > 0 && set_yolov8_shape(app_ctx, app_ctx->shape_num - 1) != 0))
     {
-        printf("model is NHWC input fmt\n");
-        app_ctx->model_height = input_attrs[0].dims[1];
-        app_ctx->model_width = input_attrs[0].dims[2];
-        app_ctx->model_channel = input_attrs[0].dims[3];
+        release_yolov8_model(app_ctx);
+        return -1;
     }
-    printf("model input height=%d, width=%d, channel=%d\n",
-           app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
+
+    // 输入输出缓冲区只在初始化时分配一次，推理时重复使用
+    ret = init_yolov8_io_buffers(app_ctx);
+    if (ret != 0 && app_ctx->io_mode == YOLOV8_IO_ZERO_COPY)
+    {
+        printf("zero-copy io init fail, fallback to copy mode\n");
+        app_ctx->io_mode = YOLOV8_IO_COPY;
+        ret = init_yolov8_io_buffers(app_ctx);
+    }
+    if (ret != 0)
+    {
+        release_yolov8_model(app_ctx);
+        return -1;
+    }
+    printf("model io mode: %s\n", app_ctx->io_mode == YOLOV8_IO_ZERO_COPY ? "zero-copy" : "copy");
 
     return 0;
 }
 
 int release_yolov8_model(rknn_app_context_t *app_ctx)
 {
+    release_yolov8_io_buffers(app_ctx);
     if (app_ctx->input_attrs != NULL)
     {
         free(app_ctx->input_attrs);
@@ -158,120 +437,592 @@ int release_yolov8_model(rknn_app_context_t *app_ctx)
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    if (app_ctx->shapes != NULL)
+    {
+        free(app_ctx->shapes);
+        app_ctx->shapes = NULL;
+        app_ctx->shape_num = 0;
+    }
     if (app_ctx->rknn_ctx != 0)
     {
         rknn_destroy(app_ctx->rknn_ctx);
         app_ctx->rknn_ctx = 0;
     }
+    if (app_ctx->model_mem != NULL)
+    {
+        rknn_destroy_mem(0, app_ctx->model_mem);
+        app_ctx->model_mem = NULL;
+    }
     return 0;
 }
 
-int inference_yolov8_model(rknn_app_context_t *app_ctx, image_buffer_t *img, object_detect_result_list *od_results)
+// 按当前输入输出属性把已分配的tensor内存绑定到上下文，切换动态形状档位后需要重新绑定
+static int bind_zero_copy_io(rknn_app_context_t *app_ctx)
+{
+    int ret;
+    rknn_context ctx = app_ctx->rknn_ctx;
+
+    // 输入：uint8 NHWC，letterbox直接写入tensor内存，由runtime完成归一化/量化
+    rknn_tensor_attr input_attr = app_ctx->input_attrs[0];
+    if (input_attr.w_stride != 0 && (int)input_attr.w_stride != app_ctx->model_width)
+    {
+        printf("zero-copy: input w_stride=%d != width=%d not supported\n", input_attr.w_stride, app_ctx->model_width);
+        return -1;
+    }
+    input_attr.type = RKNN_TENSOR_UINT8;
+    input_attr.fmt = RKNN_TENSOR_NHWC;
+    input_attr.pass_through = 0;
+    input_attr.size = app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
+    input_attr.size_with_stride = input_attr.size;
+    ret = rknn_set_io_mem(ctx, app_ctx->input_mem, &input_attr);
+    if (ret < 0)
+    {
+        printf("rknn_set_io_mem input fail! ret=%d\n", ret);
+        return -1;
+    }
+
+    // 输出：保持NCHW布局（量化模型int8，浮点模型float32），post_process原地读取
+    for (int i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        rknn_tensor_attr output_attr = app_ctx->output_attrs[i];
+        int size = get_yolov8_output_size(app_ctx, i);
+        if (!app_ctx->is_quant)
+        {
+            output_attr.type = RKNN_TENSOR_FLOAT32;
+        }
+        output_attr.fmt = RKNN_TENSOR_NCHW;
+        output_attr.size = size;
+        output_attr.size_with_stride = size;
+        ret = rknn_set_io_mem(ctx, app_ctx->output_mems[i], &output_attr);
+        if (ret < 0)
+        {
+            printf("rknn_set_io_mem output %d fail! ret=%d\n", i, ret);
+            return -1;
+        }
+        app_ctx->outputs[i].size = size;
+    }
+    return 0;
+}
+
+static int init_zero_copy_io_buffers(rknn_app_context_t *app_ctx)
+{
+    rknn_context ctx = app_ctx->rknn_ctx;
+
+    int input_size = app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
+    app_ctx->input_mem = rknn_create_mem2(ctx, input_size, RKNN_FLAG_MEMORY_CACHEABLE);
+    if (app_ctx->input_mem == NULL)
+    {
+        printf("rknn_create_mem2 input fail!\n");
+        return -1;
+    }
+    memset(&app_ctx->input_image, 0, sizeof(image_buffer_t));
+    app_ctx->input_image.width = app_ctx->model_width;
+    app_ctx->input_image.height = app_ctx->model_height;
+    app_ctx->input_image.format = IMAGE_FORMAT_RGB888;
+    app_ctx->input_image.size = get_image_size(&app_ctx->input_image);
+    app_ctx->input_image.virt_addr = (unsigned char *)app_ctx->input_mem->virt_addr;
+    app_ctx->input_image.fd = app_ctx->input_mem->fd;
+
+    app_ctx->outputs = (rknn_output *)calloc(app_ctx->io_num.n_output, sizeof(rknn_output));
+    app_ctx->output_mems = (rknn_tensor_mem **)calloc(app_ctx->io_num.n_output, sizeof(rknn_tensor_mem *));
+    if (app_ctx->outputs == NULL || app_ctx->output_mems == NULL)
+    {
+        release_yolov8_io_buffers(app_ctx);
+        return -1;
+    }
+    for (int i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        int size = get_yolov8_output_size(app_ctx, i);
+        app_ctx->output_mems[i] = rknn_create_mem2(ctx, size, RKNN_FLAG_MEMORY_CACHEABLE);
+        if (app_ctx->output_mems[i] == NULL)
+        {
+            printf("rknn_create_mem2 output %d fail!\n", i);
+            release_yolov8_io_buffers(app_ctx);
+            return -1;
+        }
+        app_ctx->outputs[i].index = i;
+        app_ctx->outputs[i].want_float = (!app_ctx->is_quant);
+        app_ctx->outputs[i].is_prealloc = 1;
+        app_ctx->outputs[i].buf = app_ctx->output_mems[i]->virt_addr;
+    }
+    if (bind_zero_copy_io(app_ctx) != 0)
+    {
+        release_yolov8_io_buffers(app_ctx);
+        return -1;
+    }
+    return 0;
+}
+
+static void release_zero_copy_io_buffers(rknn_app_context_t *app_ctx)
+{
+    // tensor内存由runtime分配，virt_addr只是映射，不能free
+    if (app_ctx->input_mem != NULL)
+    {
+        rknn_destroy_mem(app_ctx->rknn_ctx, app_ctx->input_mem);
+        app_ctx->input_mem = NULL;
+    }
+    app_ctx->input_image.virt_addr = NULL;
+    if (app_ctx->output_mems != NULL)
+    {
+        for (int i = 0; i < app_ctx->io_num.n_output; i++)
+        {
+            if (app_ctx->output_mems[i] != NULL)
+            {
+                rknn_destroy_mem(app_ctx->rknn_ctx, app_ctx->output_mems[i]);
+            }
+        }
+        free(app_ctx->output_mems);
+        app_ctx->output_mems = NULL;
+    }
+    if (app_ctx->outputs != NULL)
+    {
+        free(app_ctx->outputs);
+        app_ctx->outputs = NULL;
+    }
+}
+
+int init_yolov8_io_buffers(rknn_app_context_t *app_ctx)
+{
+    if (app_ctx->io_mode == YOLOV8_IO_ZERO_COPY)
+    {
+        return init_zero_copy_io_buffers(app_ctx);
+    }
+
+    // 输入：letterbox后的模型输入图像
+    memset(&app_ctx->input_image, 0, sizeof(image_buffer_t));
+    app_ctx->input_image.width = app_ctx->model_width;
+    app_ctx->input_image.height = app_ctx->model_height;
+    app_ctx->input_image.format = IMAGE_FORMAT_RGB888;
+    app_ctx->input_image.size = get_image_size(&app_ctx->input_image);
+    app_ctx->input_image.virt_addr = (unsigned char *)malloc(app_ctx->input_image.size);
+    if (app_ctx->input_image.virt_addr == NULL)
+    {
+        printf("alloc input buffer fail! size=%d\n", app_ctx->input_image.size);
+        return -1;
+    }
+
+    // 输出：每个输出tensor一块缓冲区，rknn_outputs_get时以is_prealloc方式写入
+    app_ctx->outputs = (rknn_output *)calloc(app_ctx->io_num.n_output, sizeof(rknn_output));
+    if (app_ctx->outputs == NULL)
+    {
+        release_yolov8_io_buffers(app_ctx);
+        return -1;
+    }
+    for (int i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        int size = get_yolov8_output_size(app_ctx, i);
+        app_ctx->outputs[i].index = i;
+        app_ctx->outputs[i].want_float = (!app_ctx->is_quant);
+        app_ctx->outputs[i].is_prealloc = 1;
+        app_ctx->outputs[i].size = size;
+        app_ctx->outputs[i].buf = malloc(size);
+        if (app_ctx->outputs[i].buf == NULL)
+        {
+            printf("alloc output buffer %d fail! size=%d\n", i, size);
+            release_yolov8_io_buffers(app_ctx);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void release_yolov8_io_buffers(rknn_app_context_t *app_ctx)
+{
+    if (app_ctx->io_mode == YOLOV8_IO_ZERO_COPY)
+    {
+        release_zero_copy_io_buffers(app_ctx);
+        return;
+    }
+    if (app_ctx->input_image.virt_addr != NULL)
+    {
+        free(app_ctx->input_image.virt_addr);
+        app_ctx->input_image.virt_addr = NULL;
+    }
+    if (app_ctx->outputs != NULL)
+    {
+        for (int i = 0; i < app_ctx->io_num.n_output; i++)
+        {
+            free(app_ctx->outputs[i].buf);
+        }
+        free(app_ctx->outputs);
+        app_ctx->outputs = NULL;
+    }
+}
+
+int select_yolov8_shape(rknn_app_context_t *app_ctx, int img_width, int img_height)
+{
+    if (app_ctx == NULL || app_ctx->shape_num <= 0 || img_width <= 0 || img_height <= 0)
+    {
+        return -1;
+    }
+    // letterbox缩放比例min(w/iw, h/ih)决定检测精度：先求所有档位能达到的最大比例，
+    // 再在达到该比例的档位中选面积最小的（shapes按面积升序），少算填充的灰边
+    float best_scale = 0.f;
+    for (int i = 0; i < app_ctx->shape_num; i++)
+    {
+        float scale = std::min((float)app_ctx->shapes[i].width / img_width,
+                               (float)app_ctx->shapes[i].height / img_height);
+        best_scale = std::max(best_scale, scale);
+    }
+    for (int i = 0; i < app_ctx->shape_num; i++)
+    {
+        float scale = std::min((float)app_ctx->shapes[i].width / img_width,
+                               (float)app_ctx->shapes[i].height / img_height);
+        if (scale >= best_scale * (1.f - 1e-3f))
+        {
+            return i;
+        }
+    }
+    return app_ctx->shape_num - 1;
+}
+
+void get_yolov8_max_input_size(const rknn_app_context_t *app_ctx, int *width, int *height)
+{
+    *width = app_ctx->model_width;
+    *height = app_ctx->model_height;
+    for (int i = 0; i < app_ctx->shape_num; i++)
+    {
+        *width = std::max(*width, app_ctx->shapes[i].width);
+        *height = std::max(*height, app_ctx->shapes[i].height);
+    }
+}
+
+int set_yolov8_shape(rknn_app_context_t *app_ctx, int index)
+{
+    if (app_ctx == NULL || index < 0 || index >= app_ctx->shape_num)
+    {
+        return -1;
+    }
+    if (index == app_ctx->shape_index)
+    {
+        return 0;
+    }
+    const yolov8_shape_t &shape = app_ctx->shapes[index];
+    rknn_tensor_attr attrs[app_ctx->io_num.n_input];
+    memcpy(attrs, app_ctx->input_attrs, sizeof(attrs));
+    if (attrs[0].fmt == RKNN_TENSOR_NCHW)
+    {
+        attrs[0].dims[2] = shape.height;
+        attrs[0].dims[3] = shape.width;
+    }
+    else
+    {
+        attrs[0].dims[1] = shape.height;
+        attrs[0].dims[2] = shape.width;
+    }
+    int ret = rknn_set_input_shapes(app_ctx->rknn_ctx, app_ctx->io_num.n_input, attrs);
+    if (ret < 0)
+    {
+        LOGE("rknn_set_input_shapes %dx%d fail! ret=%d", shape.width, shape.height, ret);
+        return -1;
+    }
+
+    // 输出网格随输入变化，重新查询当前形状下的属性
+    for (uint32_t i = 0; i < app_ctx->io_num.n_input; i++)
+    {
+        app_ctx->input_attrs[i].index = i;
+        ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_CURRENT_INPUT_ATTR, &app_ctx->input_attrs[i], sizeof(rknn_tensor_attr));
+        if (ret != RKNN_SUCC)
+        {
+            LOGE("query current input attr fail! ret=%d", ret);
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        app_ctx->output_attrs[i].index = i;
+        ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_CURRENT_OUTPUT_ATTR, &app_ctx->output_attrs[i], sizeof(rknn_tensor_attr));
+        if (ret != RKNN_SUCC)
+        {
+            LOGE("query current output attr fail! ret=%d", ret);
+            return -1;
+        }
+    }
+    update_model_size(app_ctx);
+    app_ctx->shape_index = index;
+
+    // 初始化时在分配缓冲区之前切换，之后只更新尺寸，缓冲区按最大档位分配足够使用
+    if (app_ctx->input_image.virt_addr == NULL)
+    {
+        return 0;
+    }
+    app_ctx->input_image.width = app_ctx->model_width;
+    app_ctx->input_image.height = app_ctx->model_height;
+    app_ctx->input_image.size = get_image_size(&app_ctx->input_image);
+    if (app_ctx->io_mode == YOLOV8_IO_ZERO_COPY)
+    {
+        return bind_zero_copy_io(app_ctx);
+    }
+    for (int i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        app_ctx->outputs[i].size = get_yolov8_output_size(app_ctx, i);
+    }
+    return 0;
+}
+
+int get_yolov8_output_size(rknn_app_context_t *app_ctx, int index)
+{
+    if (app_ctx == NULL || index < 0 || index >= (int)app_ctx->io_num.n_output)
+    {
+        return -1;
+    }
+    // 量化模型直接取int8原始输出，浮点模型由runtime转换为float
+    int elem_size = app_ctx->is_quant ? sizeof(int8_t) : sizeof(float);
+    return app_ctx->output_attrs[index].n_elems * elem_size;
+}
+
+int preprocess_yolov8_model(rknn_app_context_t *app_ctx, image_buffer_t *img, image_buffer_t *dst_img, letterbox_t *letter_box)
 {
     int ret;
-    image_buffer_t dst_img;
-    letterbox_t letter_box;
-    rknn_input inputs[app_ctx->io_num.n_input];
-    rknn_output outputs[app_ctx->io_num.n_output];
-    const float nms_threshold = NMS_THRESH;
-    const float box_conf_threshold = BOX_THRESH;
     int bg_color = 114;
-    
-    // 添加时间计算变量
-    struct timeval start_time, end_time;
-    double inference_time_ms;
 
-    if ((!app_ctx) || !(img) || (!od_results))
+    if ((!app_ctx) || (!img) || (!dst_img) || (!letter_box))
     {
         return -1;
     }
 
-    memset(od_results, 0x00, sizeof(*od_results));
-    memset(&letter_box, 0, sizeof(letterbox_t));
-    memset(&dst_img, 0, sizeof(image_buffer_t));
-    memset(inputs, 0, sizeof(inputs));
-    memset(outputs, 0, sizeof(outputs));
-
-    // Pre Process
-    dst_img.width = app_ctx->model_width;
-    dst_img.height = app_ctx->model_height;
-    dst_img.format = IMAGE_FORMAT_RGB888;
-    dst_img.size = get_image_size(&dst_img);
-    // 移除这行：dst_img.virt_addr = (unsigned char *)malloc(dst_img.size);
-    dst_img.virt_addr = NULL;  // 让DMA分配器处理
-    dst_img.fd = 0;
-    
+    memset(letter_box, 0, sizeof(letterbox_t));
+
+    // dst_img->virt_addr为NULL时由convert_image_with_letterbox分配，调用者负责释放
+    dst_img->width = app_ctx->model_width;
+    dst_img->height = app_ctx->model_height;
+    dst_img->format = IMAGE_FORMAT_RGB888;
+    dst_img->size = get_image_size(dst_img);
 
-    
     // letterbox
-    ret = convert_image_with_letterbox(img, &dst_img, &letter_box, bg_color);
+    PerfSpan span(PERF_LETTERBOX);
+    ret = convert_image_with_letterbox(img, dst_img, letter_box, bg_color);
     if (ret < 0)
     {
-        printf("convert_image_with_letterbox fail! ret=%d\n", ret);
+        LOGE("convert_image_with_letterbox fail! ret=%d", ret);
         return -1;
     }
+    return 0;
+}
+
+// 设置模型输入：拷贝模式通过rknn_inputs_set，零拷贝模式写入tensor内存
+static int set_yolov8_inputs(rknn_app_context_t *app_ctx, image_buffer_t *dst_img)
+{
+    int ret;
+    if (app_ctx->batch > 1)
+    {
+        LOGE("model batch=%d needs a full batch per run, use BatchInferencer", app_ctx->batch);
+        return -1;
+    }
+    if (app_ctx->io_mode == YOLOV8_IO_ZERO_COPY)
+    {
+        // 流水线中每帧有独立的输入缓冲区，此时才需要拷贝进tensor内存
+        if (dst_img->virt_addr != app_ctx->input_mem->virt_addr)
+        {
+            memcpy(app_ctx->input_mem->virt_addr, dst_img->virt_addr, app_ctx->input_image.size);
+        }
+        rknn_mem_sync(app_ctx->rknn_ctx, app_ctx->input_mem, RKNN_MEMORY_SYNC_TO_DEVICE);
+        return 0;
+    }
 
-    // Set Input Data
+    rknn_input inputs[app_ctx->io_num.n_input];
+    memset(inputs, 0, sizeof(inputs));
     inputs[0].index = 0;
     inputs[0].type = RKNN_TENSOR_UINT8;
     inputs[0].fmt = RKNN_TENSOR_NHWC;
     inputs[0].size = app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
-    inputs[0].buf = dst_img.virt_addr;
+    inputs[0].buf = dst_img->virt_addr;
 
     ret = rknn_inputs_set(app_ctx->rknn_ctx, app_ctx->io_num.n_input, inputs);
     if (ret < 0)
     {
-        printf("rknn_input_set fail! ret=%d\n", ret);
+        LOGE("rknn_input_set fail! ret=%d", ret);
         return -1;
     }
+    return 0;
+}
 
-    // Run
-    printf("rknn_run\n");
-    
-    // 记录推理开始时间
-    gettimeofday(&start_time, NULL);
-    
-    ret = rknn_run(app_ctx->rknn_ctx, nullptr);
+// 取出模型输出：拷贝模式通过rknn_outputs_get，零拷贝模式同步tensor内存，outputs不是上下文自己的缓冲区时拷贝过去
+static int get_yolov8_outputs(rknn_app_context_t *app_ctx, rknn_output *outputs, rknn_output_extend *extend)
+{
+    int ret;
+    rknn_context ctx = app_ctx->rknn_ctx;
+
+    for (int i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        if (outputs[i].buf == NULL)
+        {
+            LOGE("run_yolov8_model: output %d buffer is null", i);
+            return -1;
+        }
+        outputs[i].index = i;
+        outputs[i].want_float = (!app_ctx->is_quant);
+        outputs[i].is_prealloc = 1;
+        outputs[i].size = get_yolov8_output_size(app_ctx, i);
+    }
+
+    if (app_ctx->io_mode == YOLOV8_IO_ZERO_COPY)
+    {
+        for (int i = 0; i < app_ctx->io_num.n_output; i++)
+        {
+            rknn_mem_sync(ctx, app_ctx->output_mems[i], RKNN_MEMORY_SYNC_FROM_DEVICE);
+            if (outputs != app_ctx->outputs)
+            {
+                memcpy(outputs[i].buf, app_ctx->output_mems[i]->virt_addr, outputs[i].size);
+            }
+        }
+        return 0;
+    }
+
+    // 输出写入调用者提供的缓冲区（is_prealloc），多帧同时在流水线中时互不干扰
+    ret = rknn_outputs_get(ctx, app_ctx->io_num.n_output, outputs, extend);
     if (ret < 0)
     {
-        printf("rknn_run fail! ret=%d\n", ret);
+        LOGE("rknn_outputs_get fail! ret=%d", ret);
         return -1;
     }
-    
-    // 记录推理结束时间并计算推理时间
-    gettimeofday(&end_time, NULL);
-    inference_time_ms = (end_time.tv_sec - start_time.tv_sec) * 1000.0 + 
-                       (end_time.tv_usec - start_time.tv_usec) / 1000.0;
-    
-    printf("推理时间: %.2f ms\n", inference_time_ms);
+    rknn_outputs_release(ctx, app_ctx->io_num.n_output, outputs);
+    return 0;
+}
 
-    // Get Output
-    memset(outputs, 0, sizeof(outputs));
-    for (int i = 0; i < app_ctx->io_num.n_output; i++)
+int run_yolov8_model(rknn_app_context_t *app_ctx, image_buffer_t *dst_img, rknn_output *outputs)
+{
+    int ret;
+
+    if ((!dst_img) || (!dst_img->virt_addr) || (!outputs))
     {
-        outputs[i].index = i;
-        outputs[i].want_float = (!app_ctx->is_quant);
+        return -1;
+    }
+
+    int64_t t0 = perf_now_ns();
+    if (set_yolov8_inputs(app_ctx, dst_img) < 0)
+    {
+        return -1;
     }
-    ret = rknn_outputs_get(app_ctx->rknn_ctx, app_ctx->io_num.n_output, outputs, NULL);
+    int64_t t1 = perf_now_ns();
+    perf_record(PERF_INPUTS_SET, t1 - t0);
+
+    ret = rknn_run(app_ctx->rknn_ctx, nullptr);
     if (ret < 0)
     {
-        printf("rknn_outputs_get fail! ret=%d\n", ret);
-        goto out;
+        LOGE("rknn_run fail! ret=%d", ret);
+        return -1;
     }
+    int64_t t2 = perf_now_ns();
+    perf_record(PERF_RUN, t2 - t1);
 
-    // Post Process
-    post_process(app_ctx, outputs, &letter_box, box_conf_threshold, nms_threshold, od_results);
+    ret = get_yolov8_outputs(app_ctx, outputs, NULL);
+    perf_record(PERF_OUTPUTS_GET, perf_now_ns() - t2);
+    return ret;
+}
+
+int submit_yolov8_model(rknn_app_context_t *app_ctx, image_buffer_t *dst_img, uint64_t *frame_id)
+{
+    int ret;
+
+    if ((!dst_img) || (!dst_img->virt_addr) || (!frame_id))
+    {
+        return -1;
+    }
 
-    // Remeber to release rknn output
-    rknn_outputs_release(app_ctx->rknn_ctx, app_ctx->io_num.n_output, outputs);
+    int64_t t0 = perf_now_ns();
+    if (set_yolov8_inputs(app_ctx, dst_img) < 0)
+    {
+        return -1;
+    }
+    perf_record(PERF_INPUTS_SET, perf_now_ns() - t0);
 
+    rknn_run_extend run_ext;
+    memset(&run_ext, 0, sizeof(run_ext));
+    run_ext.non_block = 1;
+    ret = rknn_run(app_ctx->rknn_ctx, &run_ext);
+    if (ret < 0)
+    {
+        LOGE("rknn_run(non_block) fail! ret=%d", ret);
+        return -1;
+    }
+    *frame_id = run_ext.frame_id;
     return 0;
-    
-out:
-    // 在函数结束前添加
-    if (dst_img.virt_addr != NULL) {
-        free_image_buffer(&dst_img);
+}
+
+int wait_yolov8_model(rknn_app_context_t *app_ctx, uint64_t frame_id, rknn_output *outputs)
+{
+    int ret;
+
+    if (!outputs)
+    {
+        return -1;
     }
 
+    rknn_run_extend run_ext;
+    memset(&run_ext, 0, sizeof(run_ext));
+    run_ext.frame_id = frame_id;
+    ret = rknn_wait(app_ctx->rknn_ctx, &run_ext);
+    if (ret < 0)
+    {
+        LOGE("rknn_wait fail! ret=%d frame_id=%llu", ret, (unsigned long long)frame_id);
+        return -1;
+    }
+
+    PerfSpan span(PERF_OUTPUTS_GET);
+    rknn_output_extend out_ext;
+    memset(&out_ext, 0, sizeof(out_ext));
+    ret = get_yolov8_outputs(app_ctx, outputs, &out_ext);
+    if (ret == 0 && app_ctx->io_mode == YOLOV8_IO_COPY && out_ext.frame_id != frame_id)
+    {
+        LOGW_EVERY_MS(1000, "rknn_outputs_get: got frame %llu, expected %llu", (unsigned long long)out_ext.frame_id,
+                      (unsigned long long)frame_id);
+    }
     return ret;
-}
\ No newline at end of file
+}
+
+int inference_yolov8_model(rknn_app_context_t *app_ctx, image_buffer_t *img, object_detect_result_list *od_results)
+{
+    int ret;
+    letterbox_t letter_box;
+    const float nms_threshold = NMS_THRESH;
+    const float box_conf_threshold = BOX_THRESH;
+    
+
+    if ((!app_ctx) || !(img) || (!od_results))
+    {
+        return -1;
+    }
+    if (app_ctx->input_image.virt_addr == NULL || app_ctx->outputs == NULL)
+    {
+        LOGE("inference_yolov8_model: io buffers not initialized");
+        return -1;
+    }
+
+    reset_detect_result_list(od_results);
+
+    // 动态形状模型按帧的宽高比切换档位，失败时沿用当前档位
+    if (app_ctx->shape_num > 0)
+    {
+        int shape = select_yolov8_shape(app_ctx, img->width, img->height);
+        if (set_yolov8_shape(app_ctx, shape) != 0)
+        {
+            LOGW("set_yolov8_shape %d fail, keep %dx%d", shape, app_ctx->model_width, app_ctx->model_height);
+        }
+    }
+
+    // Pre Process：letterbox直接写入上下文中预分配的输入缓冲区
+    ret = preprocess_yolov8_model(app_ctx, img, &app_ctx->input_image, &letter_box);
+    if (ret < 0)
+    {
+        return -1;
+    }
+
+    // Run
+    LOGD("rknn_run");
+    
+    // 输出通过is_prealloc写入上下文中预分配的输出缓冲区（inputs_set/run/outputs_get分别计入耗时统计）
+    int64_t start_ns = perf_now_ns();
+    ret = run_yolov8_model(app_ctx, &app_ctx->input_image, app_ctx->outputs);
+    if (ret < 0)
+    {
+        return -1;
+    }
+    
+    LOGD("推理时间: %.2f ms", (perf_now_ns() - start_ns) / 1e6);
+
+    // Post Process
+    post_process(app_ctx, app_ctx->outputs, &letter_box, box_conf_threshold, nms_threshold, od_results);
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef _RKNN_YOLOV8_DEMO_TEST_COMMON_H_
+#define _RKNN_YOLOV8_DEMO_TEST_COMMON_H_
+
+/**
+ * @file test_common.h
+ * @brief 主机测试的断言宏：失败时打印位置并计数，main最后用TEST_RESULT()返回
+ */
+
+#include <stdio.h>
+
+static int g_test_failures = 0;
+
+#define TEST_CHECK(cond)                                                          \
+    do                                                                            \
+    {                                                                             \
+        if (!(cond))                                                              \
+        {                                                                         \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);       \
+            g_test_failures++;                                                    \
+        }                                                                         \
+    } while (0)
+
+#define TEST_RESULT()                                                             \
+    (g_test_failures == 0 ? (printf("all checks passed\n"), 0)                    \
+                          : (printf("%d checks failed\n", g_test_failures), 1))
+
+#endif //_RKNN_YOLOV8_DEMO_TEST_COMMON_H_
@@ -0,0 +1,301 @@
+/**
+ * @file test_image_utils.cc
+ * @brief convert_image的定点缩放与原浮点实现对比（相差不超过1），NV12/NV21直接转RGB与BT.601参考对比，
+ *        多线程结果与单线程逐位相同，
+ *        以及短生命周期线程退出时释放各自的缩放临时缓冲区
+ */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "image_utils.h"
+#include "test_common.h"
+
+namespace {
+
+// 原浮点双线性实现（定点实现之前的crop_and_scale_image_c），只作为参考
+void scale_reference(int channel, const unsigned char* src, int src_width, int src_height, int crop_x, int crop_y,
+                     int crop_width, int crop_height, unsigned char* dst, int dst_width, int dst_box_x, int dst_box_y,
+                     int dst_box_width, int dst_box_height)
+{
+    float x_ratio = (float)crop_width / (float)dst_box_width;
+    float y_ratio = (float)crop_height / (float)dst_box_height;
+    for (int dst_y = dst_box_y; dst_y < dst_box_y + dst_box_height; dst_y++)
+    {
+        for (int dst_x = dst_box_x; dst_x < dst_box_x + dst_box_width; dst_x++)
+        {
+            int dst_x_offset = dst_x - dst_box_x;
+            int dst_y_offset = dst_y - dst_box_y;
+            int src_x = (int)(dst_x_offset * x_ratio) + crop_x;
+            int src_y = (int)(dst_y_offset * y_ratio) + crop_y;
+            float x_diff = (dst_x_offset * x_ratio) - (src_x - crop_x);
+            float y_diff = (dst_y_offset * y_ratio) - (src_y - crop_y);
+
+            int index1 = src_y * src_width * channel + src_x * channel;
+            int index2 = index1 + src_width * channel;
+            if (src_y == src_height - 1)
+            {
+                index2 = index1 - src_width * channel;
+            }
+            int index3 = index1 + 1 * channel;
+            int index4 = index2 + 1 * channel;
+            if (src_x == src_width - 1)
+            {
+                index3 = index1 - 1 * channel;
+                index4 = index2 - 1 * channel;
+            }
+            for (int c = 0; c < channel; c++)
+            {
+                unsigned char A = src[index1 + c];
+                unsigned char B = src[index3 + c];
+                unsigned char C = src[index2 + c];
+                unsigned char D = src[index4 + c];
+                unsigned char pixel = (unsigned char)(A * (1 - x_diff) * (1 - y_diff) + B * x_diff * (1 - y_diff) +
+                                                      C * y_diff * (1 - x_diff) + D * x_diff * y_diff);
+                dst[(dst_y * dst_width + dst_x) * channel + c] = pixel;
+            }
+        }
+    }
+}
+
+struct ScaleCase {
+    image_format_t format;
+    int channel;
+    int src_w, src_h;
+    int crop_x, crop_y, crop_w, crop_h;
+    int dst_w, dst_h;
+    int box_x, box_y, box_w, box_h;
+};
+
+image_buffer_t make_image(image_format_t format, int width, int height, std::vector<unsigned char>& data)
+{
+    image_buffer_t img;
+    memset(&img, 0, sizeof(img));
+    img.width = width;
+    img.height = height;
+    img.format = format;
+    img.size = get_image_size(&img);
+    data.resize(img.size);
+    img.virt_addr = data.data();
+    return img;
+}
+
+void fill_random(std::vector<unsigned char>& data)
+{
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = (unsigned char)(rand() & 0xff);
+    }
+}
+
+// 返回定点结果与浮点参考的最大差值，并检查多线程结果与单线程相同
+int check_scale_case(const ScaleCase& c)
+{
+    std::vector<unsigned char> src_data, ref_data, out_data, par_data;
+    image_buffer_t src = make_image(c.format, c.src_w, c.src_h, src_data);
+    fill_random(src_data);
+    image_buffer_t out = make_image(c.format, c.dst_w, c.dst_h, out_data);
+    image_buffer_t par = make_image(c.format, c.dst_w, c.dst_h, par_data);
+    ref_data.assign(out_data.size(), 114);
+
+    image_rect_t src_box = {c.crop_x, c.crop_y, c.crop_x + c.crop_w - 1, c.crop_y + c.crop_h - 1};
+    image_rect_t dst_box = {c.box_x, c.box_y, c.box_x + c.box_w - 1, c.box_y + c.box_h - 1};
+
+    set_image_convert_threads(1, NULL, 0);
+    TEST_CHECK(convert_image(&src, &out, &src_box, &dst_box, 114) == 0);
+    set_image_convert_threads(3, NULL, 0);
+    TEST_CHECK(convert_image(&src, &par, &src_box, &dst_box, 114) == 0);
+    set_image_convert_threads(1, NULL, 0);
+    TEST_CHECK(out_data == par_data);
+
+    scale_reference(c.channel, src_data.data(), c.src_w, c.src_h, c.crop_x, c.crop_y, c.crop_w, c.crop_h,
+                    ref_data.data(), c.dst_w, c.box_x, c.box_y, c.box_w, c.box_h);
+    int max_diff = 0;
+    for (size_t i = 0; i < out_data.size(); i++)
+    {
+        int d = abs((int)out_data[i] - (int)ref_data[i]);
+        max_diff = d > max_diff ? d : max_diff;
+    }
+    return max_diff;
+}
+
+void test_fixed_point_scale()
+{
+    const ScaleCase cases[] = {
+        // 1080p letterbox到640x640（缩小）
+        {IMAGE_FORMAT_RGB888, 3, 1920, 1080, 0, 0, 1920, 1080, 640, 640, 0, 140, 640, 360},
+        // 放大、奇数尺寸、裁剪偏移
+        {IMAGE_FORMAT_RGB888, 3, 321, 243, 17, 9, 301, 229, 640, 640, 3, 5, 633, 611},
+        {IMAGE_FORMAT_RGBA8888, 4, 499, 375, 0, 0, 499, 375, 417, 333, 0, 0, 417, 333},
+        {IMAGE_FORMAT_GRAY8, 1, 1281, 721, 1, 3, 1279, 717, 639, 640, 0, 141, 639, 359},
+        // 裁剪到源图右下边缘，最后一行/列向左上取邻点
+        {IMAGE_FORMAT_RGB888, 3, 200, 150, 120, 90, 80, 60, 333, 251, 0, 0, 333, 251},
+        // 目标区域只有一行一列
+        {IMAGE_FORMAT_RGB888, 3, 64, 48, 0, 0, 64, 48, 1, 1, 0, 0, 1, 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        int max_diff = check_scale_case(cases[i]);
+        printf("scale case %zu: max diff vs float %d\n", i, max_diff);
+        TEST_CHECK(max_diff <= 1);
+    }
+}
+
+// NV12/NV21转RGB的参考：亮度用浮点双线性缩放，色度取亮度左上源像素所在2x2块，
+// 按BT.601（与OpenCV YUV420sp2RGB相同的20位定点常量）逐像素转换
+const int kYuvShift = 20;
+const int kCY = 1220542;
+const int kCUB = 2116026;
+const int kCUG = -409993;
+const int kCVG = -852492;
+const int kCVR = 1673527;
+
+unsigned char clamp_u8(int v)
+{
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+void yuv420sp_to_rgb_reference(bool nv21, const unsigned char* src, int src_width, int src_height, int crop_x,
+                               int crop_y, int crop_width, int crop_height, unsigned char* dst, int dst_width,
+                               int box_x, int box_y, int box_w, int box_h)
+{
+    std::vector<unsigned char> luma((size_t)box_w * box_h);
+    scale_reference(1, src, src_width, src_height, crop_x, crop_y, crop_width, crop_height, luma.data(), box_w, 0, 0,
+                    box_w, box_h);
+    const unsigned char* src_uv = src + (size_t)src_width * src_height;
+    float x_ratio = (float)crop_width / (float)box_w;
+    float y_ratio = (float)crop_height / (float)box_h;
+    for (int y = 0; y < box_h; y++)
+    {
+        int src_y = (int)(y * y_ratio) + crop_y;
+        for (int x = 0; x < box_w; x++)
+        {
+            int src_x = (int)(x * x_ratio) + crop_x;
+            const unsigned char* uv = src_uv + (size_t)(src_y / 2) * src_width + (src_x / 2) * 2;
+            int u = (nv21 ? uv[1] : uv[0]) - 128;
+            int v = (nv21 ? uv[0] : uv[1]) - 128;
+            int yy = luma[(size_t)y * box_w + x];
+            yy = (yy > 16 ? yy - 16 : 0) * kCY;
+            int round = 1 << (kYuvShift - 1);
+            unsigned char* out = dst + ((size_t)(box_y + y) * dst_width + box_x + x) * 3;
+            out[0] = clamp_u8((yy + round + kCVR * v) >> kYuvShift);
+            out[1] = clamp_u8((yy + round + kCVG * v + kCUG * u) >> kYuvShift);
+            out[2] = clamp_u8((yy + round + kCUB * u) >> kYuvShift);
+        }
+    }
+}
+
+struct YuvCase {
+    int src_w, src_h;
+    int crop_x, crop_y, crop_w, crop_h;
+    int dst_w, dst_h;
+    int box_x, box_y, box_w, box_h;
+};
+
+// 返回与参考的最大差值，并检查多线程结果与单线程相同
+int check_yuv_case(const YuvCase& c, bool nv21)
+{
+    std::vector<unsigned char> src_data, ref_data, out_data, par_data;
+    image_buffer_t src = make_image(nv21 ? IMAGE_FORMAT_YUV420SP_NV21 : IMAGE_FORMAT_YUV420SP_NV12, c.src_w,
+                                    c.src_h, src_data);
+    fill_random(src_data);
+    image_buffer_t out = make_image(IMAGE_FORMAT_RGB888, c.dst_w, c.dst_h, out_data);
+    image_buffer_t par = make_image(IMAGE_FORMAT_RGB888, c.dst_w, c.dst_h, par_data);
+    ref_data.assign(out_data.size(), 114);
+
+    image_rect_t src_box = {c.crop_x, c.crop_y, c.crop_x + c.crop_w - 1, c.crop_y + c.crop_h - 1};
+    image_rect_t dst_box = {c.box_x, c.box_y, c.box_x + c.box_w - 1, c.box_y + c.box_h - 1};
+
+    set_image_convert_threads(1, NULL, 0);
+    TEST_CHECK(convert_image(&src, &out, &src_box, &dst_box, 114) == 0);
+    set_image_convert_threads(3, NULL, 0);
+    TEST_CHECK(convert_image(&src, &par, &src_box, &dst_box, 114) == 0);
+    set_image_convert_threads(1, NULL, 0);
+    TEST_CHECK(out_data == par_data);
+
+    yuv420sp_to_rgb_reference(nv21, src_data.data(), c.src_w, c.src_h, c.crop_x, c.crop_y, c.crop_w, c.crop_h,
+                              ref_data.data(), c.dst_w, c.box_x, c.box_y, c.box_w, c.box_h);
+    int max_diff = 0;
+    for (size_t i = 0; i < out_data.size(); i++)
+    {
+        int d = abs((int)out_data[i] - (int)ref_data[i]);
+        max_diff = d > max_diff ? d : max_diff;
+    }
+    return max_diff;
+}
+
+void test_yuv420sp_to_rgb()
+{
+    // YUV420SP的源宽高为偶数；裁剪偏移、裁剪尺寸、目标区域位置和宽度覆盖奇数
+    const YuvCase cases[] = {
+        // 不缩放：与逐像素转换逐位相同
+        {64, 48, 0, 0, 64, 48, 64, 48, 0, 0, 64, 48},
+        {1280, 720, 0, 0, 1280, 720, 1280, 720, 0, 0, 1280, 720},
+        {130, 98, 3, 5, 67, 41, 75, 51, 7, 9, 67, 41},
+        // 1080p letterbox到640x640
+        {1920, 1080, 0, 0, 1920, 1080, 640, 640, 0, 140, 640, 360},
+        // 奇数偏移裁剪后放大/缩小到奇数宽度的目标区域
+        {642, 482, 1, 3, 639, 477, 641, 641, 0, 1, 641, 479},
+        {322, 242, 11, 7, 301, 233, 417, 333, 5, 3, 411, 327},
+        // 裁剪到右下边缘
+        {200, 150, 121, 91, 79, 59, 333, 251, 0, 0, 333, 251},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const YuvCase& c = cases[i];
+        bool same_size = (c.crop_w == c.box_w && c.crop_h == c.box_h);
+        for (int nv21 = 0; nv21 < 2; nv21++)
+        {
+            int max_diff = check_yuv_case(c, nv21 != 0);
+            printf("%s case %zu: max diff vs BT.601 reference %d\n", nv21 ? "nv21" : "nv12", i, max_diff);
+            // 不缩放时逐位相同；缩放时亮度与浮点参考相差不超过1，乘以1.164后RGB相差不超过2
+            TEST_CHECK(max_diff <= (same_size ? 0 : 2));
+        }
+    }
+}
+
+// 每个线程用完即退出，线程临时缓冲区应在线程退出时释放：已用堆内存不随线程数增长
+void test_short_lived_threads()
+{
+    std::vector<unsigned char> src_data;
+    image_buffer_t src = make_image(IMAGE_FORMAT_RGB888, 640, 480, src_data);
+    fill_random(src_data);
+    auto letterbox_once = [&src]() {
+        std::vector<unsigned char> dst_data;
+        image_buffer_t dst = make_image(IMAGE_FORMAT_RGB888, 320, 320, dst_data);
+        letterbox_t lb;
+        TEST_CHECK(convert_image_with_letterbox(&src, &dst, &lb, 114) == 0);
+    };
+    // 第一个线程创建线程私有key等一次性的分配
+    std::thread(letterbox_once).join();
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    size_t before = mallinfo2().uordblks;
+#endif
+    const int kThreads = 50;
+    for (int t = 0; t < kThreads; t++)
+    {
+        std::thread(letterbox_once).join();
+    }
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    long growth = (long)(mallinfo2().uordblks - before);
+    printf("heap growth after %d short-lived threads: %ld bytes\n", kThreads, growth);
+    // 每个线程的临时缓冲区约14KB，泄漏时增长远大于这个余量
+    TEST_CHECK(growth < 16 * 1024);
+#endif
+}
+
+} // namespace
+
+int main()
+{
+    srand(1);
+    test_fixed_point_scale();
+    test_yuv420sp_to_rgb();
+    test_short_lived_threads();
+    set_image_convert_threads(1, NULL, 0);
+    return TEST_RESULT();
+}
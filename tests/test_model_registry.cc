@@ -0,0 +1,76 @@
+/**
+ * @file test_model_registry.cc
+ * @brief ModelRegistry按图像尺寸选择模型：640和1280两个共享权重的模型，
+ *        --fast-decode缩小解码的图像按原图尺寸选择，与原尺寸解码时选择的模型相同
+ *
+ * 用法：test_model_registry <640录制文件> <1280录制文件>
+ */
+
+#include <string.h>
+
+#include "model_registry.h"
+#include "test_common.h"
+
+namespace {
+
+void test_select_decoded(ModelRegistry* models)
+{
+    rknn_app_context_t* small = models->find(640, 640);
+    rknn_app_context_t* large = models->find(1280, 1280);
+    TEST_CHECK(small != NULL && large != NULL);
+
+    struct Case {
+        int width, height;      // 解码后的尺寸
+        float decode_scale;     // 解码尺寸/原图尺寸
+        int expect_side;
+    };
+    const Case cases[] = {
+        {1500, 1125, 0.375f, 1280},     // 4000x3000按3/8解码：原图超过1280，用最大的模型
+        {600, 450, 0.5f, 1280},         // 1200x900按1/2解码：1280能容纳原图，640不能
+        {480, 360, 0.75f, 640},         // 640x480按3/4解码：640能容纳原图
+        {1000, 700, 1.0f, 1280},        // 原尺寸解码
+        {500, 300, 1.0f, 640},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const Case& c = cases[i];
+        rknn_app_context_t* selected = models->select_decoded(c.width, c.height, c.decode_scale);
+        rknn_app_context_t* expect = c.expect_side == 640 ? small : large;
+        printf("decoded %dx%d at scale %.3f: selected %dx%d, expected %dx%d\n", c.width, c.height, c.decode_scale,
+               selected != NULL ? selected->model_width : 0, selected != NULL ? selected->model_height : 0,
+               c.expect_side, c.expect_side);
+        TEST_CHECK(selected == expect);
+        // 与按原图尺寸选择的结果一致
+        int orig_width = (int)(c.width / c.decode_scale + 0.5f);
+        int orig_height = (int)(c.height / c.decode_scale + 0.5f);
+        TEST_CHECK(selected == models->select(orig_width, orig_height));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s <640 recording> <1280 recording>\n", argv[0]);
+        return 1;
+    }
+    rknn_app_context_t base_ctx;
+    memset(&base_ctx, 0, sizeof(base_ctx));
+    if (init_yolov8_model(argv[1], &base_ctx) != 0)
+    {
+        printf("init %s fail\n", argv[1]);
+        return 1;
+    }
+    ModelRegistry models;
+    TEST_CHECK(models.init(&base_ctx, argv[1]) == 0);
+    TEST_CHECK(models.add(argv[2], NULL) == 1);
+    if (models.size() == 2)
+    {
+        test_select_decoded(&models);
+    }
+    models.deinit();
+    release_yolov8_model(&base_ctx);
+    return TEST_RESULT();
+}
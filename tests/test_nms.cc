@@ -0,0 +1,212 @@
+/**
+ * @file test_nms.cc
+ * @brief nms_sorted（sorted-x sweep + SIMD）与原逐对比较NMS的保留集合逐框相同
+ *
+ * 覆盖随机分布和密集重叠的候选框、按类别和不区分类别两种模式，
+ * 候选数包括不是4的倍数的情况（SIMD每次4个，剩余的走标量尾部）。
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "nms.h"
+#include "test_common.h"
+
+namespace {
+
+// 原实现（nms_sorted之前postprocess.cc中的CalculateOverlap/nms），只作为参考
+float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,
+                       float ymax1)
+{
+    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
+    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
+    float i = w * h;
+    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
+    return u <= 0.f ? 0.f : (i / u);
+}
+
+// filterId < 0时不区分类别
+int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,
+        int filterId, float threshold)
+{
+    for (int i = 0; i < validCount; ++i)
+    {
+        int n = order[i];
+        if (n == -1 || (filterId >= 0 && classIds[n] != filterId))
+        {
+            continue;
+        }
+        for (int j = i + 1; j < validCount; ++j)
+        {
+            int m = order[j];
+            if (m == -1 || (filterId >= 0 && classIds[m] != filterId))
+            {
+                continue;
+            }
+            float xmin0 = outputLocations[n * 4 + 0];
+            float ymin0 = outputLocations[n * 4 + 1];
+            float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
+            float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
+
+            float xmin1 = outputLocations[m * 4 + 0];
+            float ymin1 = outputLocations[m * 4 + 1];
+            float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
+            float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
+
+            float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
+
+            if (iou > threshold)
+            {
+                order[j] = -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// 原流程：候选已按置信度降序，按类别逐个调用nms，返回每个候选是否保留
+std::vector<int> reference_keep(std::vector<float>& locations, const std::vector<int>& cls, float threshold,
+                                nms_mode_t mode)
+{
+    int n = cls.size();
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = i;
+    }
+    if (mode == NMS_PER_CLASS)
+    {
+        std::set<int> class_set(cls.begin(), cls.end());
+        for (auto c : class_set)
+        {
+            nms(n, locations, cls, order, c, threshold);
+        }
+    }
+    else
+    {
+        nms(n, locations, cls, order, -1, threshold);
+    }
+    std::vector<int> keep(n);
+    for (int i = 0; i < n; i++)
+    {
+        keep[i] = order[i] != -1;
+    }
+    return keep;
+}
+
+/**
+ * 生成n个候选框，按置信度降序排列
+ * @param extent 框中心的分布范围，越小越密集
+ * @param max_size 框宽高上限
+ */
+void make_boxes(int n, float extent, float max_size, int class_num, std::vector<float>& locations,
+                std::vector<int>& cls, std::vector<float>& scores)
+{
+    locations.resize((size_t)n * 4);
+    cls.resize(n);
+    scores.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        float w = 1.0f + (rand() % 10000) / 10000.0f * max_size;
+        float h = 1.0f + (rand() % 10000) / 10000.0f * max_size;
+        locations[i * 4 + 0] = (rand() % 100000) / 100000.0f * extent;
+        locations[i * 4 + 1] = (rand() % 100000) / 100000.0f * extent;
+        locations[i * 4 + 2] = w;
+        locations[i * 4 + 3] = h;
+        cls[i] = rand() % class_num;
+        scores[i] = (rand() % 100000) / 100000.0f;
+    }
+    // 按置信度降序重排
+    std::vector<int> idx(n);
+    for (int i = 0; i < n; i++)
+    {
+        idx[i] = i;
+    }
+    std::stable_sort(idx.begin(), idx.end(), [&scores](int a, int b) { return scores[a] > scores[b]; });
+    std::vector<float> l2(locations.size()), s2(n);
+    std::vector<int> c2(n);
+    for (int i = 0; i < n; i++)
+    {
+        std::copy(&locations[idx[i] * 4], &locations[idx[i] * 4] + 4, &l2[i * 4]);
+        c2[i] = cls[idx[i]];
+        s2[i] = scores[idx[i]];
+    }
+    locations.swap(l2);
+    cls.swap(c2);
+    scores.swap(s2);
+}
+
+// 返回保留集合不同的候选数
+int compare_case(int n, float extent, float max_size, int class_num, float threshold, nms_mode_t mode)
+{
+    std::vector<float> locations, scores;
+    std::vector<int> cls;
+    make_boxes(n, extent, max_size, class_num, locations, cls, scores);
+    std::vector<int> expect = reference_keep(locations, cls, threshold, mode);
+
+    NmsBoxes boxes;
+    boxes.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        boxes.x1[i] = locations[i * 4 + 0];
+        boxes.y1[i] = locations[i * 4 + 1];
+        boxes.x2[i] = locations[i * 4 + 0] + locations[i * 4 + 2];
+        boxes.y2[i] = locations[i * 4 + 1] + locations[i * 4 + 3];
+        boxes.score[i] = scores[i];
+        boxes.cls[i] = cls[i];
+    }
+    int kept = nms_sorted(boxes, n, threshold, mode);
+
+    int expect_kept = 0;
+    int mismatched = 0;
+    for (int i = 0; i < n; i++)
+    {
+        expect_kept += expect[i];
+        mismatched += (boxes.keep[i] != 0) != (expect[i] != 0);
+    }
+    TEST_CHECK(kept == expect_kept);
+    return mismatched;
+}
+
+void test_nms_matches_reference()
+{
+    const int counts[] = {1, 2, 3, 4, 5, 7, 13, 64, 101, 257, 1001, 2003};
+    const nms_mode_t modes[] = {NMS_PER_CLASS, NMS_CLASS_AGNOSTIC};
+    const float thresholds[] = {0.3f, 0.45f, 0.7f};
+    for (size_t m = 0; m < 2; m++)
+    {
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+        {
+            for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++)
+            {
+                int n = counts[c];
+                // 随机分布：640x640图像上大小不一的框
+                int random_diff = compare_case(n, 640.0f, 200.0f, 3, thresholds[t], modes[m]);
+                // 密集：所有框挤在80x80的范围内，几乎两两重叠
+                int dense_diff = compare_case(n, 80.0f, 60.0f, 2, thresholds[t], modes[m]);
+                // 单类别、框很小，扫描区间内大多不相交
+                int sparse_diff = compare_case(n, 2000.0f, 20.0f, 1, thresholds[t], modes[m]);
+                if (random_diff || dense_diff || sparse_diff)
+                {
+                    printf("%s n=%d thresh=%.2f: mismatched random %d, dense %d, sparse %d\n",
+                           modes[m] == NMS_PER_CLASS ? "per-class" : "agnostic", n, thresholds[t], random_diff,
+                           dense_diff, sparse_diff);
+                }
+                TEST_CHECK(random_diff == 0 && dense_diff == 0 && sparse_diff == 0);
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    srand(1);
+    test_nms_matches_reference();
+    return TEST_RESULT();
+}
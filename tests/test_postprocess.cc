@@ -0,0 +1,395 @@
+/**
+ * @file test_postprocess.cc
+ * @brief 后处理解码的正确性：量化域DFL（查表）与浮点DFL对比，误差换算成像素后断言上界；
+ *        候选数超过NMS前Top-K时的截断与计数；uint8与int8量化输出的检测结果一致；标签文件行数与类别数的检查
+ *
+ * DFL解码函数是postprocess.cc内部的static函数，这里直接包含源文件测试，
+ * 因此本测试不再链接postprocess.cc。
+ */
+
+#include "../src/postprocess.cc"
+
+#include <unistd.h>
+
+#include <string>
+
+#include "test_common.h"
+
+namespace {
+
+// 原浮点实现（量化域解码之前的compute_dfl）：先反量化到连续的4*dfl_len个logits，逐bin求exp
+void compute_dfl_reference(const float* tensor, int dfl_len, float* box)
+{
+    for (int b = 0; b < 4; b++)
+    {
+        float exp_t[DFL_MAX_LEN];
+        float exp_sum = 0;
+        float acc_sum = 0;
+        for (int i = 0; i < dfl_len; i++)
+        {
+            exp_t[i] = exp(tensor[i + b * dfl_len]);
+            exp_sum += exp_t[i];
+        }
+        for (int i = 0; i < dfl_len; i++)
+        {
+            acc_sum += exp_t[i] / exp_sum * i;
+        }
+        box[b] = acc_sum;
+    }
+}
+
+// 浮点路径的输入：反量化后的logits
+template <typename T>
+void dequantize(const std::vector<T>& q, int32_t zp, float scale, std::vector<float>& f)
+{
+    f.resize(q.size());
+    for (size_t i = 0; i < q.size(); i++)
+    {
+        f[i] = ((float)q[i] - (float)zp) * scale;
+    }
+}
+
+/**
+ * 随机logits分别走量化域DFL、当前浮点DFL和原浮点实现，返回量化域结果与两者期望值的最大差（单位：bin）
+ * 数据按NCHW排列，同一bin在相邻通道间相隔grid_len，与模型输出一致
+ */
+template <typename T>
+float max_dfl_error(int32_t zp, float scale, int dfl_len, int grid_len, int q_min, int q_max, int trials)
+{
+    std::vector<T> q((size_t)4 * dfl_len * grid_len);
+    std::vector<float> f;
+    const float* exp_lut = get_dfl_exp_lut(scale);
+    float max_err = 0;
+    for (int t = 0; t < trials; t++)
+    {
+        for (size_t i = 0; i < q.size(); i++)
+        {
+            q[i] = (T)(q_min + rand() % (q_max - q_min + 1));
+        }
+        dequantize(q, zp, scale, f);
+        for (int cell = 0; cell < grid_len; cell++)
+        {
+            float box_q[4], box_f[4], box_ref[4];
+            float logits[4 * DFL_MAX_LEN];
+            for (int i = 0; i < 4 * dfl_len; i++)
+            {
+                logits[i] = f[(size_t)i * grid_len + cell];
+            }
+            compute_dfl_quant(q.data() + cell, grid_len, dfl_len, exp_lut, box_q);
+            compute_dfl(f.data() + cell, grid_len, dfl_len, box_f);
+            compute_dfl_reference(logits, dfl_len, box_ref);
+            for (int b = 0; b < 4; b++)
+            {
+                max_err = std::max(max_err, fabsf(box_q[b] - box_f[b]));
+                max_err = std::max(max_err, fabsf(box_q[b] - box_ref[b]));
+            }
+        }
+    }
+    return max_err;
+}
+
+// 一个bin对应stride个输入像素，最大步长为32
+const float kMaxStride = 32.0f;
+// 量化域与浮点路径只差在exp的求值方式和求和顺序，换算到输入图像后误差远小于1像素
+const float kMaxDflErrorPixels = 0.01f;
+
+void test_dfl_quant_vs_float()
+{
+    struct Case {
+        bool is_unsigned;
+        int32_t zp;
+        float scale;
+        int dfl_len;
+        int q_min, q_max;
+    };
+    const Case cases[] = {
+        {false, 0, 0.05f, 16, -128, 127},       // 与板端模型相近的box量化参数
+        {false, -20, 0.11f, 16, -128, 127},
+        {false, 7, 0.02f, 16, -128, 127},
+        {false, -128, 0.25f, 16, -128, 127},    // 分布尖锐，大多数bin的权重接近0
+        {false, 0, 0.05f, 16, 60, 70},          // 分布平坦
+        {false, 0, 0.08f, 7, -128, 127},        // dfl_len不是4的倍数，覆盖向量化的尾部
+        {true, 128, 0.05f, 16, 0, 255},
+        {true, 3, 0.15f, 16, 0, 255},
+        {true, 200, 0.03f, 10, 0, 255},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const Case& c = cases[i];
+        float err_bins = c.is_unsigned ? max_dfl_error<uint8_t>(c.zp, c.scale, c.dfl_len, 5, c.q_min, c.q_max, 2000)
+                                       : max_dfl_error<int8_t>(c.zp, c.scale, c.dfl_len, 5, c.q_min, c.q_max, 2000);
+        float err_pixels = err_bins * kMaxStride;
+        printf("dfl case %zu (%s zp=%d scale=%.3f len=%d): max error %.3g bins, %.3g pixels at stride 32\n", i,
+               c.is_unsigned ? "u8" : "i8", c.zp, c.scale, c.dfl_len, err_bins, err_pixels);
+        TEST_CHECK(err_pixels < kMaxDflErrorPixels);
+    }
+}
+
+// 640x640单类别float模型，每分支2个输出（box/score）；只有stride 8分支的每个网格单元都有目标，
+// 分数互不相同，DFL分布集中在第0个bin，框远小于网格间距，NMS不会抑制任何框
+struct ManyCandidatesModel {
+    static const int kSize = 640;
+    static const int kDflLen = 16;
+    static const int kCells = (kSize / 8) * (kSize / 8);
+
+    rknn_tensor_attr attrs[6];
+    std::vector<float> tensors[6];
+    rknn_output outputs[6];
+    rknn_app_context_t app_ctx;
+
+    ManyCandidatesModel()
+    {
+        memset(attrs, 0, sizeof(attrs));
+        memset(outputs, 0, sizeof(outputs));
+        memset(&app_ctx, 0, sizeof(app_ctx));
+        for (int b = 0; b < 3; b++)
+        {
+            int grid = kSize / (8 << b);
+            int grid_len = grid * grid;
+            for (int k = 0; k < 2; k++)
+            {
+                rknn_tensor_attr& attr = attrs[b * 2 + k];
+                attr.n_dims = 4;
+                attr.dims[0] = 1;
+                attr.dims[1] = k == 0 ? 4 * kDflLen : 1;
+                attr.dims[2] = grid;
+                attr.dims[3] = grid;
+                tensors[b * 2 + k].assign((size_t)attr.dims[1] * grid_len, 0.0f);
+                outputs[b * 2 + k].buf = tensors[b * 2 + k].data();
+            }
+            for (int c = 0; c < 4; c++)
+            {
+                for (int cell = 0; cell < grid_len; cell++)
+                {
+                    tensors[b * 2][(size_t)c * kDflLen * grid_len + cell] = 10.0f;
+                }
+            }
+        }
+        // 分数0.3 ~ 0.9，下标越大分数越高
+        for (int cell = 0; cell < kCells; cell++)
+        {
+            tensors[1][cell] = 0.3f + 0.6f * cell / kCells;
+        }
+        app_ctx.io_num.n_output = 6;
+        app_ctx.output_attrs = attrs;
+        app_ctx.model_width = kSize;
+        app_ctx.model_height = kSize;
+        app_ctx.is_quant = false;
+    }
+};
+
+// NMS前Top-K：个数取max(NMS_PRE_TOPK, 结果上限)，丢弃的候选记入pre_nms_dropped，NMS后的截断记入truncated
+void test_pre_nms_top_k()
+{
+    ManyCandidatesModel model;
+    TEST_CHECK(init_post_process(&model.app_ctx, NULL) == 0);
+    letterbox_t letter_box;
+    memset(&letter_box, 0, sizeof(letter_box));
+    letter_box.scale = 1.0f;
+    const int cells = ManyCandidatesModel::kCells;
+
+    struct Case {
+        int max_count;
+        int expect_count;
+        int expect_truncated;
+        int expect_dropped;
+    };
+    const Case cases[] = {
+        {0, NMS_PRE_TOPK, 0, cells - NMS_PRE_TOPK},             // 全局默认上限
+        {100, 100, NMS_PRE_TOPK - 100, cells - NMS_PRE_TOPK},   // 结果上限小于Top-K：NMS后截断
+        {3000, 3000, 0, cells - 3000},                          // 结果上限大于Top-K：候选数跟随结果上限
+        {cells, cells, 0, 0},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const Case& c = cases[i];
+        object_detect_result_list od_results;
+        init_detect_result_list(&od_results, c.max_count);
+        int ret = post_process(&model.app_ctx, model.outputs, &letter_box, BOX_THRESH, NMS_THRESH, &od_results);
+        printf("top-k case %zu (max_count=%d): count %d, truncated %d, pre_nms_dropped %d\n", i, c.max_count,
+               od_results.count, od_results.truncated, od_results.pre_nms_dropped);
+        TEST_CHECK(ret == 0);
+        TEST_CHECK(od_results.count == c.expect_count);
+        TEST_CHECK(od_results.truncated == c.expect_truncated);
+        TEST_CHECK(od_results.pre_nms_dropped == c.expect_dropped);
+        // 保留的是分数最高的候选，按分数从高到低排列
+        float min_kept = 0.3f + 0.6f * (cells - c.expect_count) / cells;
+        for (int k = 0; k < od_results.count; k++)
+        {
+            TEST_CHECK(od_results.results[k].prop >= min_kept - 1e-6f);
+            TEST_CHECK(k == 0 || od_results.results[k].prop <= od_results.results[k - 1].prop);
+        }
+        free_detect_result_list(&od_results);
+    }
+}
+
+// 640x640的3类别int8量化模型，每分支3个输出（box/score/score_sum），数据与yolov8_record_gen相同的方式随机生成；
+// to_u8()把它转换成等价的uint8模型：每个值加128，零点加128
+struct QuantModel {
+    static const int kSize = 640;
+    static const int kDflLen = 16;
+    static const int kClasses = 3;
+
+    rknn_tensor_attr attrs[9];
+    std::vector<uint8_t> tensors[9];
+    rknn_output outputs[9];
+    rknn_app_context_t app_ctx;
+
+    QuantModel()
+    {
+        memset(attrs, 0, sizeof(attrs));
+        memset(outputs, 0, sizeof(outputs));
+        memset(&app_ctx, 0, sizeof(app_ctx));
+        for (int b = 0; b < 3; b++)
+        {
+            int grid = kSize / (8 << b);
+            int grid_len = grid * grid;
+            const int channels[3] = {4 * kDflLen, kClasses, 1};
+            for (int k = 0; k < 3; k++)
+            {
+                rknn_tensor_attr& attr = attrs[b * 3 + k];
+                attr.n_dims = 4;
+                attr.dims[0] = 1;
+                attr.dims[1] = channels[k];
+                attr.dims[2] = grid;
+                attr.dims[3] = grid;
+                attr.type = RKNN_TENSOR_INT8;
+                attr.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+                attr.zp = k == 0 ? 0 : -128;
+                attr.scale = k == 0 ? 0.05f : 1.0f / 255;
+                tensors[b * 3 + k].assign((size_t)channels[k] * grid_len, (uint8_t)(int8_t)(k == 0 ? 0 : -128));
+                outputs[b * 3 + k].buf = tensors[b * 3 + k].data();
+            }
+            std::vector<uint8_t>& box = tensors[b * 3];
+            std::vector<uint8_t>& score = tensors[b * 3 + 1];
+            std::vector<uint8_t>& score_sum = tensors[b * 3 + 2];
+            for (size_t i = 0; i < box.size(); i++)
+            {
+                box[i] = (uint8_t)(rand() % 100);
+            }
+            for (int cell = 0; cell < grid_len; cell++)
+            {
+                if (rand() % 20 != 0)
+                {
+                    continue;
+                }
+                int sum = 0;
+                for (int c = 0; c < kClasses; c++)
+                {
+                    int q = rand() % 256;
+                    score[(size_t)c * grid_len + cell] = (uint8_t)(int8_t)(q - 128);
+                    sum += q;
+                }
+                score_sum[cell] = (uint8_t)(int8_t)(std::min(sum, 255) - 128);
+            }
+        }
+        app_ctx.io_num.n_output = 9;
+        app_ctx.output_attrs = attrs;
+        app_ctx.model_width = kSize;
+        app_ctx.model_height = kSize;
+        app_ctx.is_quant = true;
+    }
+
+    void to_u8()
+    {
+        for (int i = 0; i < 9; i++)
+        {
+            attrs[i].type = RKNN_TENSOR_UINT8;
+            attrs[i].zp += 128;
+            for (size_t k = 0; k < tensors[i].size(); k++)
+            {
+                tensors[i][k] = (uint8_t)((int8_t)tensors[i][k] + 128);
+            }
+        }
+    }
+};
+
+// uint8量化输出走process_u8，与等价的int8输出检测结果相同
+void test_u8_matches_i8()
+{
+    QuantModel model;
+    TEST_CHECK(init_post_process(&model.app_ctx, NULL) == 0);
+    letterbox_t letter_box;
+    memset(&letter_box, 0, sizeof(letter_box));
+    letter_box.scale = 1.0f;
+
+    object_detect_result_list i8_results;
+    object_detect_result_list u8_results;
+    init_detect_result_list(&i8_results, 0);
+    init_detect_result_list(&u8_results, 0);
+    TEST_CHECK(post_process(&model.app_ctx, model.outputs, &letter_box, BOX_THRESH, NMS_THRESH, &i8_results) == 0);
+    model.to_u8();
+    TEST_CHECK(post_process(&model.app_ctx, model.outputs, &letter_box, BOX_THRESH, NMS_THRESH, &u8_results) == 0);
+
+    printf("quantized outputs: int8 %d detections, uint8 %d detections\n", i8_results.count, u8_results.count);
+    TEST_CHECK(i8_results.count > 0);
+    TEST_CHECK(u8_results.count == i8_results.count);
+    for (int i = 0; i < i8_results.count && i < u8_results.count; i++)
+    {
+        const object_detect_result& a = i8_results.results[i];
+        const object_detect_result& b = u8_results.results[i];
+        TEST_CHECK(a.cls_id == b.cls_id && a.prop == b.prop);
+        TEST_CHECK(a.box.left == b.box.left && a.box.top == b.box.top && a.box.right == b.box.right &&
+                   a.box.bottom == b.box.bottom);
+    }
+    free_detect_result_list(&i8_results);
+    free_detect_result_list(&u8_results);
+}
+
+// 写入lines行的标签文件，返回路径
+std::string write_label_file(int lines)
+{
+    char path[] = "/tmp/test_labels_XXXXXX";
+    int fd = mkstemp(path);
+    FILE* fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    for (int i = 0; fp != NULL && i < lines; i++)
+    {
+        fprintf(fp, "class%d\n", i);
+    }
+    if (fp != NULL)
+    {
+        fclose(fp);
+    }
+    return path;
+}
+
+// 类别数在init_post_process中取自模型，行数与类别数不一致的标签文件被拒绝
+void test_label_count_checked()
+{
+    QuantModel model;
+    std::string matching = write_label_file(QuantModel::kClasses);
+    std::string too_few = write_label_file(QuantModel::kClasses - 1);
+    std::string too_many = write_label_file(QuantModel::kClasses + 1);
+
+    TEST_CHECK(init_post_process(&model.app_ctx, too_few.c_str()) != 0);
+    TEST_CHECK(init_post_process(&model.app_ctx, too_many.c_str()) != 0);
+    TEST_CHECK(init_post_process(&model.app_ctx, matching.c_str()) == 0);
+    TEST_CHECK(strcmp(coco_cls_to_name(QuantModel::kClasses - 1), "class2") == 0);
+    TEST_CHECK(strcmp(coco_cls_to_name(QuantModel::kClasses), "unknown") == 0);
+
+    // 未初始化时post_process报错，而不是按未知的类别数解码
+    deinit_post_process();
+    letterbox_t letter_box;
+    memset(&letter_box, 0, sizeof(letter_box));
+    letter_box.scale = 1.0f;
+    object_detect_result_list od_results;
+    init_detect_result_list(&od_results, 0);
+    TEST_CHECK(post_process(&model.app_ctx, model.outputs, &letter_box, BOX_THRESH, NMS_THRESH, &od_results) != 0);
+    free_detect_result_list(&od_results);
+
+    unlink(matching.c_str());
+    unlink(too_few.c_str());
+    unlink(too_many.c_str());
+}
+
+} // namespace
+
+int main()
+{
+    srand(1);
+    test_dfl_quant_vs_float();
+    test_pre_nms_top_k();
+    test_u8_matches_i8();
+    test_label_count_checked();
+    return TEST_RESULT();
+}
@@ -0,0 +1,178 @@
+/**
+ * @file test_rknn_pool.cc
+ * @brief RknnContextPool在rknn_stub上的调度：多个线程通过inference()推理时，N个上下文让N个模拟NPU核心都保持忙碌；
+ *        动态形状模型按帧切换档位时，池中的上下文不改动基础上下文的属性
+ *
+ * 推理耗时和核心数取自RKNN_STUB_RUN_US / RKNN_STUB_NPU_CORES（ctest中设置）。
+ * 用法：test_rknn_pool <录制文件>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "rknn_pool.h"
+#include "image_utils.h"
+#include "log_utils.h"
+#include "test_common.h"
+
+namespace {
+
+int64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TestImage {
+    std::vector<unsigned char> data;
+    image_buffer_t img;
+
+    TestImage(int width, int height)
+    {
+        memset(&img, 0, sizeof(img));
+        img.width = width;
+        img.height = height;
+        img.format = IMAGE_FORMAT_RGB888;
+        img.size = get_image_size(&img);
+        data.assign(img.size, 100);
+        img.virt_addr = data.data();
+    }
+};
+
+// 每个线程推理frames帧，返回全部完成的耗时（微秒）
+int64_t run_threads(RknnContextPool* pool, image_buffer_t* img, int threads, int frames, int* failures)
+{
+    *failures = 0;
+    std::vector<int> thread_failures(threads, 0);
+    std::vector<std::thread> workers;
+    int64_t start = now_us();
+    for (int t = 0; t < threads; t++)
+    {
+        workers.push_back(std::thread([pool, img, frames, t, &thread_failures]() {
+            object_detect_result_list results;
+            init_detect_result_list(&results, 0);
+            for (int f = 0; f < frames; f++)
+            {
+                if (pool->inference(img, &results) != 0)
+                {
+                    thread_failures[t]++;
+                }
+            }
+            free_detect_result_list(&results);
+        }));
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+        *failures += thread_failures[t];
+    }
+    return now_us() - start;
+}
+
+/**
+ * 推理线程数是上下文数的2倍，NPU成为瓶颈：N个上下文分别绑定N个核心时，
+ * 总耗时应接近 帧数 * 单帧耗时 / N，而不是串行的 帧数 * 单帧耗时
+ */
+void test_keeps_cores_busy(const char* model_path, int run_us, int cores)
+{
+    rknn_app_context_t base;
+    memset(&base, 0, sizeof(base));
+    TEST_CHECK(init_yolov8_model(model_path, &base) == 0);
+    TEST_CHECK(init_post_process(&base, NULL) == 0);
+    TestImage image(base.model_width, base.model_height);
+
+    for (int contexts = 1; contexts <= cores; contexts++)
+    {
+        RknnContextPool pool;
+        // 最空闲优先：任何一个上下文空闲时都能立即分配（轮询在目标上下文忙时会等待）
+        TEST_CHECK(pool.init(&base, contexts, POOL_SCHEDULE_LEAST_LOADED) == 0);
+        TEST_CHECK(pool.size() == contexts);
+        const int frames_per_thread = 2;
+        int threads = contexts * 2;
+        int total = threads * frames_per_thread;
+        int failures = 0;
+        int64_t elapsed = run_threads(&pool, &image.img, threads, frames_per_thread, &failures);
+        int64_t ideal = (int64_t)total * run_us / contexts;
+        printf("%d contexts on %d cores: %d frames in %.1f ms, ideal %.1f ms (%.2fx)\n", contexts, cores, total,
+               elapsed / 1000.0, ideal / 1000.0, (double)elapsed / ideal);
+        pool.print_stats();
+        TEST_CHECK(failures == 0);
+        // 下限：模拟的NPU耗时确实生效；上限：留出CPU前后处理和线程调度的余量
+        TEST_CHECK(elapsed >= ideal * 95 / 100);
+        TEST_CHECK(elapsed <= ideal * 130 / 100);
+    }
+    release_yolov8_model(&base);
+}
+
+/**
+ * 动态形状：16:9的帧让池中的上下文切换到640x384档位，基础上下文的属性和档位保持不变
+ */
+void test_base_ctx_untouched(const char* model_path)
+{
+    setenv("RKNN_STUB_INPUT_SHAPES", "640x640,640x384", 1);
+    rknn_app_context_t base;
+    memset(&base, 0, sizeof(base));
+    int ret = init_yolov8_model(model_path, &base);
+    unsetenv("RKNN_STUB_INPUT_SHAPES");
+    TEST_CHECK(ret == 0);
+    TEST_CHECK(ret != 0 || init_post_process(&base, NULL) == 0);
+    TEST_CHECK(base.shape_num == 2);
+    if (ret != 0 || base.shape_num != 2)
+    {
+        return;
+    }
+    int base_index = base.shape_index;
+    std::vector<rknn_tensor_attr> input_attrs(base.input_attrs, base.input_attrs + base.io_num.n_input);
+    std::vector<rknn_tensor_attr> output_attrs(base.output_attrs, base.output_attrs + base.io_num.n_output);
+
+    RknnContextPool pool;
+    TEST_CHECK(pool.init(&base, 3, POOL_SCHEDULE_LEAST_LOADED) == 0);
+    TestImage wide(1280, 720);
+    int failures = 0;
+    run_threads(&pool, &wide.img, 3, 2, &failures);
+    TEST_CHECK(failures == 0);
+
+    // 池中的上下文已经切换到640x384
+    rknn_app_context_t* slot = pool.acquire();
+    TEST_CHECK(slot != NULL && slot->model_height == 384);
+    TEST_CHECK(slot != NULL && slot->input_attrs != base.input_attrs && slot->output_attrs != base.output_attrs);
+    pool.release(slot);
+
+    TEST_CHECK(base.shape_index == base_index);
+    TEST_CHECK(memcmp(base.input_attrs, input_attrs.data(), sizeof(rknn_tensor_attr) * input_attrs.size()) == 0);
+    TEST_CHECK(memcmp(base.output_attrs, output_attrs.data(), sizeof(rknn_tensor_attr) * output_attrs.size()) == 0);
+
+    pool.deinit();
+    release_yolov8_model(&base);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <recording>\n", argv[0]);
+        return -1;
+    }
+    const char* run_env = getenv("RKNN_STUB_RUN_US");
+    const char* cores_env = getenv("RKNN_STUB_NPU_CORES");
+    int run_us = run_env != NULL ? atoi(run_env) : 0;
+    int cores = cores_env != NULL ? atoi(cores_env) : 3;
+    if (run_us <= 0 || cores <= 0)
+    {
+        printf("set RKNN_STUB_RUN_US and RKNN_STUB_NPU_CORES\n");
+        return -1;
+    }
+    log_set_level(LOG_LEVEL_WARN);
+
+    test_keeps_cores_busy(argv[1], run_us, cores);
+    test_base_ctx_untouched(argv[1]);
+
+    deinit_post_process();
+    return TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+/**
+ * @file test_rknn_stub.cc
+ * @brief rknn_stub回放yolov8_record_gen生成的录制：属性查询、逐帧循环回放、want_float反量化、
+ *        rknn_set_io_mem零拷贝输出、rknn_dup_context独立计帧
+ *
+ * 用法：test_rknn_stub <录制文件>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "rknn_api.h"
+#include "rknn_record.h"
+#include "test_common.h"
+
+namespace {
+
+// 按回放顺序取第frame帧的全部输出（非预分配），与录制数据逐字节比较
+void check_outputs_get(rknn_context ctx, const RknnRecording& rec, size_t frame)
+{
+    uint32_t n_output = rec.io_num.n_output;
+    std::vector<rknn_output> outputs(n_output);
+    memset(outputs.data(), 0, sizeof(rknn_output) * n_output);
+    for (uint32_t i = 0; i < n_output; i++)
+    {
+        outputs[i].index = i;
+    }
+    TEST_CHECK(rknn_outputs_get(ctx, n_output, outputs.data(), NULL) == RKNN_SUCC);
+    for (uint32_t i = 0; i < n_output; i++)
+    {
+        const std::vector<uint8_t>& data = rec.frames[frame % rec.frames.size()][i];
+        TEST_CHECK(outputs[i].size == data.size());
+        TEST_CHECK(outputs[i].buf != NULL && memcmp(outputs[i].buf, data.data(), data.size()) == 0);
+    }
+    rknn_outputs_release(ctx, n_output, outputs.data());
+}
+
+void set_dummy_input(rknn_context ctx, std::vector<uint8_t>& input)
+{
+    rknn_input in;
+    memset(&in, 0, sizeof(in));
+    in.index = 0;
+    in.type = RKNN_TENSOR_UINT8;
+    in.fmt = RKNN_TENSOR_NHWC;
+    in.size = input.size();
+    in.buf = input.data();
+    TEST_CHECK(rknn_inputs_set(ctx, 1, &in) == RKNN_SUCC);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <recording>\n", argv[0]);
+        return -1;
+    }
+    RknnRecording rec;
+    if (load_rknn_recording(argv[1], &rec) != 0 || rec.frames.size() < 2)
+    {
+        printf("cannot load %s\n", argv[1]);
+        return -1;
+    }
+
+    // 模型参数直接传录制文件路径（size为0）
+    rknn_context ctx = 0;
+    TEST_CHECK(rknn_init(&ctx, argv[1], 0, 0, NULL) == RKNN_SUCC);
+
+    rknn_input_output_num io_num;
+    TEST_CHECK(rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num)) == RKNN_SUCC);
+    TEST_CHECK(io_num.n_input == rec.io_num.n_input && io_num.n_output == rec.io_num.n_output);
+    for (uint32_t i = 0; i < io_num.n_output; i++)
+    {
+        rknn_tensor_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        TEST_CHECK(rknn_query(ctx, RKNN_QUERY_OUTPUT_ATTR, &attr, sizeof(attr)) == RKNN_SUCC);
+        TEST_CHECK(attr.n_elems == rec.output_attrs[i].n_elems && attr.zp == rec.output_attrs[i].zp);
+    }
+
+    // 没有设置输入时不能推理
+    TEST_CHECK(rknn_run(ctx, NULL) != RKNN_SUCC);
+
+    // 每次推理按顺序取下一帧，帧数用完后循环
+    std::vector<uint8_t> input(rec.input_attrs[0].size);
+    set_dummy_input(ctx, input);
+    for (size_t run = 0; run < rec.frames.size() + 2; run++)
+    {
+        TEST_CHECK(rknn_run(ctx, NULL) == RKNN_SUCC);
+        check_outputs_get(ctx, rec, run);
+    }
+
+    // want_float：(q - zp) * scale
+    {
+        rknn_context dup = 0;
+        TEST_CHECK(rknn_dup_context(&ctx, &dup) == RKNN_SUCC);
+        set_dummy_input(dup, input);
+        TEST_CHECK(rknn_run(dup, NULL) == RKNN_SUCC);
+        const rknn_tensor_attr& attr = rec.output_attrs[1];
+        rknn_output out;
+        memset(&out, 0, sizeof(out));
+        out.index = 1;
+        out.want_float = 1;
+        TEST_CHECK(rknn_outputs_get(dup, 1, &out, NULL) == RKNN_SUCC);
+        TEST_CHECK(out.size == attr.n_elems * sizeof(float));
+        // 复制出的上下文从第0帧开始，不受原上下文影响
+        const std::vector<uint8_t>& data = rec.frames[0][1];
+        int mismatched = 0;
+        for (uint32_t i = 0; i < attr.n_elems && out.buf != NULL; i++)
+        {
+            float expect = ((int)(int8_t)data[i] - attr.zp) * attr.scale;
+            mismatched += ((float*)out.buf)[i] != expect;
+        }
+        TEST_CHECK(mismatched == 0);
+        rknn_outputs_release(dup, 1, &out);
+        rknn_destroy(dup);
+    }
+
+    // 零拷贝：rknn_set_io_mem绑定的输出在rknn_run时写入
+    {
+        rknn_context zc = 0;
+        TEST_CHECK(rknn_init(&zc, argv[1], 0, 0, NULL) == RKNN_SUCC);
+        rknn_tensor_attr in_attr = rec.input_attrs[0];
+        rknn_tensor_mem* in_mem = rknn_create_mem(zc, in_attr.size);
+        TEST_CHECK(rknn_set_io_mem(zc, in_mem, &in_attr) == RKNN_SUCC);
+        std::vector<rknn_tensor_mem*> out_mems(rec.io_num.n_output);
+        for (uint32_t i = 0; i < rec.io_num.n_output; i++)
+        {
+            rknn_tensor_attr attr = rec.output_attrs[i];
+            out_mems[i] = rknn_create_mem(zc, attr.size);
+            TEST_CHECK(rknn_set_io_mem(zc, out_mems[i], &attr) == RKNN_SUCC);
+        }
+        for (size_t run = 0; run < 2; run++)
+        {
+            TEST_CHECK(rknn_run(zc, NULL) == RKNN_SUCC);
+            for (uint32_t i = 0; i < rec.io_num.n_output; i++)
+            {
+                const std::vector<uint8_t>& data = rec.frames[run][i];
+                TEST_CHECK(memcmp(out_mems[i]->virt_addr, data.data(), data.size()) == 0);
+            }
+        }
+        for (uint32_t i = 0; i < rec.io_num.n_output; i++)
+        {
+            rknn_destroy_mem(zc, out_mems[i]);
+        }
+        rknn_destroy_mem(zc, in_mem);
+        rknn_destroy(zc);
+    }
+
+    rknn_destroy(ctx);
+    return TEST_RESULT();
+}
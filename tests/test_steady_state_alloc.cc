@@ -0,0 +1,136 @@
+/**
+ * @file test_steady_state_alloc.cc
+ * @brief 稳态推理不分配内存：预热后重复调用inference_yolov8_model，统计malloc/calloc/realloc次数必须为0，
+ *        拷贝和零拷贝两种IO模式分别检查
+ *
+ * 本文件定义的malloc等函数覆盖libc的同名符号（operator new也经由malloc），计数后转给__libc_*实现。
+ * 用法：test_steady_state_alloc <录制文件>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "yolov8.h"
+#include "image_utils.h"
+#include "log_utils.h"
+#include "test_common.h"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+}
+
+static volatile bool g_count_allocs = false;
+static volatile int g_alloc_count = 0;
+
+extern "C" void* malloc(size_t size)
+{
+    if (g_count_allocs)
+    {
+        __sync_fetch_and_add(&g_alloc_count, 1);
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+    if (g_count_allocs)
+    {
+        __sync_fetch_and_add(&g_alloc_count, 1);
+    }
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    if (g_count_allocs)
+    {
+        __sync_fetch_and_add(&g_alloc_count, 1);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+namespace {
+
+const int kWarmupRuns = 3;
+const int kMeasuredRuns = 20;
+
+// 返回稳态调用中的分配次数，初始化或推理失败返回-1
+int count_steady_state_allocs(const char* model_path, yolov8_io_mode_t io_mode, image_buffer_t* img)
+{
+    rknn_app_context_t app_ctx;
+    memset(&app_ctx, 0, sizeof(app_ctx));
+    yolov8_init_options_t opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.io_mode = io_mode;
+    if (init_yolov8_model_ex(model_path, &app_ctx, &opts) != 0 || init_post_process(&app_ctx, NULL) != 0)
+    {
+        return -1;
+    }
+    object_detect_result_list results;
+    init_detect_result_list(&results, 0);
+
+    int ret = 0;
+    for (int i = 0; i < kWarmupRuns && ret == 0; i++)
+    {
+        ret = inference_yolov8_model(&app_ctx, img, &results);
+    }
+    int detected = results.count;
+
+    g_alloc_count = 0;
+    g_count_allocs = true;
+    for (int i = 0; i < kMeasuredRuns && ret == 0; i++)
+    {
+        ret = inference_yolov8_model(&app_ctx, img, &results);
+    }
+    g_count_allocs = false;
+    int allocs = g_alloc_count;
+
+    printf("%s: %d detections, %d allocations in %d runs\n", io_mode == YOLOV8_IO_ZERO_COPY ? "zero-copy" : "copy",
+           detected, allocs, kMeasuredRuns);
+    // 合成录制的每帧都有检测结果，否则结果缓冲区的复用没有被覆盖到
+    TEST_CHECK(detected > 0);
+    free_detect_result_list(&results);
+    release_yolov8_model(&app_ctx);
+    return ret == 0 ? allocs : -1;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <recording>\n", argv[0]);
+        return -1;
+    }
+    log_set_level(LOG_LEVEL_WARN);
+
+    // 确认计数生效：覆盖没有链接上时后面的检查没有意义
+    g_alloc_count = 0;
+    g_count_allocs = true;
+    free(malloc(16));
+    g_count_allocs = false;
+    TEST_CHECK(g_alloc_count == 1);
+
+    // 非模型尺寸的帧，走完整的letterbox缩放
+    image_buffer_t img;
+    memset(&img, 0, sizeof(img));
+    img.width = 1280;
+    img.height = 720;
+    img.format = IMAGE_FORMAT_RGB888;
+    img.size = get_image_size(&img);
+    img.virt_addr = (unsigned char*)malloc(img.size);
+    for (int i = 0; i < img.size; i++)
+    {
+        img.virt_addr[i] = (unsigned char)(i * 7);
+    }
+
+    TEST_CHECK(count_steady_state_allocs(argv[1], YOLOV8_IO_COPY, &img) == 0);
+    TEST_CHECK(count_steady_state_allocs(argv[1], YOLOV8_IO_ZERO_COPY, &img) == 0);
+
+    free(img.virt_addr);
+    deinit_post_process();
+    return TEST_RESULT();
+}
@@ -0,0 +1,867 @@
+/**
+ * @file yolov8_bench.cc
+ * @brief 检测流程基准测试：解码、letterbox、推理、后处理各阶段单独计时及端到端计时，输出JSON/CSV
+ *
+ * 图像文件只读取一次到内存，计时不包含磁盘IO。推理阶段有两种来源：
+ * - 板端（链接了librknnrt）：真实调用rknn，可用--record把每张图的输出录制到文件
+ * - 主机：--replay回放录制文件中的输出，推理阶段只是一次内存拷贝，
+ *   后处理处理的是真实模型输出，因此前后处理的性能回退可以在x86的CI上发现
+ * --async=N在真实推理时额外测量异步推理（AsyncInferencer，N帧在途）的端到端吞吐，样本为相邻两帧完成的间隔。
+ * --sweep额外运行合成数据的规模扫描：NMS候选数和后处理（预筛选+DFL+Top-K+NMS）候选数从100到50000。
+ * --scaling额外测量合成1080p/4K的RGB和NV12帧letterbox到模型输入时，并行缩放从1到4个线程的耗时。
+ */
+
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "yolov8.h"
+#include "async_infer.h"
+#include "image_utils.h"
+#include "file_utils.h"
+#include "nms.h"
+#include "perf_stats.h"
+#include "rknn_record.h"
+#include "stb_image.h"
+
+namespace {
+
+struct BenchOptions {
+    std::string image_dir;
+    std::string model_path;
+    std::string model_load;     // 模型加载方式，见parse_yolov8_model_load
+    std::string record_path;
+    std::string replay_path;
+    std::string out_path;
+    bool csv;
+    bool sweep;
+    int warmup;
+    int iters;
+    int async_depth;    // >0时测量异步推理的端到端吞吐（需要真实推理）
+    int preprocess_threads;     // 各阶段letterbox使用的线程数，见set_image_convert_threads
+    std::vector<int> preprocess_cpus;   // 并行缩放工作线程绑定的CPU
+    bool scaling;
+};
+
+struct BenchImage {
+    std::string path;
+    std::vector<unsigned char> encoded;     // 文件原始内容，解码阶段从内存解码
+    image_buffer_t rgb;                     // 解码结果，后续阶段的输入
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<double> samples_us;
+};
+
+/**
+ * @brief 推理来源：真实rknn或回放录制的输出
+ */
+struct BenchModel {
+    rknn_app_context_t app_ctx;
+    bool real;                          // true: 真实推理；false: 回放
+    RknnRecording rec;
+    std::vector<rknn_output> replay_outputs;
+    rknn_output* outputs;
+};
+
+bool has_image_extension(const std::string& name)
+{
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos)
+    {
+        return false;
+    }
+    const char* ext = name.c_str() + dot;
+    return strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 || strcasecmp(ext, ".png") == 0;
+}
+
+int load_images(const std::string& dir_path, std::vector<BenchImage>& images)
+{
+    DIR* dir = opendir(dir_path.c_str());
+    if (dir == NULL)
+    {
+        printf("Error: Cannot open image folder %s\n", dir_path.c_str());
+        return -1;
+    }
+    std::vector<std::string> names;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (has_image_extension(entry->d_name))
+        {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        BenchImage image;
+        image.path = dir_path + "/" + names[i];
+        char* data = NULL;
+        int len = read_data_from_file(image.path.c_str(), &data);
+        if (len <= 0 || data == NULL)
+        {
+            printf("Warning: skip unreadable image %s\n", image.path.c_str());
+            free(data);
+            continue;
+        }
+        image.encoded.assign((unsigned char*)data, (unsigned char*)data + len);
+        free(data);
+
+        memset(&image.rgb, 0, sizeof(image_buffer_t));
+        int w = 0, h = 0, c = 0;
+        unsigned char* pixels = stbi_load_from_memory(image.encoded.data(), image.encoded.size(), &w, &h, &c, 3);
+        if (pixels == NULL)
+        {
+            printf("Warning: skip undecodable image %s\n", image.path.c_str());
+            continue;
+        }
+        image.rgb.width = w;
+        image.rgb.height = h;
+        image.rgb.format = IMAGE_FORMAT_RGB888;
+        image.rgb.size = w * h * 3;
+        image.rgb.virt_addr = (unsigned char*)malloc(image.rgb.size);
+        memcpy(image.rgb.virt_addr, pixels, image.rgb.size);
+        stbi_image_free(pixels);
+        images.push_back(image);
+    }
+    return images.empty() ? -1 : 0;
+}
+
+// 与init_yolov8_model相同的规则从tensor属性推出模型尺寸和量化类型
+void fill_model_info(rknn_app_context_t* app_ctx)
+{
+    const rknn_tensor_attr& in = app_ctx->input_attrs[0];
+    if (in.fmt == RKNN_TENSOR_NCHW)
+    {
+        app_ctx->model_channel = in.dims[1];
+        app_ctx->model_height = in.dims[2];
+        app_ctx->model_width = in.dims[3];
+    }
+    else
+    {
+        app_ctx->model_height = in.dims[1];
+        app_ctx->model_width = in.dims[2];
+        app_ctx->model_channel = in.dims[3];
+    }
+    app_ctx->is_quant = app_ctx->output_attrs[0].qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC &&
+                        (app_ctx->output_attrs[0].type == RKNN_TENSOR_INT8 ||
+                         app_ctx->output_attrs[0].type == RKNN_TENSOR_UINT8);
+}
+
+int init_replay_model(const std::string& path, BenchModel* model)
+{
+    if (load_rknn_recording(path.c_str(), &model->rec) != 0 || model->rec.frames.empty())
+    {
+        printf("Error: Cannot replay %s\n", path.c_str());
+        return -1;
+    }
+    rknn_app_context_t* app_ctx = &model->app_ctx;
+    app_ctx->io_num = model->rec.io_num;
+    app_ctx->input_attrs = model->rec.input_attrs.data();
+    app_ctx->output_attrs = model->rec.output_attrs.data();
+    fill_model_info(app_ctx);
+
+    model->replay_outputs.resize(app_ctx->io_num.n_output);
+    for (size_t i = 0; i < model->replay_outputs.size(); i++)
+    {
+        rknn_output& out = model->replay_outputs[i];
+        memset(&out, 0, sizeof(out));
+        out.index = i;
+        out.want_float = model->rec.want_float;
+        out.is_prealloc = 1;
+        out.size = model->rec.frames[0][i].size();
+        out.buf = malloc(out.size);
+    }
+    model->outputs = model->replay_outputs.data();
+    model->real = false;
+    printf("replay: %zu recorded frames, model %dx%d, %s\n", model->rec.frames.size(), app_ctx->model_width,
+           app_ctx->model_height, app_ctx->is_quant ? "int8" : "float");
+    return 0;
+}
+
+void release_model(BenchModel* model)
+{
+#ifdef BENCH_WITH_RKNN
+    if (model->real)
+    {
+        release_yolov8_model(&model->app_ctx);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < model->replay_outputs.size(); i++)
+    {
+        free(model->replay_outputs[i].buf);
+    }
+    model->replay_outputs.clear();
+}
+
+// 推理一张图：真实推理，或者把录制的输出拷贝到输出缓冲区（对应rknn_outputs_get的拷贝）
+int run_model(BenchModel* model, size_t image_index, image_buffer_t* input)
+{
+#ifdef BENCH_WITH_RKNN
+    if (model->real)
+    {
+        return run_yolov8_model(&model->app_ctx, input, model->outputs);
+    }
+#endif
+    (void)input;
+    const std::vector<std::vector<uint8_t> >& frame = model->rec.frames[image_index % model->rec.frames.size()];
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+        memcpy(model->outputs[i].buf, frame[i].data(), std::min<size_t>(frame[i].size(), model->outputs[i].size));
+    }
+    return 0;
+}
+
+/**
+ * @brief 计时：warmup轮不记录，之后iters轮每次调用fn(i)记录一个样本，i为0..count-1
+ */
+template <typename Fn>
+BenchResult measure(const std::string& name, int warmup, int iters, size_t count, Fn fn)
+{
+    BenchResult result;
+    result.name = name;
+    result.samples_us.reserve((size_t)iters * count);
+    for (int it = 0; it < warmup + iters; it++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            int64_t t0 = perf_now_ns();
+            fn(i);
+            int64_t t1 = perf_now_ns();
+            if (it >= warmup)
+            {
+                result.samples_us.push_back((t1 - t0) / 1000.0);
+            }
+        }
+    }
+    return result;
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+    return sorted[index];
+}
+
+void write_results(FILE* fp, const BenchOptions& opts, const char* mode, size_t image_count,
+                   std::vector<BenchResult>& results)
+{
+    if (opts.csv)
+    {
+        fprintf(fp, "name,count,throughput_per_s,mean_us,p50_us,p90_us,p99_us,max_us\n");
+    }
+    else
+    {
+        fprintf(fp, "{\n  \"mode\": \"%s\",\n  \"images\": %zu,\n  \"warmup\": %d,\n  \"iters\": %d,\n"
+                    "  \"results\": [",
+                mode, image_count, opts.warmup, opts.iters);
+    }
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        std::vector<double>& s = results[r].samples_us;
+        std::sort(s.begin(), s.end());
+        double sum = 0;
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            sum += s[i];
+        }
+        double mean = s.empty() ? 0 : sum / s.size();
+        double throughput = mean > 0 ? 1e6 / mean : 0;
+        if (opts.csv)
+        {
+            fprintf(fp, "%s,%zu,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f\n", results[r].name.c_str(), s.size(), throughput, mean,
+                    percentile(s, 0.50), percentile(s, 0.90), percentile(s, 0.99), s.empty() ? 0 : s.back());
+        }
+        else
+        {
+            fprintf(fp,
+                    "%s\n    {\"name\": \"%s\", \"count\": %zu, \"throughput_per_s\": %.2f, \"mean_us\": %.3f, "
+                    "\"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}",
+                    r == 0 ? "" : ",", results[r].name.c_str(), s.size(), throughput, mean, percentile(s, 0.50),
+                    percentile(s, 0.90), percentile(s, 0.99), s.empty() ? 0 : s.back());
+        }
+    }
+    if (!opts.csv)
+    {
+        fprintf(fp, "\n  ]\n}\n");
+    }
+}
+
+// 简单的线性同余随机数，保证每次运行的合成数据相同
+struct BenchRandom {
+    uint32_t state;
+    explicit BenchRandom(uint32_t seed) : state(seed) {}
+    uint32_t next()
+    {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    }
+    float uniform(float lo, float hi) { return lo + (hi - lo) * (next() & 0xffff) / 65535.0f; }
+};
+
+void run_nms_sweep(const BenchOptions& opts, std::vector<BenchResult>& results)
+{
+    const int sizes[] = {100, 1000, 5000, 20000, 50000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int n = sizes[s];
+        BenchRandom rng(n);
+        NmsBoxes boxes;
+        boxes.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            float w = rng.uniform(8, 96);
+            float h = rng.uniform(8, 96);
+            boxes.x1[i] = rng.uniform(0, 640 - w);
+            boxes.y1[i] = rng.uniform(0, 640 - h);
+            boxes.x2[i] = boxes.x1[i] + w;
+            boxes.y2[i] = boxes.y1[i] + h;
+            boxes.score[i] = 1.0f - (float)i / n;     // 已按置信度降序
+            boxes.cls[i] = rng.next() % 3;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "sweep_nms_%d", n);
+        results.push_back(measure(name, opts.warmup, opts.iters, 1, [&](size_t) {
+            nms_sorted(boxes, n, NMS_THRESH, NMS_PER_CLASS);
+        }));
+    }
+}
+
+/**
+ * @brief 合成int8模型输出（单类别、dfl_len=16、每分支box+score两个输出），n个网格超过置信度阈值
+ */
+void run_postprocess_sweep(const BenchOptions& opts, std::vector<BenchResult>& results)
+{
+    const int sizes[] = {100, 1000, 5000, 20000, 50000};
+    const int dfl_len = 16;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int n = sizes[s];
+        // 选择网格总数足够容纳n个候选的输入尺寸（3个分支步长8/16/32）
+        int model_size = 640;
+        while ((model_size / 8) * (model_size / 8) * 21 / 16 < n)
+        {
+            model_size += 320;
+        }
+
+        rknn_tensor_attr attrs[6];
+        memset(attrs, 0, sizeof(attrs));
+        std::vector<std::vector<int8_t> > tensors(6);
+        std::vector<rknn_output> outputs(6);
+        int total_cells = 0;
+        for (int b = 0; b < 3; b++)
+        {
+            int grid = model_size / (8 << b);
+            total_cells += grid * grid;
+            for (int k = 0; k < 2; k++)
+            {
+                rknn_tensor_attr& attr = attrs[b * 2 + k];
+                attr.index = b * 2 + k;
+                attr.n_dims = 4;
+                attr.dims[0] = 1;
+                attr.dims[1] = k == 0 ? 4 * dfl_len : 1;
+                attr.dims[2] = grid;
+                attr.dims[3] = grid;
+                attr.n_elems = attr.dims[1] * grid * grid;
+                attr.type = RKNN_TENSOR_INT8;
+                attr.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+                attr.zp = k == 0 ? 0 : -128;
+                attr.scale = k == 0 ? 0.05f : 1.0f / 255;
+                tensors[b * 2 + k].assign(attr.n_elems, k == 0 ? 0 : -128);
+            }
+        }
+
+        BenchRandom rng(n);
+        for (int b = 0; b < 3; b++)
+        {
+            std::vector<int8_t>& box = tensors[b * 2];
+            for (size_t i = 0; i < box.size(); i++)
+            {
+                box[i] = (int8_t)(rng.next() % 160 - 80);
+            }
+        }
+        // 按网格总数均匀选出n个高分网格
+        for (int i = 0; i < n; i++)
+        {
+            int cell = (int)((int64_t)i * total_cells / n);
+            for (int b = 0; b < 3; b++)
+            {
+                int grid = model_size / (8 << b);
+                if (cell < grid * grid)
+                {
+                    tensors[b * 2 + 1][cell] = (int8_t)(rng.next() % 120 - 20);    // 分数约0.42~0.89
+                    break;
+                }
+                cell -= grid * grid;
+            }
+        }
+        for (int i = 0; i < 6; i++)
+        {
+            memset(&outputs[i], 0, sizeof(rknn_output));
+            outputs[i].index = i;
+            outputs[i].buf = tensors[i].data();
+            outputs[i].size = tensors[i].size();
+        }
+
+        rknn_tensor_attr input_attr;
+        memset(&input_attr, 0, sizeof(input_attr));
+        input_attr.n_dims = 4;
+        input_attr.fmt = RKNN_TENSOR_NHWC;
+        input_attr.dims[0] = 1;
+        input_attr.dims[1] = model_size;
+        input_attr.dims[2] = model_size;
+        input_attr.dims[3] = 3;
+
+        rknn_app_context_t app_ctx;
+        memset(&app_ctx, 0, sizeof(app_ctx));
+        app_ctx.io_num.n_input = 1;
+        app_ctx.io_num.n_output = 6;
+        app_ctx.input_attrs = &input_attr;
+        app_ctx.output_attrs = attrs;
+        fill_model_info(&app_ctx);
+        // 按合成模型的类别数重新选择解码函数（规模扫描在其它阶段之后运行）
+        init_post_process(&app_ctx, NULL);
+
+        letterbox_t letter_box;
+        letter_box.scale = 1.0f;
+        letter_box.x_pad = 0;
+        letter_box.y_pad = 0;
+        object_detect_result_list od_results;
+        init_detect_result_list(&od_results, 0);
+
+        char name[64];
+        snprintf(name, sizeof(name), "sweep_postprocess_%d", n);
+        results.push_back(measure(name, opts.warmup, opts.iters, 1, [&](size_t) {
+            post_process(&app_ctx, outputs.data(), &letter_box, BOX_THRESH, NMS_THRESH, &od_results);
+        }));
+        free_detect_result_list(&od_results);
+    }
+}
+
+/**
+ * @brief 合成1080p/4K帧letterbox到模型输入，线程数从1到4（--preprocess-threads更大时到该值）
+ */
+void run_preprocess_scaling(const BenchOptions& opts, const rknn_app_context_t* app_ctx,
+                            std::vector<BenchResult>& results)
+{
+    struct { const char* name; int width; int height; } sizes[] = {{"1080p", 1920, 1080}, {"4k", 3840, 2160}};
+    struct { const char* name; image_format_t format; } formats[] = {{"rgb", IMAGE_FORMAT_RGB888},
+                                                                   {"nv12", IMAGE_FORMAT_YUV420SP_NV12}};
+    int max_threads = std::max(4, opts.preprocess_threads);
+    const int* cpus = opts.preprocess_cpus.empty() ? NULL : opts.preprocess_cpus.data();
+
+    image_buffer_t dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.width = app_ctx->model_width;
+    dst.height = app_ctx->model_height;
+    dst.format = IMAGE_FORMAT_RGB888;
+    dst.size = get_image_size(&dst);
+    dst.virt_addr = (unsigned char*)malloc(dst.size);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+        {
+            image_buffer_t src;
+            memset(&src, 0, sizeof(src));
+            src.width = sizes[s].width;
+            src.height = sizes[s].height;
+            src.format = formats[f].format;
+            src.size = get_image_size(&src);
+            std::vector<unsigned char> pixels(src.size);
+            BenchRandom rng(src.size);
+            for (size_t i = 0; i < pixels.size(); i++)
+            {
+                pixels[i] = (unsigned char)rng.next();
+            }
+            src.virt_addr = pixels.data();
+            for (int threads = 1; threads <= max_threads; threads++)
+            {
+                set_image_convert_threads(threads, cpus, (int)opts.preprocess_cpus.size());
+                char name[64];
+                snprintf(name, sizeof(name), "letterbox_%s_%s_t%d", formats[f].name, sizes[s].name, threads);
+                results.push_back(measure(name, opts.warmup, opts.iters, 1, [&](size_t) {
+                    letterbox_t letter_box;
+                    convert_image_with_letterbox(&src, &dst, &letter_box, 114);
+                }));
+            }
+        }
+    }
+    free(dst.virt_addr);
+    set_image_convert_threads(opts.preprocess_threads, cpus, (int)opts.preprocess_cpus.size());
+}
+
+void print_usage(const char* prog)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("  --images=DIR       input images, loaded into memory once (default ./inputimage)\n");
+    printf("  --model=FILE       rknn model for on-board inference (default ./model/yolov8.rknn)\n");
+    printf("  --model-load=M     read | mmap (default) | populate | zero-copy, prints load time and peak RSS\n");
+    printf("  --record=FILE      save the model outputs of every image for host replay (on-board only)\n");
+    printf("  --replay=FILE      replay recorded outputs instead of running the NPU\n");
+    printf("  --warmup=N         warmup passes over all images, not measured (default 5)\n");
+    printf("  --iters=M          measured passes over all images (default 50)\n");
+    printf("  --async=N          also measure end-to-end throughput with N frames in flight (rknn mode)\n");
+    printf("  --sweep            add synthetic NMS / postprocess sweeps over 100..50000 candidates\n");
+    printf("  --preprocess-threads=N  letterbox with N threads (default 1)\n");
+    printf("  --preprocess-cpus=LIST  pin letterbox workers to LIST, e.g. 4-7 (RK3588 big cores)\n");
+    printf("  --scaling          add letterbox of synthetic 1080p / 4K RGB and NV12 frames with 1..4 threads\n");
+    printf("  --format=json|csv  output format (default json)\n");
+    printf("  --out=FILE         write results to FILE instead of stdout\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchOptions opts;
+    opts.image_dir = "./inputimage";
+    opts.model_path = "./model/yolov8.rknn";
+    opts.model_load = "mmap";
+    opts.csv = false;
+    opts.sweep = false;
+    opts.warmup = 5;
+    opts.iters = 50;
+    opts.async_depth = 0;
+    opts.preprocess_threads = 1;
+    opts.scaling = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--images=") == 0)
+        {
+            opts.image_dir = arg.substr(9);
+        }
+        else if (arg.compare(0, 8, "--model=") == 0)
+        {
+            opts.model_path = arg.substr(8);
+        }
+        else if (arg.compare(0, 13, "--model-load=") == 0)
+        {
+            opts.model_load = arg.substr(13);
+        }
+        else if (arg.compare(0, 9, "--record=") == 0)
+        {
+            opts.record_path = arg.substr(9);
+        }
+        else if (arg.compare(0, 9, "--replay=") == 0)
+        {
+            opts.replay_path = arg.substr(9);
+        }
+        else if (arg.compare(0, 9, "--warmup=") == 0)
+        {
+            opts.warmup = std::max(0, atoi(arg.c_str() + 9));
+        }
+        else if (arg.compare(0, 8, "--iters=") == 0)
+        {
+            opts.iters = std::max(1, atoi(arg.c_str() + 8));
+        }
+        else if (arg.compare(0, 8, "--async=") == 0)
+        {
+            opts.async_depth = std::max(1, atoi(arg.c_str() + 8));
+        }
+        else if (arg == "--sweep")
+        {
+            opts.sweep = true;
+        }
+        else if (arg.compare(0, 21, "--preprocess-threads=") == 0)
+        {
+            opts.preprocess_threads = std::max(1, atoi(arg.c_str() + 21));
+        }
+        else if (arg.compare(0, 18, "--preprocess-cpus=") == 0)
+        {
+            int cpus[CPU_SETSIZE];
+            int cpu_num = parse_cpu_list(arg.c_str() + 18, cpus, CPU_SETSIZE);
+            if (cpu_num < 0)
+            {
+                printf("Error: invalid cpu list: %s\n", arg.c_str() + 18);
+                return -1;
+            }
+            opts.preprocess_cpus.assign(cpus, cpus + cpu_num);
+        }
+        else if (arg == "--scaling")
+        {
+            opts.scaling = true;
+        }
+        else if (arg == "--format=csv")
+        {
+            opts.csv = true;
+        }
+        else if (arg == "--format=json")
+        {
+            opts.csv = false;
+        }
+        else if (arg.compare(0, 6, "--out=") == 0)
+        {
+            opts.out_path = arg.substr(6);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (set_image_convert_threads(opts.preprocess_threads,
+                                  opts.preprocess_cpus.empty() ? NULL : opts.preprocess_cpus.data(),
+                                  (int)opts.preprocess_cpus.size()) != 0)
+    {
+        printf("Warning: letterbox thread pool not fully started\n");
+    }
+
+    std::vector<BenchImage> images;
+    if (load_images(opts.image_dir, images) != 0)
+    {
+        printf("Error: No images loaded from %s\n", opts.image_dir.c_str());
+        return -1;
+    }
+    printf("loaded %zu images from %s\n", images.size(), opts.image_dir.c_str());
+
+    BenchModel model;
+    memset(&model.app_ctx, 0, sizeof(model.app_ctx));
+    model.real = false;
+    model.outputs = NULL;
+    const char* mode = NULL;
+    if (!opts.replay_path.empty())
+    {
+        if (init_replay_model(opts.replay_path, &model) != 0)
+        {
+            return -1;
+        }
+        mode = "replay";
+    }
+    else
+    {
+#ifdef BENCH_WITH_RKNN
+        yolov8_init_options_t init_opts;
+        memset(&init_opts, 0, sizeof(init_opts));
+        if (parse_yolov8_model_load(opts.model_load.c_str(), &init_opts) != 0)
+        {
+            printf("Error: invalid --model-load value: %s\n", opts.model_load.c_str());
+            return -1;
+        }
+        if (init_yolov8_model_ex(opts.model_path.c_str(), &model.app_ctx, &init_opts) != 0)
+        {
+            printf("Error: init model %s fail\n", opts.model_path.c_str());
+            return -1;
+        }
+        model.real = true;
+        model.outputs = model.app_ctx.outputs;
+        mode = "rknn";
+#else
+        printf("Error: built without librknnrt, use --replay=FILE recorded on the board\n");
+        return -1;
+#endif
+    }
+    rknn_app_context_t* app_ctx = &model.app_ctx;
+    if (init_post_process(app_ctx, NULL) != 0)
+    {
+        release_model(&model);
+        return -1;
+    }
+
+    // 每张图的letterbox结果和letterbox参数，推理和后处理阶段复用
+    std::vector<image_buffer_t> inputs(images.size());
+    std::vector<letterbox_t> letter_boxes(images.size());
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        memset(&inputs[i], 0, sizeof(image_buffer_t));
+        inputs[i].width = app_ctx->model_width;
+        inputs[i].height = app_ctx->model_height;
+        inputs[i].format = IMAGE_FORMAT_RGB888;
+        inputs[i].size = get_image_size(&inputs[i]);
+        inputs[i].virt_addr = (unsigned char*)malloc(inputs[i].size);
+        convert_image_with_letterbox(&images[i].rgb, &inputs[i], &letter_boxes[i], 114);
+    }
+
+    // 录制：每张图推理一次并保存全部输出
+    if (!opts.record_path.empty())
+    {
+        if (!model.real)
+        {
+            printf("Error: --record needs on-board inference\n");
+            return -1;
+        }
+        RknnRecording rec;
+        rec.io_num = app_ctx->io_num;
+        rec.input_attrs.assign(app_ctx->input_attrs, app_ctx->input_attrs + app_ctx->io_num.n_input);
+        rec.output_attrs.assign(app_ctx->output_attrs, app_ctx->output_attrs + app_ctx->io_num.n_output);
+        rec.want_float = !app_ctx->is_quant;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            run_model(&model, i, &inputs[i]);
+            std::vector<std::vector<uint8_t> > frame(app_ctx->io_num.n_output);
+            for (size_t k = 0; k < frame.size(); k++)
+            {
+                const uint8_t* data = (const uint8_t*)model.outputs[k].buf;
+                frame[k].assign(data, data + model.outputs[k].size);
+            }
+            rec.frames.push_back(frame);
+        }
+        if (save_rknn_recording(opts.record_path.c_str(), rec) != 0)
+        {
+            return -1;
+        }
+        printf("recorded %zu frames to %s\n", rec.frames.size(), opts.record_path.c_str());
+    }
+
+    object_detect_result_list od_results;
+    init_detect_result_list(&od_results, 0);
+    std::vector<BenchResult> results;
+    size_t count = images.size();
+
+    results.push_back(measure("decode", opts.warmup, opts.iters, count, [&](size_t i) {
+        int w, h, c;
+        unsigned char* pixels =
+            stbi_load_from_memory(images[i].encoded.data(), images[i].encoded.size(), &w, &h, &c, 3);
+        stbi_image_free(pixels);
+    }));
+    results.push_back(measure("letterbox", opts.warmup, opts.iters, count, [&](size_t i) {
+        convert_image_with_letterbox(&images[i].rgb, &inputs[i], &letter_boxes[i], 114);
+    }));
+    results.push_back(measure(model.real ? "inference" : "inference_replay", opts.warmup, opts.iters, count,
+                              [&](size_t i) { run_model(&model, i, &inputs[i]); }));
+    // 后处理每张图使用自己的输出：先推理（不计时）再计时后处理
+    {
+        BenchResult post;
+        post.name = "postprocess";
+        for (int it = 0; it < opts.warmup + opts.iters; it++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                run_model(&model, i, &inputs[i]);
+                int64_t t0 = perf_now_ns();
+                post_process(app_ctx, model.outputs, &letter_boxes[i], BOX_THRESH, NMS_THRESH, &od_results);
+                int64_t t1 = perf_now_ns();
+                if (it >= opts.warmup)
+                {
+                    post.samples_us.push_back((t1 - t0) / 1000.0);
+                }
+            }
+        }
+        results.push_back(post);
+    }
+    results.push_back(measure("end_to_end", opts.warmup, opts.iters, count, [&](size_t i) {
+        int w, h, c;
+        image_buffer_t src;
+        memset(&src, 0, sizeof(src));
+        src.virt_addr = stbi_load_from_memory(images[i].encoded.data(), images[i].encoded.size(), &w, &h, &c, 3);
+        if (src.virt_addr == NULL)
+        {
+            return;
+        }
+        src.width = w;
+        src.height = h;
+        src.format = IMAGE_FORMAT_RGB888;
+        src.size = w * h * 3;
+        letterbox_t letter_box;
+        convert_image_with_letterbox(&src, &inputs[i], &letter_box, 114);
+        stbi_image_free(src.virt_addr);
+        run_model(&model, i, &inputs[i]);
+        post_process(app_ctx, model.outputs, &letter_box, BOX_THRESH, NMS_THRESH, &od_results);
+    }));
+
+#ifdef BENCH_WITH_RKNN
+    // 异步推理：主线程解码并提交，后台线程完成letterbox、推理和后处理，样本为相邻两帧完成的间隔
+    if (model.real && opts.async_depth > 0)
+    {
+        AsyncInferencer inferencer;
+        if (inferencer.init(app_ctx, opts.async_depth) != 0)
+        {
+            printf("Error: AsyncInferencer init fail\n");
+            return -1;
+        }
+        BenchResult async_result;
+        async_result.name = "end_to_end_async";
+        size_t warmup_frames = (size_t)opts.warmup * count;
+        size_t done = 0;
+        int64_t last_ns = 0;
+        for (int it = 0; it < opts.warmup + opts.iters; it++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                int w, h, c;
+                image_buffer_t* src = (image_buffer_t*)calloc(1, sizeof(image_buffer_t));
+                src->virt_addr =
+                    stbi_load_from_memory(images[i].encoded.data(), images[i].encoded.size(), &w, &h, &c, 3);
+                if (src->virt_addr == NULL)
+                {
+                    free(src);
+                    continue;
+                }
+                src->width = w;
+                src->height = h;
+                src->format = IMAGE_FORMAT_RGB888;
+                src->size = w * h * 3;
+                inferencer.submit(src, [&, src](const AsyncInferResult&) {
+                    int64_t now = perf_now_ns();
+                    if (done >= warmup_frames && last_ns != 0)
+                    {
+                        async_result.samples_us.push_back((now - last_ns) / 1000.0);
+                    }
+                    last_ns = now;
+                    done++;
+                    stbi_image_free(src->virt_addr);
+                    free(src);
+                });
+            }
+        }
+        inferencer.flush();
+        inferencer.deinit();
+        results.push_back(async_result);
+    }
+#endif
+
+    if (opts.sweep)
+    {
+        run_nms_sweep(opts, results);
+        run_postprocess_sweep(opts, results);
+    }
+    if (opts.scaling)
+    {
+        run_preprocess_scaling(opts, app_ctx, results);
+    }
+
+    FILE* fp = stdout;
+    if (!opts.out_path.empty())
+    {
+        fp = fopen(opts.out_path.c_str(), "w");
+        if (fp == NULL)
+        {
+            printf("Error: Cannot write %s\n", opts.out_path.c_str());
+            fp = stdout;
+        }
+    }
+    write_results(fp, opts, mode, count, results);
+    if (fp != stdout)
+    {
+        fclose(fp);
+        printf("results written to %s\n", opts.out_path.c_str());
+    }
+
+    free_detect_result_list(&od_results);
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        free(inputs[i].virt_addr);
+        free(images[i].rgb.virt_addr);
+    }
+    release_model(&model);
+    deinit_post_process();
+    set_image_convert_threads(1, NULL, 0);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file yolov8_record_gen.cc
+ * @brief 生成合成的录制文件，供rknn_stub回放和yolov8_bench --replay使用
+ *
+ * 没有板端录制文件时（例如CI），用它生成结构与YOLOv8 RKNN模型一致的输出：
+ * 1个NHWC INT8输入，3个分支 × (box[4*16通道] / score[类别数] / score_sum[1])共9个INT8输出，
+ * 量化参数与板端模型相近。score大部分为最低值，少数网格单元随机取值，
+ * score_sum为该单元各类score之和（饱和到1），因此预筛选、DFL、NMS都有真实的工作量。
+ * 固定种子生成，同样的参数每次生成的文件相同。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "rknn_record.h"
+
+namespace {
+
+struct GenOptions {
+    std::string out_path;
+    int width;
+    int height;
+    int classes;
+    int frames;
+    int density;    // 每density个网格单元中约有一个有目标
+    unsigned int seed;
+};
+
+const int kDflLen = 16;
+const float kBoxScale = 0.05f;
+const float kScoreScale = 1.0f / 255;
+
+rknn_tensor_attr make_output_attr(int index, int channels, int grid_h, int grid_w, int32_t zp, float scale)
+{
+    rknn_tensor_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.index = index;
+    snprintf(attr.name, sizeof(attr.name), "output%d", index);
+    attr.n_dims = 4;
+    attr.dims[0] = 1;
+    attr.dims[1] = channels;
+    attr.dims[2] = grid_h;
+    attr.dims[3] = grid_w;
+    attr.n_elems = channels * grid_h * grid_w;
+    attr.size = attr.n_elems;
+    attr.fmt = RKNN_TENSOR_NCHW;
+    attr.type = RKNN_TENSOR_INT8;
+    attr.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+    attr.zp = zp;
+    attr.scale = scale;
+    return attr;
+}
+
+void generate(const GenOptions& opts, RknnRecording* rec)
+{
+    rec->io_num.n_input = 1;
+    rec->io_num.n_output = 9;
+    rec->want_float = false;
+
+    rknn_tensor_attr in;
+    memset(&in, 0, sizeof(in));
+    snprintf(in.name, sizeof(in.name), "images");
+    in.n_dims = 4;
+    in.dims[0] = 1;
+    in.dims[1] = opts.height;
+    in.dims[2] = opts.width;
+    in.dims[3] = 3;
+    in.n_elems = opts.width * opts.height * 3;
+    in.size = in.n_elems;
+    in.fmt = RKNN_TENSOR_NHWC;
+    in.type = RKNN_TENSOR_INT8;
+    in.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+    in.scale = 1.0f / 255;
+    in.zp = -128;
+    rec->input_attrs.push_back(in);
+
+    for (int b = 0; b < 3; b++)
+    {
+        int stride = 8 << b;
+        int grid_h = opts.height / stride;
+        int grid_w = opts.width / stride;
+        int base = (int)rec->output_attrs.size();
+        rec->output_attrs.push_back(make_output_attr(base, 4 * kDflLen, grid_h, grid_w, 0, kBoxScale));
+        rec->output_attrs.push_back(make_output_attr(base + 1, opts.classes, grid_h, grid_w, -128, kScoreScale));
+        rec->output_attrs.push_back(make_output_attr(base + 2, 1, grid_h, grid_w, -128, kScoreScale));
+    }
+
+    srand(opts.seed);
+    rec->frames.resize(opts.frames);
+    for (int f = 0; f < opts.frames; f++)
+    {
+        std::vector<std::vector<uint8_t> >& frame = rec->frames[f];
+        frame.resize(rec->output_attrs.size());
+        for (int b = 0; b < 3; b++)
+        {
+            const rknn_tensor_attr& box_attr = rec->output_attrs[b * 3];
+            int grid_len = box_attr.dims[2] * box_attr.dims[3];
+            std::vector<uint8_t>& box = frame[b * 3];
+            std::vector<uint8_t>& score = frame[b * 3 + 1];
+            std::vector<uint8_t>& score_sum = frame[b * 3 + 2];
+            box.resize(box_attr.n_elems);
+            score.assign((size_t)opts.classes * grid_len, (uint8_t)(int8_t)-128);
+            score_sum.assign(grid_len, (uint8_t)(int8_t)-128);
+
+            // DFL分布的logit：0~5之间，softmax后期望落在各bin上
+            for (size_t i = 0; i < box.size(); i++)
+            {
+                box[i] = (uint8_t)(rand() % 100);
+            }
+            for (int cell = 0; cell < grid_len; cell++)
+            {
+                if (rand() % opts.density != 0)
+                {
+                    continue;
+                }
+                int sum = 0;
+                int hits = 1 + rand() % std::min(opts.classes, 3);
+                for (int k = 0; k < hits; k++)
+                {
+                    int c = rand() % opts.classes;
+                    int q = rand() % 256;   // 量化前的概率 * 255
+                    score[(size_t)c * grid_len + cell] = (uint8_t)(int8_t)(q - 128);
+                    sum += q;
+                }
+                score_sum[cell] = (uint8_t)(int8_t)(std::min(sum, 255) - 128);
+            }
+        }
+    }
+}
+
+void print_usage(const char* prog)
+{
+    printf("Usage: %s --out=FILE [options]\n", prog);
+    printf("  --out=FILE       recording to write\n");
+    printf("  --size=WxH       model input size, multiple of 32 (default 640x640)\n");
+    printf("  --classes=N      score channels per branch (default 1)\n");
+    printf("  --frames=N       recorded frames, replayed in a loop (default 3)\n");
+    printf("  --density=N      about one object every N grid cells (default 50)\n");
+    printf("  --seed=N         random seed (default 1)\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    GenOptions opts;
+    opts.width = 640;
+    opts.height = 640;
+    opts.classes = 1;
+    opts.frames = 3;
+    opts.density = 50;
+    opts.seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 6, "--out=") == 0)
+        {
+            opts.out_path = arg.substr(6);
+        }
+        else if (arg.compare(0, 7, "--size=") == 0)
+        {
+            if (sscanf(arg.c_str() + 7, "%dx%d", &opts.width, &opts.height) != 2)
+            {
+                print_usage(argv[0]);
+                return -1;
+            }
+        }
+        else if (arg.compare(0, 10, "--classes=") == 0)
+        {
+            opts.classes = atoi(arg.c_str() + 10);
+        }
+        else if (arg.compare(0, 9, "--frames=") == 0)
+        {
+            opts.frames = atoi(arg.c_str() + 9);
+        }
+        else if (arg.compare(0, 10, "--density=") == 0)
+        {
+            opts.density = atoi(arg.c_str() + 10);
+        }
+        else if (arg.compare(0, 7, "--seed=") == 0)
+        {
+            opts.seed = (unsigned int)strtoul(arg.c_str() + 7, NULL, 10);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (opts.out_path.empty() || opts.width <= 0 || opts.height <= 0 || opts.width % 32 != 0 ||
+        opts.height % 32 != 0 || opts.classes <= 0 || opts.frames <= 0 || opts.density <= 0)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    RknnRecording rec;
+    generate(opts, &rec);
+    if (save_rknn_recording(opts.out_path.c_str(), rec) != 0)
+    {
+        printf("Error: cannot write %s\n", opts.out_path.c_str());
+        return -1;
+    }
+    printf("wrote %s: %dx%d, %d classes, %d frames\n", opts.out_path.c_str(), opts.width, opts.height,
+           opts.classes, opts.frames);
+    return 0;
+}
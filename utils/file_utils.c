@@ -1,6 +1,18 @@
+/* 64-bit off_t on 32-bit targets, so model files over 2 GB can be sized and mapped */
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "file_utils.h"
 
 #define MAX_TEXT_LINE_LENGTH 1024
 
@@ -28,17 +40,29 @@ unsigned char* load_model(const char* filename, int* model_size)
 
 int read_data_from_file(const char *path, char **out_data)
 {
+    *out_data = NULL;
     FILE *fp = fopen(path, "rb");
     if(fp == NULL) {
         printf("fopen %s fail!\n", path);
         return -1;
     }
-    fseek(fp, 0, SEEK_END);
-    int file_size = ftell(fp);
+    fseeko(fp, 0, SEEK_END);
+    off_t file_size = ftello(fp);
+    /* the return value is an int, larger files must go through map_file() */
+    if(file_size < 0 || file_size > INT_MAX - 1) {
+        printf("read %s fail! size=%lld not supported, use map_file\n", path, (long long)file_size);
+        fclose(fp);
+        return -1;
+    }
     char *data = (char *)malloc(file_size+1);
+    if(data == NULL) {
+        printf("malloc %lld fail!\n", (long long)file_size + 1);
+        fclose(fp);
+        return -1;
+    }
     data[file_size] = 0;
-    fseek(fp, 0, SEEK_SET);
-    if(file_size != fread(data, 1, file_size, fp)) {
+    fseeko(fp, 0, SEEK_SET);
+    if((size_t)file_size != fread(data, 1, file_size, fp)) {
         printf("fread %s fail!\n", path);
         free(data);
         fclose(fp);
@@ -48,7 +72,111 @@ int read_data_from_file(const char *path, char **out_data)
         fclose(fp);
     }
     *out_data = data;
-    return file_size;
+    return (int)file_size;
+}
+
+long long get_file_size(const char *path)
+{
+    struct stat st;
+    if(stat(path, &st) != 0) {
+        return -1;
+    }
+    return (long long)st.st_size;
+}
+
+static int read_fd_fully(int fd, void *buf, size_t size)
+{
+    size_t done = 0;
+    while(done < size) {
+        /* a single read() transfers at most ~2 GB on Linux */
+        ssize_t n = read(fd, (char *)buf + done, size - done);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+int read_file_to_buffer(const char *path, void *buf, size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        printf("open %s fail! %s\n", path, strerror(errno));
+        return -1;
+    }
+    int ret = read_fd_fully(fd, buf, size);
+    if(ret != 0) {
+        printf("read %s fail!\n", path);
+    }
+    close(fd);
+    return ret;
+}
+
+int map_file(const char *path, int flags, mapped_file_t *file)
+{
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        printf("open %s fail! %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0 || (unsigned long long)st.st_size > (size_t)-1) {
+        printf("map %s fail! bad size\n", path);
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+
+    int mmap_flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if(flags & FILE_MAP_POPULATE) {
+        mmap_flags |= MAP_POPULATE;
+    }
+#endif
+    void *data = mmap(NULL, size, PROT_READ, mmap_flags, fd, 0);
+    if(data != MAP_FAILED) {
+        if(flags & FILE_MAP_WILLNEED) {
+            madvise(data, size, MADV_SEQUENTIAL);
+            madvise(data, size, MADV_WILLNEED);
+        }
+        close(fd);
+        file->data = data;
+        file->size = size;
+        file->is_mapped = 1;
+        return 0;
+    }
+
+    /* e.g. filesystems without mmap support */
+    data = malloc(size);
+    if(data == NULL || read_fd_fully(fd, data, size) != 0) {
+        printf("map %s fail! %s\n", path, strerror(errno));
+        free(data);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    file->data = data;
+    file->size = size;
+    file->is_mapped = 0;
+    return 0;
+}
+
+void unmap_file(mapped_file_t *file)
+{
+    if(file->data == NULL) {
+        return;
+    }
+    if(file->is_mapped) {
+        munmap(file->data, file->size);
+    } else {
+        free(file->data);
+    }
+    memset(file, 0, sizeof(*file));
 }
 
 int write_data_to_file(const char *path, const char *data, unsigned int size)
@@ -1,10 +1,24 @@
 #ifndef _RKNN_MODEL_ZOO_FILE_UTILS_H_
 #define _RKNN_MODEL_ZOO_FILE_UTILS_H_
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define FILE_MAP_POPULATE   0x1  /* prefault every page at map time (MAP_POPULATE) */
+#define FILE_MAP_WILLNEED   0x2  /* madvise(MADV_SEQUENTIAL | MADV_WILLNEED): start read-ahead, return immediately */
+
+/**
+ * @brief Read-only view of a whole file
+ */
+typedef struct {
+    void* data;
+    size_t size;
+    int is_mapped;  /* 1: data is a private read-only mmap, 0: data was malloc'ed by the read fallback */
+} mapped_file_t;
+
 /**
  * @brief Read data from file
  * 
@@ -14,6 +28,45 @@ extern "C" {
  */
 int read_data_from_file(const char *path, char **out_data);
 
+/**
+ * @brief Map a whole file read-only
+ *
+ * The pages stay in the shared page cache instead of being copied into an
+ * anonymous heap buffer. Falls back to malloc + read when mmap fails.
+ * Sizes are handled as 64-bit, so files over 2 GB are mapped correctly.
+ *
+ * @param path [in] File path
+ * @param flags [in] FILE_MAP_POPULATE and/or FILE_MAP_WILLNEED, 0 for lazy paging
+ * @param file [out] Mapping, release with unmap_file()
+ * @return int 0: success; -1: error (including empty files)
+ */
+int map_file(const char *path, int flags, mapped_file_t *file);
+
+/**
+ * @brief Release a mapping created by map_file()
+ *
+ * @param file [in] Mapping
+ */
+void unmap_file(mapped_file_t *file);
+
+/**
+ * @brief Get file size
+ *
+ * @param path [in] File path
+ * @return long long -1: error; >= 0: file size in bytes
+ */
+long long get_file_size(const char *path);
+
+/**
+ * @brief Read a whole file into a caller-provided buffer
+ *
+ * @param path [in] File path
+ * @param buf [out] Destination, at least size bytes
+ * @param size [in] Expected file size, see get_file_size()
+ * @return int 0: success; -1: error or short read
+ */
+int read_file_to_buffer(const char *path, void *buf, size_t size);
+
 /**
  * @brief Write data to file
  * 
@@ -5,6 +5,7 @@
 
 #include "image_drawing.h"
 #include "font.h"
+#include "log_utils.h"
 
 #define max(a, b) (((a) > (b)) ? (a) : (b))
 #define min(a, b) (((a) < (b)) ? (a) : (b))
@@ -1447,7 +1448,7 @@ static void draw_image_c2(unsigned char* pixels, int w, int h, unsigned char* dr
 
 static void draw_image_c3(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
-    printf("draw_image_c3 pixels=%p wxh=%dx%d draw_img=%p pos=(%d %d) rwxrh=%dx%d\n", pixels, w, h, draw_img, x, y, rw, rh);
+    LOGD("draw_image_c3 pixels=%p wxh=%dx%d draw_img=%p pos=(%d %d) rwxrh=%dx%d", pixels, w, h, draw_img, x, y, rw, rh);
     for (int i = 0; i < rh; i++) {
         memcpy(pixels + ((y + i) * w + x) * 3,  draw_img + i * rw * 3,  rw * 3);
     }
@@ -1492,7 +1493,7 @@ void draw_rectangle(image_buffer_t* image, int rx, int ry, int rw, int rh, unsig
         draw_rectangle_yuv420sp(pixels, w, h, rx, ry, rw, rh, draw_color, thickness);
         break;
     default:
-        printf("no support format %d", format);
+        LOGE("no support format %d", format);
         break;
     }
 }
@@ -1520,7 +1521,7 @@ void draw_line(image_buffer_t* image, int x0, int y0, int x1, int y1, unsigned i
         draw_line_yuv420sp(pixels, w, h, x0, y0, x1, y1, draw_color, thickness);
         break;
     default:
-        printf("no support format %d", format);
+        LOGE("no support format %d", format);
         break;
     }
 }
@@ -1578,7 +1579,7 @@ void draw_text(image_buffer_t* image, const char* text, int x, int y, unsigned i
         draw_text_yuv420sp(pixels, w, h, text, x, y, fontsize, draw_color);
         break;
     default:
-        printf("no support format %d", format);
+        LOGE("no support format %d", format);
         break;
     }
 }
@@ -1605,7 +1606,7 @@ void draw_circle(image_buffer_t* image, int cx, int cy, int radius, unsigned int
         draw_circle_yuv420sp(pixels, w, h, cx, cy, radius, draw_color, thickness);
         break;
     default:
-        printf("no support format %d", format);
+        LOGE("no support format %d", format);
         break;
     }
 }
@@ -1630,7 +1631,7 @@ void draw_image(image_buffer_t* image, unsigned char* draw_img, int x, int y, in
         draw_image_yuv420sp(pixels, w, h, draw_img, x, y, rw, rh);
         break;
     default:
-        printf("no support format %d", format);
+        LOGE("no support format %d", format);
         break;
     }
 }
@@ -1,9 +1,19 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // sched_setaffinity / CPU_SET
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <dirent.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
 #include <sys/time.h>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_NO_THREAD_LOCALS
@@ -18,6 +28,7 @@
 
 #include "image_utils.h"
 #include "file_utils.h"
+#include "log_utils.h"
 
 static const char* filter_image_names[] = {
     "jpg",
@@ -71,7 +82,7 @@ static int write_image_jpeg(const char* path, int quality, const image_buffer_t*
     if (image->format == IMAGE_FORMAT_RGB888) {
         ret = tjCompress2(handle, data, width, 0, height, pixelFormat, &jpegBuf, &jpegSize, jpegSubsamp, quality, flags);
     } else {
-        printf("write_image_jpeg: pixel format %d not support\n", image->format);
+        LOGE("write_image_jpeg: pixel format %d not support", image->format);
         return -1;
     }
 
@@ -91,7 +102,7 @@ static int read_image_stb(const char* path, image_buffer_t* image)
     int w, h, c;  
     unsigned char* pixeldata = stbi_load(path, &w, &h, &c, STBI_default);  
     if (!pixeldata) {  
-        printf("error: read image %s fail\n", path);  
+        LOGE("error: read image %s fail", path);  
         return -1;  
     }  
   
@@ -122,67 +133,534 @@ int read_image(const char* path, image_buffer_t* image)
 
 }
 
+/**
+ * @brief 选择不小于min_scale的最小缩放因子
+ * libjpeg-turbo在IDCT阶段直接输出缩小后的图像（1/2、1/4、1/8等），
+ * 选择不小于letterbox缩放比例的最小因子，既减少解码计算量又不损失模型输入的清晰度
+ */
+static tjscalingfactor choose_jpeg_scaling_factor(float min_scale)
+{
+    int num_factors = 0;
+    tjscalingfactor best = {1, 1};
+    tjscalingfactor* factors = tjGetScalingFactors(&num_factors);
+    if (factors == NULL) {
+        return best;
+    }
+    for (int i = 0; i < num_factors; i++) {
+        float f = (float)factors[i].num / factors[i].denom;
+        float best_f = (float)best.num / best.denom;
+        if (f >= min_scale && f < best_f) {
+            best = factors[i];
+        }
+    }
+    return best;
+}
 
+int read_image_jpeg_scaled(const char* path, int min_width, int min_height, image_buffer_t* image, float* decode_scale)
+{
+    int ret = -1;
+    char* jpeg_buf = NULL;
+    unsigned char* pixels = NULL;
+    int width, height, subsamp, colorspace;
 
-static int crop_and_scale_image_c(int channel, unsigned char *src, int src_width, int src_height,
+    int jpeg_size = read_data_from_file(path, &jpeg_buf);
+    if (jpeg_size <= 0 || jpeg_buf == NULL) {
+        return -1;
+    }
+
+    tjhandle handle = tjInitDecompress();
+    if (handle == NULL) {
+        free(jpeg_buf);
+        return -1;
+    }
+    if (tjDecompressHeader3(handle, (unsigned char*)jpeg_buf, jpeg_size, &width, &height, &subsamp, &colorspace) != 0) {
+        LOGE("read_image_jpeg_scaled: %s %s", path, tjGetErrorStr2(handle));
+        goto out;
+    }
+
+    // 与letterbox相同的缩放比例：整幅图像放入min_width x min_height
+    float letterbox_scale = (float)min_width / width;
+    if ((float)min_height / height < letterbox_scale) {
+        letterbox_scale = (float)min_height / height;
+    }
+    tjscalingfactor sf = choose_jpeg_scaling_factor(letterbox_scale);
+    int scaled_w = TJSCALED(width, sf);
+    int scaled_h = TJSCALED(height, sf);
+
+    pixels = (unsigned char*)malloc((size_t)scaled_w * scaled_h * 3);
+    if (pixels == NULL) {
+        goto out;
+    }
+    if (tjDecompress2(handle, (unsigned char*)jpeg_buf, jpeg_size, pixels, scaled_w, 0, scaled_h, TJPF_RGB,
+                      TJFLAG_FASTDCT) != 0) {
+        LOGE("read_image_jpeg_scaled: %s %s", path, tjGetErrorStr2(handle));
+        free(pixels);
+        goto out;
+    }
+
+    image->width = scaled_w;
+    image->height = scaled_h;
+    image->format = IMAGE_FORMAT_RGB888;
+    image->virt_addr = pixels;
+    image->size = scaled_w * scaled_h * 3;
+    image->fd = 0;
+    if (decode_scale != NULL) {
+        *decode_scale = (float)scaled_w / width;
+    }
+    ret = 0;
+
+out:
+    tjDestroy(handle);
+    free(jpeg_buf);
+    return ret;
+}
+
+
+
+/*
+ * 定点双线性缩放
+ *
+ * 权重使用11位定点数（RESIZE_COEF_BITS），每列的源像素偏移和水平权重、每行的源行号和垂直权重
+ * 在缩放开始前一次性计算成表。每个目标行先对上下两条源行做水平插值（结果为int32，可在相邻
+ * 目标行之间复用），再做垂直插值，垂直插值在ARM上使用NEON每次处理8个通道值。
+ * 采样点及边缘处理与原浮点实现一致，结果与浮点实现相差不超过1。
+ */
+#define RESIZE_COEF_BITS 11
+#define RESIZE_COEF_SCALE (1 << RESIZE_COEF_BITS)
+
+typedef struct {
+    int* x_ofs0;        // 左侧采样点在源行内的字节偏移
+    int* x_ofs1;        // 右侧采样点在源行内的字节偏移
+    int* x_w;           // 右侧采样点权重
+    int* y_row0;        // 上方源行号
+    int* y_row1;        // 下方源行号
+    int* y_w;           // 下方源行权重
+    unsigned int* hrow[2];  // 水平插值结果缓存
+    int hrow_src[2];        // 缓存对应的源行号
+    size_t capacity;
+} resize_scratch_t;
+
+// 每个线程一份缩放用临时缓冲区，按需增长，稳定运行时不再分配内存
+static __thread resize_scratch_t g_resize_scratch;
+
+/*
+ * 线程临时缓冲区的释放：缓冲区地址同时保存在线程私有key中，任何线程（线程池工作线程、
+ * 流水线预处理线程、调用方自己的线程）退出时由key的析构函数释放，不需要调用方处理。
+ */
+enum {
+    SCRATCH_KEY_RESIZE = 0,
+    SCRATCH_KEY_YUV,
+    SCRATCH_KEY_NUM
+};
+
+static pthread_key_t g_scratch_keys[SCRATCH_KEY_NUM];
+static int g_scratch_keys_ok = 0;
+static pthread_once_t g_scratch_keys_once = PTHREAD_ONCE_INIT;
+
+static void create_scratch_keys(void)
+{
+    for (int i = 0; i < SCRATCH_KEY_NUM; i++) {
+        if (pthread_key_create(&g_scratch_keys[i], free) != 0) {
+            LOGW("scratch key create fail, thread scratch is not freed on thread exit");
+            return;
+        }
+    }
+    g_scratch_keys_ok = 1;
+}
+
+// 缓冲区重新分配后调用，登记新的地址
+static void track_thread_scratch(int key, void* buf)
+{
+    pthread_once(&g_scratch_keys_once, create_scratch_keys);
+    if (g_scratch_keys_ok) {
+        pthread_setspecific(g_scratch_keys[key], buf);
+    }
+}
+
+static int reserve_resize_scratch(resize_scratch_t* scratch, int box_w, int box_h, int channel)
+{
+    size_t need_x = (size_t)box_w * 3;
+    size_t need_y = (size_t)box_h * 3;
+    size_t need_row = (size_t)box_w * channel * 2;
+    size_t need = (need_x + need_y) * sizeof(int) + need_row * sizeof(unsigned int);
+    if (need > scratch->capacity) {
+        void* buf = realloc(scratch->x_ofs0, need);
+        if (buf == NULL) {
+            return -1;
+        }
+        scratch->x_ofs0 = (int*)buf;
+        scratch->capacity = need;
+        track_thread_scratch(SCRATCH_KEY_RESIZE, buf);
+    }
+    scratch->x_ofs1 = scratch->x_ofs0 + box_w;
+    scratch->x_w = scratch->x_ofs1 + box_w;
+    scratch->y_row0 = scratch->x_w + box_w;
+    scratch->y_row1 = scratch->y_row0 + box_h;
+    scratch->y_w = scratch->y_row1 + box_h;
+    scratch->hrow[0] = (unsigned int*)(scratch->y_w + box_h);
+    scratch->hrow[1] = scratch->hrow[0] + (size_t)box_w * channel;
+    scratch->hrow_src[0] = -1;
+    scratch->hrow_src[1] = -1;
+    return 0;
+}
+
+static void interp_row_horizontal(int channel, const unsigned char* src_row, const resize_scratch_t* scratch,
+                                  int box_w, unsigned int* out)
+{
+    for (int x = 0; x < box_w; x++) {
+        const unsigned char* p0 = src_row + scratch->x_ofs0[x];
+        const unsigned char* p1 = src_row + scratch->x_ofs1[x];
+        unsigned int w1 = scratch->x_w[x];
+        unsigned int w0 = RESIZE_COEF_SCALE - w1;
+        for (int c = 0; c < channel; c++) {
+            out[c] = p0[c] * w0 + p1[c] * w1;
+        }
+        out += channel;
+    }
+}
+
+static void interp_row_vertical(const unsigned int* h0, const unsigned int* h1, int w1, unsigned char* dst, int n)
+{
+    unsigned int w0 = RESIZE_COEF_SCALE - w1;
+    int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint32x4_t vw0 = vdupq_n_u32(w0);
+    uint32x4_t vw1 = vdupq_n_u32(w1);
+    for (; i + 8 <= n; i += 8) {
+        uint32x4_t lo = vmlaq_u32(vmulq_u32(vld1q_u32(h0 + i), vw0), vld1q_u32(h1 + i), vw1);
+        uint32x4_t hi = vmlaq_u32(vmulq_u32(vld1q_u32(h0 + i + 4), vw0), vld1q_u32(h1 + i + 4), vw1);
+        lo = vshrq_n_u32(lo, RESIZE_COEF_BITS * 2);
+        hi = vshrq_n_u32(hi, RESIZE_COEF_BITS * 2);
+        vst1_u8(dst + i, vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi))));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (unsigned char)((h0[i] * w0 + h1[i] * w1) >> (RESIZE_COEF_BITS * 2));
+    }
+}
+
+// 缩放目标区域中[row_begin, row_end)范围内的行
+static int crop_and_scale_image_rows(int channel, unsigned char *src, int src_width, int src_height,
                                     int crop_x, int crop_y, int crop_width, int crop_height,
-                                    unsigned char *dst, int dst_width, int dst_height,
-                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+                                    unsigned char *dst, int dst_width,
+                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height,
+                                    int row_begin, int row_end) {
     if (dst == NULL) {
-        printf("dst buffer is null\n");
+        LOGE("dst buffer is null");
+        return -1;
+    }
+
+    resize_scratch_t* scratch = &g_resize_scratch;
+    if (reserve_resize_scratch(scratch, dst_box_width, dst_box_height, channel) != 0) {
+        LOGE("alloc resize scratch fail");
         return -1;
     }
 
     float x_ratio = (float)crop_width / (float)dst_box_width;
     float y_ratio = (float)crop_height / (float)dst_box_height;
 
+    // 列表：与浮点实现相同的采样位置，最右列向左取邻点
+    for (int x = 0; x < dst_box_width; x++) {
+        int src_x = (int)(x * x_ratio) + crop_x;
+        float x_diff = (x * x_ratio) - (src_x - crop_x);
+        int next_x = (src_x == src_width - 1) ? src_x - 1 : src_x + 1;
+        if (next_x < 0) {
+            next_x = src_x;
+        }
+        scratch->x_ofs0[x] = src_x * channel;
+        scratch->x_ofs1[x] = next_x * channel;
+        scratch->x_w[x] = (int)(x_diff * RESIZE_COEF_SCALE + 0.5f);
+    }
+    // 行表：最下一行向上取邻行
+    for (int y = row_begin; y < row_end; y++) {
+        int src_y = (int)(y * y_ratio) + crop_y;
+        float y_diff = (y * y_ratio) - (src_y - crop_y);
+        scratch->y_row0[y] = src_y;
+        scratch->y_row1[y] = (src_y == src_height - 1) ? src_y - 1 : src_y + 1;
+        if (scratch->y_row1[y] < 0) {
+            scratch->y_row1[y] = src_y;
+        }
+        scratch->y_w[y] = (int)(y_diff * RESIZE_COEF_SCALE + 0.5f);
+    }
+
+    size_t src_stride = (size_t)src_width * channel;
+    int row_len = dst_box_width * channel;
+    for (int y = row_begin; y < row_end; y++) {
+        unsigned int* rows[2];
+        int need[2] = {scratch->y_row0[y], scratch->y_row1[y]};
+        for (int k = 0; k < 2; k++) {
+            // 优先复用上一目标行已经算好的水平插值结果
+            int slot;
+            if (scratch->hrow_src[0] == need[k]) {
+                slot = 0;
+            } else if (scratch->hrow_src[1] == need[k]) {
+                slot = 1;
+            } else {
+                // 不能覆盖本行另一条源行正在使用的缓存
+                int keep = need[1 - k];
+                slot = (scratch->hrow_src[0] == keep) ? 1 : 0;
+                interp_row_horizontal(channel, src + need[k] * src_stride, scratch, dst_box_width,
+                                      scratch->hrow[slot]);
+                scratch->hrow_src[slot] = need[k];
+            }
+            rows[k] = scratch->hrow[slot];
+        }
+        unsigned char* dst_row = dst + ((size_t)(dst_box_y + y) * dst_width + dst_box_x) * channel;
+        interp_row_vertical(rows[0], rows[1], scratch->y_w[y], dst_row, row_len);
+    }
+    return 0;
+}
+
+/*
+ * 行分块并行缩放
+ *
+ * 目标区域按行切成若干条带，由常驻线程池的工作线程和调用线程一起领取处理。每个线程使用自己的
+ * 缩放临时缓冲区，每一行只取决于行表和列表，结果与串行处理逐位相同。
+ * 线程池同一时刻只服务一个调用者：流水线的多个预处理线程同时调用时，拿不到线程池的调用者直接串行处理，
+ * 不会让线程数超过核心数。目标区域较小时线程同步的开销超过收益，也串行处理。
+ */
+#define CONVERT_PARALLEL_MIN_PIXELS (256 * 256)     // 目标区域小于这个像素数时串行处理
+#define CONVERT_STRIPE_MIN_ROWS 16                  // 每个条带至少的行数
+#define CONVERT_STRIPES_PER_THREAD 2                // 条带数为线程数的倍数，先做完的线程多领，快慢核混用时自动均衡
 
-    // 从原图指定区域取数据，双线性缩放到目标指定区域
-    for (int dst_y = dst_box_y; dst_y < dst_box_y + dst_box_height; dst_y++) {
-        for (int dst_x = dst_box_x; dst_x < dst_box_x + dst_box_width; dst_x++) {
-            int dst_x_offset = dst_x - dst_box_x;
-            int dst_y_offset = dst_y - dst_box_y;
+typedef int (*convert_stripe_fn)(void* arg, int row_begin, int row_end);
 
-            int src_x = (int)(dst_x_offset * x_ratio) + crop_x;
-            int src_y = (int)(dst_y_offset * y_ratio) + crop_y;
+typedef struct {
+    pthread_mutex_t busy;       // 调用者使用线程池期间持有，调整线程数时也持有
+    pthread_mutex_t lock;       // 保护以下字段
+    pthread_cond_t work_cond;   // 有新任务或停止
+    pthread_cond_t done_cond;   // 条带全部完成
+    pthread_t* threads;
+    int thread_num;             // 工作线程数，不含调用线程
+    int stop;
+    int pin;                    // 工作线程是否绑定到cpus
+    cpu_set_t cpus;
+    unsigned int generation;    // 每提交一个任务加1
+    convert_stripe_fn fn;
+    void* arg;
+    int rows;
+    int stripe_rows;
+    int stripe_num;
+    int next_stripe;            // 下一个待领取的条带
+    int done_stripes;
+    int ret;
+} convert_pool_t;
 
-            float x_diff = (dst_x_offset * x_ratio) - (src_x - crop_x);
-            float y_diff = (dst_y_offset * y_ratio) - (src_y - crop_y);
+// 只需静态初始化同步原语，其余字段为0（未启动工作线程）
+static convert_pool_t g_convert_pool = {
+    .busy = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER,
+};
 
-            int index1 = src_y * src_width * channel + src_x * channel;
-            int index2 = index1 + src_width * channel;    // down
-            if (src_y == src_height - 1) {
-                // 如果到图像最下边缘，变成选择上面的像素
-                index2 = index1 - src_width * channel;
-            }
-            int index3 = index1 + 1 * channel;            // right
-            int index4 = index2 + 1 * channel;            // down right
-            if (src_x == src_width - 1) {
-                // 如果到图像最右边缘，变成选择左边的像素
-                index3 = index1 - 1 * channel;
-                index4 = index2 - 1 * channel;
-            }
+// 领取并处理条带直到全部领完，调用时持有pool->lock
+static void run_convert_stripes(convert_pool_t* pool)
+{
+    while (pool->next_stripe < pool->stripe_num) {
+        int stripe = pool->next_stripe++;
+        convert_stripe_fn fn = pool->fn;
+        void* arg = pool->arg;
+        int row_begin = stripe * pool->stripe_rows;
+        int row_end = row_begin + pool->stripe_rows;
+        if (row_end > pool->rows) {
+            row_end = pool->rows;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        int ret = fn(arg, row_begin, row_end);
+        pthread_mutex_lock(&pool->lock);
+        if (ret != 0) {
+            pool->ret = ret;
+        }
+        if (++pool->done_stripes == pool->stripe_num) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+    }
+}
 
+static void* convert_worker(void* arg)
+{
+    convert_pool_t* pool = (convert_pool_t*)arg;
+    if (pool->pin && sched_setaffinity(0, sizeof(cpu_set_t), &pool->cpus) != 0) {
+        LOGW("convert worker: set cpu affinity fail");
+    }
+    pthread_mutex_lock(&pool->lock);
+    unsigned int seen = pool->generation;
+    while (1) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+        run_convert_stripes(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
 
-            for (int c = 0; c < channel; c++) {
-                unsigned char A = src[index1+c];
-                unsigned char B = src[index3+c];
-                unsigned char C = src[index2+c];
-                unsigned char D = src[index4+c];
+// 把[0, rows)按条带分给线程池，不满足并行条件时在调用线程中一次处理完
+static int convert_rows_parallel(convert_stripe_fn fn, void* arg, int rows, int row_pixels)
+{
+    convert_pool_t* pool = &g_convert_pool;
+    if ((long)rows * row_pixels < CONVERT_PARALLEL_MIN_PIXELS || rows < CONVERT_STRIPE_MIN_ROWS * 2 ||
+        pthread_mutex_trylock(&pool->busy) != 0) {
+        return fn(arg, 0, rows);
+    }
+    if (pool->thread_num == 0) {
+        pthread_mutex_unlock(&pool->busy);
+        return fn(arg, 0, rows);
+    }
+    int stripe_num = (pool->thread_num + 1) * CONVERT_STRIPES_PER_THREAD;
+    int stripe_rows = (rows + stripe_num - 1) / stripe_num;
+    if (stripe_rows < CONVERT_STRIPE_MIN_ROWS) {
+        stripe_rows = CONVERT_STRIPE_MIN_ROWS;
+    }
 
-                unsigned char pixel = (unsigned char)(
-                    A * (1 - x_diff) * (1 - y_diff) +
-                    B * x_diff * (1 - y_diff) +
-                    C * y_diff * (1 - x_diff) +
-                    D * x_diff * y_diff
-                );
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->rows = rows;
+    pool->stripe_rows = stripe_rows;
+    pool->stripe_num = (rows + stripe_rows - 1) / stripe_rows;
+    pool->next_stripe = 0;
+    pool->done_stripes = 0;
+    pool->ret = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+    run_convert_stripes(pool);
+    while (pool->done_stripes < pool->stripe_num) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    int ret = pool->ret;
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->busy);
+    return ret;
+}
+
+int set_image_convert_threads(int num_threads, const int* cpus, int cpu_num)
+{
+    convert_pool_t* pool = &g_convert_pool;
+    pthread_mutex_lock(&pool->busy);
+    if (pool->thread_num > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->stop = 1;
+        pthread_cond_broadcast(&pool->work_cond);
+        pthread_mutex_unlock(&pool->lock);
+        for (int i = 0; i < pool->thread_num; i++) {
+            pthread_join(pool->threads[i], NULL);
+        }
+        pool->thread_num = 0;
+        pool->stop = 0;
+    }
+    free(pool->threads);
+    pool->threads = NULL;
 
-                dst[(dst_y * dst_width  + dst_x) * channel + c] = pixel;
+    pool->pin = 0;
+    CPU_ZERO(&pool->cpus);
+    for (int i = 0; cpus != NULL && i < cpu_num; i++) {
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &pool->cpus);
+            pool->pin = 1;
+        }
+    }
+
+    int ret = 0;
+    int workers = num_threads - 1;
+    if (workers > 0) {
+        pool->threads = (pthread_t*)calloc(workers, sizeof(pthread_t));
+        if (pool->threads == NULL) {
+            ret = -1;
+            workers = 0;
+        }
+        for (int i = 0; i < workers; i++) {
+            if (pthread_create(&pool->threads[i], NULL, convert_worker, pool) != 0) {
+                LOGE("create convert worker %d fail", i);
+                ret = -1;
+                break;
             }
+            pool->thread_num++;
         }
     }
+    pthread_mutex_unlock(&pool->busy);
+    return ret;
+}
 
-    return 0;
+int get_image_convert_threads(void)
+{
+    convert_pool_t* pool = &g_convert_pool;
+    pthread_mutex_lock(&pool->busy);
+    int num_threads = pool->thread_num + 1;
+    pthread_mutex_unlock(&pool->busy);
+    return num_threads;
+}
+
+int parse_cpu_list(const char* text, int* cpus, int max_cpus)
+{
+    int count = 0;
+    const char* p = text;
+    while (*p != '\0') {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            return -1;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first) {
+                return -1;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (count >= max_cpus) {
+                return -1;
+            }
+            cpus[count++] = (int)cpu;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return -1;
+        }
+    }
+    return count > 0 ? count : -1;
+}
+
+/**
+ * @brief 一次缩放的全部参数，条带函数按行号处理其中一段
+ */
+typedef struct {
+    int channel;
+    int is_nv21;
+    unsigned char* src;
+    int src_width, src_height;
+    int crop_x, crop_y, crop_width, crop_height;
+    unsigned char* dst;
+    int dst_width;
+    int dst_box_x, dst_box_y, dst_box_width, dst_box_height;
+} scale_job_t;
+
+static int scale_rows_stripe(void* arg, int row_begin, int row_end)
+{
+    const scale_job_t* job = (const scale_job_t*)arg;
+    return crop_and_scale_image_rows(job->channel, job->src, job->src_width, job->src_height,
+                                     job->crop_x, job->crop_y, job->crop_width, job->crop_height,
+                                     job->dst, job->dst_width,
+                                     job->dst_box_x, job->dst_box_y, job->dst_box_width, job->dst_box_height,
+                                     row_begin, row_end);
+}
+
+static int crop_and_scale_image_c(int channel, unsigned char *src, int src_width, int src_height,
+                                    int crop_x, int crop_y, int crop_width, int crop_height,
+                                    unsigned char *dst, int dst_width, int dst_height,
+                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+    scale_job_t job = {channel, 0, src, src_width, src_height, crop_x, crop_y, crop_width, crop_height,
+                       dst, dst_width, dst_box_x, dst_box_y, dst_box_width, dst_box_height};
+    return convert_rows_parallel(scale_rows_stripe, &job, dst_box_height, dst_box_width);
 }
 
 static int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int src_height,
@@ -199,12 +677,162 @@ static int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int
     crop_and_scale_image_c(1, src_y, src_width, src_height, crop_x, crop_y, crop_width, crop_height,
         dst_y, dst_width, dst_height, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
     
+    // UV平面宽高都是亮度的一半，目标区域也要减半
     crop_and_scale_image_c(2, src_uv, src_width / 2, src_height / 2, crop_x / 2, crop_y / 2, crop_width / 2, crop_height / 2,
-        dst_uv, dst_width / 2, dst_height / 2, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
+        dst_uv, dst_width / 2, dst_height / 2, dst_box_x / 2, dst_box_y / 2, dst_box_width / 2, dst_box_height / 2);
 
     return 0;
 }
 
+/*
+ * YUV420SP（NV12/NV21）直接缩放输出RGB888
+ *
+ * 解码器输出的YUV帧不再先转换为全尺寸RGB：亮度平面用上面的定点双线性缩放到目标区域大小，
+ * 色度按目标像素对应的源像素取所在2x2块的UV（与OpenCV cvtColor的色度采样方式相同），
+ * 然后逐行转换为RGB写入letterbox目标区域。中间缓冲只有一个条带（并行时）或整个目标区域大小的亮度平面。
+ * 转换公式及定点常量与OpenCV 3.x的YUV420sp2RGB一致（BT.601，20位定点），
+ * 不缩放时与cv::cvtColor(COLOR_YUV2RGB_NV12/NV21)逐位相同。
+ */
+#define YUV2RGB_SHIFT 20
+#define YUV2RGB_CY  1220542
+#define YUV2RGB_CUB 2116026
+#define YUV2RGB_CUG -409993
+#define YUV2RGB_CVG -852492
+#define YUV2RGB_CVR 1673527
+
+typedef struct {
+    unsigned char* y_plane;     // 缩放后的亮度平面，dst_box_w x 条带行数
+    unsigned char* u_row;
+    unsigned char* v_row;
+    int* uv_ofs;                // 每个目标列对应的源UV字节偏移
+    size_t capacity;
+} yuv_scratch_t;
+
+static __thread yuv_scratch_t g_yuv_scratch;
+
+static int reserve_yuv_scratch(yuv_scratch_t* scratch, int box_w, int box_h)
+{
+    size_t plane = (size_t)box_w * box_h;
+    size_t rows = (size_t)box_w * 2;
+    // uv_ofs按int对齐放在最前面
+    size_t need = (size_t)box_w * sizeof(int) + plane + rows;
+    if (need > scratch->capacity) {
+        void* buf = realloc(scratch->uv_ofs, need);
+        if (buf == NULL) {
+            return -1;
+        }
+        scratch->uv_ofs = (int*)buf;
+        scratch->capacity = need;
+        track_thread_scratch(SCRATCH_KEY_YUV, buf);
+    }
+    scratch->y_plane = (unsigned char*)(scratch->uv_ofs + box_w);
+    scratch->u_row = scratch->y_plane + plane;
+    scratch->v_row = scratch->u_row + box_w;
+    return 0;
+}
+
+static inline unsigned char yuv2rgb_clamp(int v)
+{
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static void yuv_row_to_rgb(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+                           unsigned char* dst, int n)
+{
+    int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const int32x4_t round = vdupq_n_s32(1 << (YUV2RGB_SHIFT - 1));
+    const int16x8_t bias = vdupq_n_s16(128);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t y16 = vreinterpretq_s16_u16(vmovl_u8(vqsub_u8(vld1_u8(y + i), vdup_n_u8(16))));
+        int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + i))), bias);
+        int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + i))), bias);
+        int16x4_t r_half[2], g_half[2], b_half[2];
+        for (int h = 0; h < 2; h++) {
+            int32x4_t yy = vmulq_n_s32(vmovl_s16(h ? vget_high_s16(y16) : vget_low_s16(y16)), YUV2RGB_CY);
+            int32x4_t uu = vmovl_s16(h ? vget_high_s16(u16) : vget_low_s16(u16));
+            int32x4_t vv = vmovl_s16(h ? vget_high_s16(v16) : vget_low_s16(v16));
+            int32x4_t ruv = vmlaq_n_s32(round, vv, YUV2RGB_CVR);
+            int32x4_t guv = vmlaq_n_s32(vmlaq_n_s32(round, vv, YUV2RGB_CVG), uu, YUV2RGB_CUG);
+            int32x4_t buv = vmlaq_n_s32(round, uu, YUV2RGB_CUB);
+            r_half[h] = vqmovn_s32(vshrq_n_s32(vaddq_s32(yy, ruv), YUV2RGB_SHIFT));
+            g_half[h] = vqmovn_s32(vshrq_n_s32(vaddq_s32(yy, guv), YUV2RGB_SHIFT));
+            b_half[h] = vqmovn_s32(vshrq_n_s32(vaddq_s32(yy, buv), YUV2RGB_SHIFT));
+        }
+        uint8x8x3_t rgb;
+        rgb.val[0] = vqmovun_s16(vcombine_s16(r_half[0], r_half[1]));
+        rgb.val[1] = vqmovun_s16(vcombine_s16(g_half[0], g_half[1]));
+        rgb.val[2] = vqmovun_s16(vcombine_s16(b_half[0], b_half[1]));
+        vst3_u8(dst + i * 3, rgb);
+    }
+#endif
+    for (; i < n; i++) {
+        int yy = (y[i] > 16 ? y[i] - 16 : 0) * YUV2RGB_CY;
+        int uu = (int)u[i] - 128;
+        int vv = (int)v[i] - 128;
+        int ruv = (1 << (YUV2RGB_SHIFT - 1)) + YUV2RGB_CVR * vv;
+        int guv = (1 << (YUV2RGB_SHIFT - 1)) + YUV2RGB_CVG * vv + YUV2RGB_CUG * uu;
+        int buv = (1 << (YUV2RGB_SHIFT - 1)) + YUV2RGB_CUB * uu;
+        dst[i * 3 + 0] = yuv2rgb_clamp((yy + ruv) >> YUV2RGB_SHIFT);
+        dst[i * 3 + 1] = yuv2rgb_clamp((yy + guv) >> YUV2RGB_SHIFT);
+        dst[i * 3 + 2] = yuv2rgb_clamp((yy + buv) >> YUV2RGB_SHIFT);
+    }
+}
+
+// 转换目标区域中[row_begin, row_end)范围内的行，亮度临时平面只保存这些行
+static int yuv420sp_to_rgb_stripe(void* arg, int row_begin, int row_end)
+{
+    const scale_job_t* job = (const scale_job_t*)arg;
+    int box_w = job->dst_box_width;
+    yuv_scratch_t* scratch = &g_yuv_scratch;
+    if (reserve_yuv_scratch(scratch, box_w, row_end - row_begin) != 0) {
+        LOGE("alloc yuv scratch fail");
+        return -1;
+    }
+
+    // 亮度：缩放到目标区域大小，第y行写到临时平面的第y-row_begin行
+    int ret = crop_and_scale_image_rows(1, job->src, job->src_width, job->src_height,
+                                        job->crop_x, job->crop_y, job->crop_width, job->crop_height,
+                                        scratch->y_plane, box_w,
+                                        0, -row_begin, box_w, job->dst_box_height, row_begin, row_end);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // 色度：与亮度双线性采样的左上源像素同属一个2x2块
+    float x_ratio = (float)job->crop_width / (float)box_w;
+    float y_ratio = (float)job->crop_height / (float)job->dst_box_height;
+    for (int x = 0; x < box_w; x++) {
+        int src_x = (int)(x * x_ratio) + job->crop_x;
+        scratch->uv_ofs[x] = (src_x >> 1) * 2;
+    }
+
+    const unsigned char* src_uv = job->src + (size_t)job->src_width * job->src_height;
+    int u_idx = job->is_nv21 ? 1 : 0;
+    for (int y = row_begin; y < row_end; y++) {
+        int src_y = (int)(y * y_ratio) + job->crop_y;
+        const unsigned char* uv_row = src_uv + (size_t)(src_y >> 1) * job->src_width;
+        for (int x = 0; x < box_w; x++) {
+            const unsigned char* uv = uv_row + scratch->uv_ofs[x];
+            scratch->u_row[x] = uv[u_idx];
+            scratch->v_row[x] = uv[1 - u_idx];
+        }
+        unsigned char* dst_row = job->dst + ((size_t)(job->dst_box_y + y) * job->dst_width + job->dst_box_x) * 3;
+        yuv_row_to_rgb(scratch->y_plane + (size_t)(y - row_begin) * box_w, scratch->u_row, scratch->v_row,
+                       dst_row, box_w);
+    }
+    return 0;
+}
+
+static int crop_and_scale_yuv420sp_to_rgb(int is_nv21, unsigned char *src, int src_width, int src_height,
+                                    int crop_x, int crop_y, int crop_width, int crop_height,
+                                    unsigned char *dst, int dst_width,
+                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+    scale_job_t job = {3, is_nv21, src, src_width, src_height, crop_x, crop_y, crop_width, crop_height,
+                       dst, dst_width, dst_box_x, dst_box_y, dst_box_width, dst_box_height};
+    return convert_rows_parallel(yuv420sp_to_rgb_stripe, &job, dst_box_height, dst_box_width);
+}
+
 static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rect_t *src_box, image_rect_t *dst_box, char color) {
     int ret;
     if (dst->virt_addr == NULL) {
@@ -213,7 +841,9 @@ static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rec
     if (src->virt_addr == NULL) {
         return -1;
     }
-    if (src->format != dst->format) {
+    int yuv_to_rgb = (src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV21) &&
+                     dst->format == IMAGE_FORMAT_RGB888;
+    if (src->format != dst->format && !yuv_to_rgb) {
         return -1;
     }
 
@@ -246,7 +876,13 @@ static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rec
 
     int need_release_dst_buffer = 0;
     int reti = 0;
-    if (src->format == IMAGE_FORMAT_RGB888) {
+    if (yuv_to_rgb) {
+        reti = crop_and_scale_yuv420sp_to_rgb(src->format == IMAGE_FORMAT_YUV420SP_NV21, src->virt_addr,
+            src->width, src->height,
+            src_box_x, src_box_y, src_box_w, src_box_h,
+            dst->virt_addr, dst->width,
+            dst_box_x, dst_box_y, dst_box_w, dst_box_h);
+    } else if (src->format == IMAGE_FORMAT_RGB888) {
         reti = crop_and_scale_image_c(3, src->virt_addr, src->width, src->height,
             src_box_x, src_box_y, src_box_w, src_box_h,
             dst->virt_addr, dst->width, dst->height,
@@ -267,13 +903,13 @@ static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rec
             dst->virt_addr, dst->width, dst->height,
             dst_box_x, dst_box_y, dst_box_w, dst_box_h);
     } else {
-        printf("no support format %d\n", src->format);
+        LOGE("no support format %d", src->format);
     }
     if (reti != 0) {
-        printf("convert_image_cpu fail %d\n", reti);
+        LOGE("convert_image_cpu fail %d", reti);
         return -1;
     }
-    printf("finish\n");
+    LOGD("finish");
     return 0;
 }
 
@@ -316,18 +952,18 @@ int get_image_size(image_buffer_t* image)
  */
 int convert_image(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t* src_box, image_rect_t* dst_box, char color)
 {
-    printf("Converting image using CPU processing\n");
-    printf("src width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
+    LOGD("Converting image using CPU processing");
+    LOGD("src width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d",
         src_img->width, src_img->height, src_img->format, src_img->virt_addr, src_img->fd);
-    printf("dst width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
+    LOGD("dst width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d",
         dst_img->width, dst_img->height, dst_img->format, dst_img->virt_addr, dst_img->fd);
     if (src_box != NULL) {
-        printf("src_box=(%d %d %d %d)\n", src_box->left, src_box->top, src_box->right, src_box->bottom);
+        LOGD("src_box=(%d %d %d %d)", src_box->left, src_box->top, src_box->right, src_box->bottom);
     }
     if (dst_box != NULL) {
-        printf("dst_box=(%d %d %d %d)\n", dst_box->left, dst_box->top, dst_box->right, dst_box->bottom);
+        LOGD("dst_box=(%d %d %d %d)", dst_box->left, dst_box->top, dst_box->right, dst_box->bottom);
     }
-    printf("color=0x%x\n", color);
+    LOGD("color=0x%x", color);
 
     // 直接使用CPU处理，不再尝试RGA
     return convert_image_cpu(src_img, dst_img, src_box, dst_box, color);
@@ -391,7 +1027,7 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
     letterbox->x_pad = _left_offset;
     letterbox->y_pad = _top_offset;
     
-    printf("Letterbox params: scale=%.3f, x_pad=%d, y_pad=%d\n", 
+    LOGD("Letterbox params: scale=%.3f, x_pad=%d, y_pad=%d", 
            scale, _left_offset, _top_offset);
     
     // 设置目标图像区域
@@ -408,11 +1044,11 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
         dst_image->fd = 0;  // 标记为普通内存
         
         if (dst_image->virt_addr == NULL) {
-            printf("Error: Memory allocation failed for destination image size %d\n", dst_size);
+            LOGE("Error: Memory allocation failed for destination image size %d", dst_size);
             return -1;
         }
         
-        printf("Allocated destination image buffer: %d bytes\n", dst_size);
+        LOGD("Allocated destination image buffer: %d bytes", dst_size);
     }
     
     // 使用CPU进行图像转换
@@ -433,7 +1069,7 @@ void free_image_buffer(image_buffer_t* image) {
     if (image->virt_addr != NULL) {
         // 统一使用普通内存，直接释放
         free(image->virt_addr);
-        printf("Image buffer freed (regular memory)\n");
+        LOGD("Image buffer freed (regular memory)");
         
         // 重置缓冲区信息
         image->virt_addr = NULL;
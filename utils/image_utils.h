@@ -26,6 +26,22 @@ typedef struct {
  */
 int read_image(const char* path, image_buffer_t* image);
 
+/**
+ * @brief Read jpeg file with libjpeg-turbo scaled decoding
+ * 
+ * Decodes directly to RGB888 at the smallest DCT scaling factor (1/8 ... 1) that still
+ * covers the letterbox resize into min_width x min_height, so large JPEGs are never
+ * materialized at full resolution.
+ * 
+ * @param path [in] Jpeg path
+ * @param min_width [in] Target width (model input width)
+ * @param min_height [in] Target height (model input height)
+ * @param image [out] Decoded RGB888 image, release with free_image_buffer()
+ * @param decode_scale [out] Decoded width / original width, can be NULL
+ * @return int 0: success; -1: error
+ */
+int read_image_jpeg_scaled(const char* path, int min_width, int min_height, image_buffer_t* image, float* decode_scale);
+
 /**
  * @brief Write image file (support jpg/png)
  * 
@@ -38,6 +54,9 @@ int write_image(const char* path, const image_buffer_t* image);
 /**
  * @brief Convert image for resize and pixel format change
  * 
+ * Source and target formats must match, except YUV420SP (NV12/NV21) sources which can
+ * also be scaled directly into an RGB888 target.
+ * 
  * @param src_image [in] Source Image
  * @param dst_image [out] Target Image
  * @param src_box [in] Crop rectangle on source image
@@ -58,6 +77,37 @@ int convert_image(image_buffer_t* src_image, image_buffer_t* dst_image, image_re
  */
 int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_t* letterbox, char color);
 
+/**
+ * @brief Set the number of threads used by convert_image / convert_image_with_letterbox
+ * 
+ * The target box is split into row stripes processed by a persistent worker pool together
+ * with the calling thread; the output is bit-identical to single-threaded processing.
+ * Small target boxes (below 256x256 pixels) and callers that find the pool busy with another
+ * conversion fall back to single-threaded processing. A conversion already using the pool
+ * finishes before the workers are replaced.
+ * 
+ * @param num_threads [in] Total threads including the caller, <= 1 disables the pool (default)
+ * @param cpus [in] CPUs the workers are pinned to, e.g. the RK3588 big cores 4-7, NULL: no affinity
+ * @param cpu_num [in] Number of entries in cpus
+ * @return int 0: success; -1: error (some workers may not have started)
+ */
+int set_image_convert_threads(int num_threads, const int* cpus, int cpu_num);
+
+/**
+ * @brief Get the number of convert threads including the caller
+ */
+int get_image_convert_threads(void);
+
+/**
+ * @brief Parse a cpu list such as "4-7" or "4,5,6,7"
+ * 
+ * @param text [in] Comma separated cpu numbers or ranges
+ * @param cpus [out] Parsed cpu numbers
+ * @param max_cpus [in] Capacity of cpus
+ * @return int number of cpus; -1: invalid list
+ */
+int parse_cpu_list(const char* text, int* cpus, int max_cpus);
+
 /**
  * @brief Get the image size
  * 
@@ -0,0 +1,214 @@
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "log_utils.h"
+
+#define LOG_MSG_MAX 256     // 异步模式下单条消息的最大长度（含结尾'\0'），超出部分截断
+
+int g_log_level = LOG_LEVEL_INFO;
+
+static FILE* g_log_fp = NULL;   // NULL表示stdout（stdout不是编译期常量，不能用于静态初始化）
+
+/**
+ * @brief 环形缓冲区中的一条消息
+ *
+ * seq是Vyukov有界队列的序号：等于写位置时槽位空闲，等于写位置+1时消息已写好可以读取。
+ */
+typedef struct {
+    size_t seq;
+    char msg[LOG_MSG_MAX];
+} log_slot_t;
+
+typedef struct {
+    log_slot_t* slots;
+    size_t mask;
+    size_t enqueue_pos;     // 多个生产者通过CAS竞争
+    size_t dequeue_pos;     // 只由后台线程访问
+    int dropped;
+    int stop;
+    sem_t sem;
+    pthread_t thread;
+} log_ring_t;
+
+static log_ring_t g_ring;
+static int g_async = 0;
+
+static FILE* log_output()
+{
+    return g_log_fp != NULL ? g_log_fp : stdout;
+}
+
+static int64_t log_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void log_set_level(int level)
+{
+    g_log_level = level;
+}
+
+int log_parse_level(const char* name)
+{
+    static const char* names[] = {"trace", "debug", "info", "warn", "error", "off"};
+    int i;
+    for (i = 0; i <= LOG_LEVEL_OFF; i++) {
+        if (strcasecmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void log_set_output(FILE* fp)
+{
+    g_log_fp = fp;
+}
+
+// 后台线程：取出所有已写好的消息后写出，队列空时在信号量上等待
+static void* log_thread_main(void* arg)
+{
+    log_ring_t* ring = (log_ring_t*)arg;
+    for (;;) {
+        int wrote = 0;
+        for (;;) {
+            log_slot_t* slot = &ring->slots[ring->dequeue_pos & ring->mask];
+            if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring->dequeue_pos + 1) {
+                break;
+            }
+            int dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+            if (dropped > 0) {
+                fprintf(log_output(), "(%d log messages dropped, ring full)\n", dropped);
+            }
+            fputs(slot->msg, log_output());
+            __atomic_store_n(&slot->seq, ring->dequeue_pos + ring->mask + 1, __ATOMIC_RELEASE);
+            ring->dequeue_pos++;
+            wrote = 1;
+        }
+        if (wrote) {
+            fflush(log_output());
+        }
+        if (__atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        sem_wait(&ring->sem);
+    }
+    return NULL;
+}
+
+int log_start_async(int capacity)
+{
+    size_t n = 1;
+    size_t i;
+    if (g_async) {
+        return 0;
+    }
+    while (n < (size_t)(capacity > 0 ? capacity : 1)) {
+        n <<= 1;
+    }
+    memset(&g_ring, 0, sizeof(g_ring));
+    g_ring.slots = (log_slot_t*)malloc(n * sizeof(log_slot_t));
+    if (g_ring.slots == NULL) {
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        g_ring.slots[i].seq = i;
+    }
+    g_ring.mask = n - 1;
+    if (sem_init(&g_ring.sem, 0, 0) != 0) {
+        free(g_ring.slots);
+        return -1;
+    }
+    if (pthread_create(&g_ring.thread, NULL, log_thread_main, &g_ring) != 0) {
+        sem_destroy(&g_ring.sem);
+        free(g_ring.slots);
+        return -1;
+    }
+    __atomic_store_n(&g_async, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void log_stop_async()
+{
+    if (!g_async) {
+        return;
+    }
+    // 先切回同步输出，后台线程写完队列中剩余的消息后退出
+    __atomic_store_n(&g_async, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_ring.stop, 1, __ATOMIC_RELEASE);
+    sem_post(&g_ring.sem);
+    pthread_join(g_ring.thread, NULL);
+    sem_destroy(&g_ring.sem);
+    free(g_ring.slots);
+    g_ring.slots = NULL;
+}
+
+// 在环形缓冲区中占一个槽位并格式化，队列满时丢弃
+static void log_enqueue(const char* fmt, va_list args)
+{
+    size_t pos = __atomic_load_n(&g_ring.enqueue_pos, __ATOMIC_RELAXED);
+    log_slot_t* slot;
+    for (;;) {
+        slot = &g_ring.slots[pos & g_ring.mask];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&g_ring.enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&g_ring.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&g_ring.enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    int len = vsnprintf(slot->msg, LOG_MSG_MAX - 1, fmt, args);
+    if (len < 0) {
+        len = 0;
+    } else if (len > LOG_MSG_MAX - 2) {
+        len = LOG_MSG_MAX - 2;
+    }
+    slot->msg[len] = '\n';
+    slot->msg[len + 1] = '\0';
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    sem_post(&g_ring.sem);
+}
+
+void log_write(int level, const char* fmt, ...)
+{
+    va_list args;
+    (void)level;
+    va_start(args, fmt);
+    if (__atomic_load_n(&g_async, __ATOMIC_ACQUIRE)) {
+        log_enqueue(fmt, args);
+    } else {
+        FILE* fp = log_output();
+        flockfile(fp);
+        vfprintf(fp, fmt, args);
+        fputc('\n', fp);
+        funlockfile(fp);
+    }
+    va_end(args);
+}
+
+int log_rate_check(log_rate_t* rate, int interval_ms)
+{
+    int64_t now = log_now_ns();
+    int64_t last = __atomic_load_n(&rate->last_ns, __ATOMIC_RELAXED);
+    if ((last == 0 || now - last >= (int64_t)interval_ms * 1000000LL) &&
+        __atomic_compare_exchange_n(&rate->last_ns, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return __atomic_exchange_n(&rate->suppressed, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&rate->suppressed, 1, __ATOMIC_RELAXED);
+    return -1;
+}
@@ -0,0 +1,137 @@
+#ifndef _RKNN_MODEL_ZOO_LOG_UTILS_H_
+#define _RKNN_MODEL_ZOO_LOG_UTILS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Log level
+ *
+ */
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF   5
+
+/**
+ * @brief Compile-time level, statements below it are removed by the compiler
+ *
+ * Override with -DLOG_COMPILE_LEVEL=LOG_LEVEL_WARN etc.
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * @brief Runtime level, read by the LOG* macros before any formatting happens
+ *
+ */
+extern int g_log_level;
+
+/**
+ * @brief Per call-site state of LOG*_EVERY_MS
+ *
+ */
+typedef struct {
+    int64_t last_ns;
+    int suppressed;
+} log_rate_t;
+
+/**
+ * @brief Set runtime log level
+ *
+ * @param level [in] LOG_LEVEL_*
+ */
+void log_set_level(int level);
+
+/**
+ * @brief Parse level name (trace/debug/info/warn/error/off)
+ *
+ * @param name [in] Level name
+ * @return int LOG_LEVEL_*; -1: unknown name
+ */
+int log_parse_level(const char* name);
+
+/**
+ * @brief Redirect log output, default stdout
+ *
+ * @param fp [in] Output stream
+ */
+void log_set_output(FILE* fp);
+
+/**
+ * @brief Switch to the asynchronous sink
+ *
+ * Messages are formatted by the caller into a fixed-size slot of a lock-free ring buffer and written
+ * by a background thread, so the caller never takes the stdio lock or blocks on the output device.
+ * When the ring is full the message is dropped and counted; the count is reported on the next write.
+ *
+ * @param capacity [in] Ring slots, rounded up to a power of two
+ * @return int 0: success; -1: error
+ */
+int log_start_async(int capacity);
+
+/**
+ * @brief Flush the ring buffer and go back to synchronous output
+ *
+ */
+void log_stop_async();
+
+/**
+ * @brief Write one message, use the LOG* macros instead
+ *
+ */
+void log_write(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Rate limit check for LOG*_EVERY_MS
+ *
+ * @param rate [in] Call-site state
+ * @param interval_ms [in] Minimum interval between two messages
+ * @return int >= 0: write now, value is the number of suppressed messages since the last write; -1: suppress
+ */
+int log_rate_check(log_rate_t* rate, int interval_ms);
+
+#define LOG_ENABLED(level) ((level) >= LOG_COMPILE_LEVEL && (level) >= g_log_level)
+
+#define LOG_AT(level, ...)                  \
+    do {                                    \
+        if (LOG_ENABLED(level)) {           \
+            log_write(level, __VA_ARGS__);  \
+        }                                   \
+    } while (0)
+
+#define LOG_AT_EVERY_MS(level, interval_ms, ...)                                             \
+    do {                                                                                    \
+        if (LOG_ENABLED(level)) {                                                           \
+            static log_rate_t _log_rate = {0, 0};                                           \
+            int _log_suppressed = log_rate_check(&_log_rate, interval_ms);                  \
+            if (_log_suppressed > 0) {                                                      \
+                log_write(level, "(%d similar messages suppressed)", _log_suppressed);       \
+            }                                                                               \
+            if (_log_suppressed >= 0) {                                                     \
+                log_write(level, __VA_ARGS__);                                              \
+            }                                                                               \
+        }                                                                                   \
+    } while (0)
+
+#define LOGT(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOGD(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOGI(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOGW(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOGE(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#define LOGW_EVERY_MS(interval_ms, ...) LOG_AT_EVERY_MS(LOG_LEVEL_WARN, interval_ms, __VA_ARGS__)
+#define LOGE_EVERY_MS(interval_ms, ...) LOG_AT_EVERY_MS(LOG_LEVEL_ERROR, interval_ms, __VA_ARGS__)
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif //_RKNN_MODEL_ZOO_LOG_UTILS_H_